@@ -2,10 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../model/transaction/transaction.h"
 #include "../model/transaction/transaction_persistence.h"
+#include "../model/transaction/utxo_snapshot.h"
 #include "../model/block/block.h"
+#include "../model/block/block_persistence.h"
+#include "../utils/constants.h"
 #include "../utils/log_utils.h"
 #include "../utils/mjson.h"
 #include "shell.h"
@@ -34,6 +38,8 @@ int run(char *script);
 int cli_transaction_list_all_transactions();
 int cli_transaction_add_transaction_to_system(char *script);
 int cli_transaction_list_utxo();
+int cli_transaction_dump_utxo(char *path);
+int cli_transaction_load_utxo(char *path);
 int cli_transaction_get_genesis_transaction_private_key();
 
 int cli_cryptography_create_private_key();
@@ -83,6 +89,12 @@ int interpreter(char *command_args[], int args_size) {
         } else if (strcmp(command_args[1], "list-utxo") == 0) {
             if (args_size != 2) return bad_command();
             return cli_transaction_list_utxo();
+        } else if (strcmp(command_args[1], "dump-utxo") == 0) {
+            if (args_size != 3) return bad_command();
+            return cli_transaction_dump_utxo(command_args[2]);
+        } else if (strcmp(command_args[1], "load-utxo") == 0) {
+            if (args_size != 3) return bad_command();
+            return cli_transaction_load_utxo(command_args[2]);
         } else if (strcmp(command_args[1], "get-genesis-private-key") == 0) {
             if (args_size != 2) return bad_command();
             return cli_transaction_get_genesis_transaction_private_key();
@@ -137,6 +149,8 @@ init-system                 								Initialize the system with the first empty t
 transaction list-all-transactions       					List all transactions in the current system\n \
 transaction add-transaction-to-system transaction.json    	Add the input transaction to the system with the json file\n \
 transaction list-utxo                   					List the information of UTXO\n \
+transaction dump-utxo utxo.snapshot     					Dump the UTXO into a snapshot file\n \
+transaction load-utxo utxo.snapshot     					Replace the UTXO with the content of a snapshot file\n \
 transaction get-genesis-private-key							\n \
 cryptography create-private-key         					Create a private key string by random\n \
 cryptography create-public-key private_key          		Create a public key by the input private key\n \
@@ -174,10 +188,13 @@ int quit() {
 int init() {
     initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
     transaction *genesis_transaction = initialize_transaction_system(false);
-    char *genesis_transaction_id = get_transaction_txid(genesis_transaction);
-    printf("Genesis transaction id: %s\n", genesis_transaction_id);
+    sha256_digest genesis_transaction_id = get_transaction_txid(genesis_transaction);
+    char genesis_transaction_id_hex[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(&genesis_transaction_id, genesis_transaction_id_hex);
+    printf("Genesis transaction id: %s\n", genesis_transaction_id_hex);
     initialize_block_system(false);
-    char* genesis_block_hash = get_genesis_block_hash();
+    char genesis_block_hash[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(get_genesis_block_hash(), genesis_block_hash);
     printf("Genesis block hash: %s\n", genesis_block_hash);
     return 0;
 }
@@ -276,7 +293,12 @@ int cli_transaction_add_transaction_to_system(char *script) {
         char sender_private_key[100];
         mjson_get_string(buffer, strlen(buffer), "$.inputs[i].sender_private_key", sender_private_key, sizeof(sender_private_key));
 
-        memcpy(shortcut_input_array[i].previous_txid, previous_id, strlen(previous_id));
+        if (!convert_hex_to_digest(previous_id, &shortcut_input_array[i].previous_txid)) {
+            printf("Invalid previous transaction id: %s\n", previous_id);
+            free(shortcut_input_array);
+            free(buffer);
+            return 1;
+        }
         shortcut_input_array[i].previous_output_idx = (int)output_idx;
         shortcut_input_array[i].private_key = sender_private_key;
     }
@@ -322,6 +344,29 @@ int cli_transaction_list_utxo() {
     return 0;
 }
 
+/**
+ * Dump the current UTXO into a snapshot file.
+ * @param path The path of the snapshot file.
+ * @return If run successfully, return 0.
+ */
+int cli_transaction_dump_utxo(char *path) {
+    sha256_digest tip_hash = get_last_inserted_block_hash();
+    if (!dump_utxo_snapshot(path, &tip_hash)) printf("Failed to dump the UTXO!\n");
+    return 0;
+}
+
+/**
+ * Replace the current UTXO with the content of a snapshot file.
+ * @param path The path of the snapshot file.
+ * @return If run successfully, return 0. If the snapshot file is not found, return 2.
+ */
+int cli_transaction_load_utxo(char *path) {
+    if (access(path, R_OK) != 0) return bad_command_file_does_not_exist();
+    sha256_digest tip_hash = get_last_inserted_block_hash();
+    if (!load_utxo_snapshot(path, &tip_hash, UTXO_SNAPSHOT_LOAD_THREADS)) printf("Failed to load the UTXO!\n");
+    return 0;
+}
+
 /**
  * Get the private of the genesis transaction.
  * @return If run successfully, return 0.
@@ -451,7 +496,9 @@ int cli_block_add_block_to_system(char* script) {
 
     char previous_block_hash[100];
     mjson_get_string(buffer, strlen(buffer), "$.previous_block_hash", previous_block_hash, sizeof(previous_block_hash));
-    block* previous_block =  get_block_by_hash(previous_block_hash);
+    sha256_digest previous_block_digest;
+    block* previous_block = NULL;
+    if (convert_hex_to_digest(previous_block_hash, &previous_block_digest)) previous_block = get_block_by_hash(&previous_block_digest);
 
     block* new_block = create_an_empty_block((int)number_of_transactions);
     if(append_prev_block(previous_block, new_block)){
@@ -469,9 +516,9 @@ int cli_block_add_block_to_system(char* script) {
  * @return If runs successfully, return 0.
  */
 int cli_block_get_genesis_block_hash() {
-    char *temp = get_genesis_block_hash();
+    sha256_digest *temp = get_genesis_block_hash();
     printf("Genesis block hash: ");
-    print_hex((unsigned char*)temp, strlen(temp));
+    print_hex(temp->data, SHA256_DIGEST_LENGTH);
     return 0;
 }
 
@@ -1,17 +1,22 @@
 #include "block.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "model/block/block_miner.h"
+#include "model/block/block_validator.h"
 #include "model/block/block_persistence.h"
+#include "model/transaction/transaction_persistence.h"
 #include "utils/constants.h"
 #include "utils/cryptography.h"
+#include "utils/serialize.h"
 #include "utils/sys_utils.h"
 
 #define LOG_SCOPE "block"
 
-char *g_genesis_block_hash;  // The hash of the header of the genesis block.
+sha256_digest g_genesis_block_hash;  // The hash of the header of the genesis block.
 
 /*
  * -----------------------------------------------------------
@@ -20,16 +25,66 @@ char *g_genesis_block_hash;  // The hash of the header of the genesis block.
  */
 
 /**
- * Hash the block header twice with SHA256.
+ * Serialize a block header into its canonical 80-byte
+ * form, the bytes hashed by hash_block_header() and sent
+ * over the wire. Identical on every compiler and CPU.
+ * @param header A header.
+ * @param dest Where BLOCK_HEADER_SERIALIZED_LENGTH bytes are written into.
+ */
+void serialize_block_header(block_header *header, unsigned char *dest) {
+    write_le32(dest, (unsigned int)header->version);
+    memcpy(dest + 4, header->prev_block_header_hash.data, SHA256_DIGEST_LENGTH);
+    memcpy(dest + 36, header->merkle_root_hash.data, SHA256_DIGEST_LENGTH);
+    write_le32(dest + 68, header->time);
+    write_le32(dest + 72, header->nBits);
+    write_le32(dest + 76, header->nonce);
+}
+
+/**
+ * Read a block header from its canonical 80-byte form.
+ * @param src BLOCK_HEADER_SERIALIZED_LENGTH bytes.
+ * @param dest The header to fill.
+ */
+void deserialize_block_header(const unsigned char *src, block_header *dest) {
+    dest->version = (int)load_le32(src);
+    memcpy(dest->prev_block_header_hash.data, src + 4, SHA256_DIGEST_LENGTH);
+    memcpy(dest->merkle_root_hash.data, src + 36, SHA256_DIGEST_LENGTH);
+    dest->time = load_le32(src + 68);
+    dest->nBits = load_le32(src + 72);
+    dest->nonce = load_le32(src + 76);
+    memoize_block_header_hash(dest);
+}
+
+/**
+ * Hash the block header twice with SHA256. The hash memoized
+ * in the header is returned unless the serialized header has
+ * changed since; otherwise it is computed without memoizing
+ * it, so that threads sharing a header only ever read it.
  * @param header A header.
  * @return The SHA256 code.
  * @auhor Junjian Chen
  */
-char *hash_block_header(block_header *header) {
-    char *hash = hash_struct_in_hex(header, sizeof(block_header));
-    char *ret_val = hash_struct_in_hex(hash, sizeof(hash));
-    free(hash);
-    return ret_val;
+sha256_digest hash_block_header(block_header *header) {
+    unsigned char serialized[BLOCK_HEADER_SERIALIZED_LENGTH];
+    serialize_block_header(header, serialized);
+    block_header_hash_cache *cache = &header->hash_cache;
+    if (cache->valid && memcmp(cache->serialized, serialized, BLOCK_HEADER_SERIALIZED_LENGTH) == 0) return cache->hash;
+
+    sha256_digest hash;
+    sha256_double_80(serialized, &hash);
+    return hash;
+}
+
+/**
+ * Memoize the hash of a block header in it. Only done while
+ * a single thread holds the header: as it is read or finalized.
+ * @param header A header.
+ */
+void memoize_block_header_hash(block_header *header) {
+    block_header_hash_cache *cache = &header->hash_cache;
+    serialize_block_header(header, cache->serialized);
+    sha256_double_80(cache->serialized, &cache->hash);
+    cache->valid = true;
 }
 
 /*
@@ -45,13 +100,19 @@ char *hash_block_header(block_header *header) {
  */
 block *initialize_block_system(bool skip_genesis) {
     initialize_block_persistence();
+    initialize_block_validator(BLOCK_VALIDATION_THREADS);
     if (skip_genesis) return NULL;
     unsigned int total_number_of_blocks = get_total_number_of_blocks();
 
     if (total_number_of_blocks == 0) {
         block *genesis_block = create_an_empty_block(1);
+        // The genesis transaction is part of the Merkle root, hence of the hash.
+        transaction *genesis_transaction = get_genesis_transaction();
+        if (genesis_transaction != NULL) append_transaction_into_block(genesis_block, genesis_transaction, 0);
         g_genesis_block_hash = hash_block_header(genesis_block->header);
-        general_log(LOG_SCOPE, LOG_INFO, "Initialized the block system Genesis block hash: %s.", g_genesis_block_hash);
+        char genesis_block_hash_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(&g_genesis_block_hash, genesis_block_hash_hex);
+        general_log(LOG_SCOPE, LOG_INFO, "Initialized the block system Genesis block hash: %s.", genesis_block_hash_hex);
         return genesis_block;
     } else {
         return get_genesis_block();
@@ -63,8 +124,8 @@ block *initialize_block_system(bool skip_genesis) {
  * @author Junjian Chen
  */
 void destroy_block_system() {
+    destroy_block_validator();
     destroy_block_persistence();
-    free(g_genesis_block_hash);
     general_log(LOG_SCOPE, LOG_INFO, "Destroyed the block module.");
 }
 
@@ -78,14 +139,17 @@ block *create_an_empty_block(unsigned int transaction_amount) {
     block *block_create = malloc(sizeof(block));
     block_header *header = malloc(sizeof(block_header));
     header->version = 0;
-    memset(header->prev_block_header_hash, '\0', 65);
-    memset(header->merkle_root_hash, '\0', 65);
+    memset(&header->prev_block_header_hash, 0, sizeof(sha256_digest));
+    memset(&header->merkle_root_hash, 0, sizeof(sha256_digest));
     header->nonce = 0;
     header->nBits = 0;
     header->time = get_current_unix_time();
+    header->hash_cache.valid = false;
     block_create->header = header;
     block_create->txn_count = transaction_amount;
     block_create->txns = (transaction **)malloc(sizeof(transaction *) * transaction_amount);
+    block_create->txid_tree = NULL;
+    block_create->arena = NULL;
     return block_create;
 }
 
@@ -103,41 +167,27 @@ bool append_prev_block(block *prev_block, block *cur_block) {
     }
 
     // SHA256(previous block header) twice.
-    char *prev_block_header_hash = hash_block_header(prev_block->header);
-
-    memcpy(cur_block->header->prev_block_header_hash, prev_block_header_hash, 64);
+    cur_block->header->prev_block_header_hash = hash_block_header(prev_block->header);
 
     return true;
 }
 
 /**
- * Check if a block is valid or not.
- * @param block1 The block to check.
+ * Check the header of a block: its previous block, its
+ * time and its proof of work.
+ * @param header The header to check.
  * @return True for success, and false otherwise.
- * @author Junjian Chen
  */
-bool check_block_valid(block *block1) {
-    // check if the block is NULL
-    if (block1 == NULL) {
-        general_log(LOG_SCOPE, LOG_ERROR, "The block is null.");
-        return false;
-    }
-
-    // check if the header is NULL
-    block_header *header = block1->header;
-    if (header == NULL) {
-        general_log(LOG_SCOPE, LOG_ERROR, "The block header is null.");
-        return false;
-    }
-
+static bool check_block_header_valid(block_header *header) {
     // check if the previous block is NULL
-    if (strcmp(header->prev_block_header_hash, "") == 0) {
-        if (strcmp(hash_block_header(header), g_genesis_block_hash) != 0) {
+    if (is_digest_zero(&header->prev_block_header_hash)) {
+        sha256_digest hash = hash_block_header(header);
+        if (!is_digest_equal(&hash, &g_genesis_block_hash)) {
             general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid since the previous block is null.");
             return false;
         }
     } else {
-        block *prev_block = get_block_by_hash(header->prev_block_header_hash);
+        block *prev_block = get_block_by_hash(&header->prev_block_header_hash);
         if (prev_block == NULL) {
             general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid since the previous block is null.");
             return false;
@@ -149,9 +199,37 @@ bool check_block_valid(block *block1) {
         return false;
     }
 
+    // check the proof of work; only the genesis block, matched by its hash above, was not mined
+    if (!is_digest_zero(&header->prev_block_header_hash) && !check_block_proof_of_work(header)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid since its hash is above the target of nBits %08x.", header->nBits);
+        return false;
+    }
+
     return true;
 }
 
+/**
+ * Check if a block is valid or not.
+ * @param block1 The block to check.
+ * @return True for success, and false otherwise.
+ * @author Junjian Chen
+ */
+bool check_block_valid(block *block1) {
+    // check if the block is NULL
+    if (block1 == NULL) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The block is null.");
+        return false;
+    }
+
+    // check if the header is NULL
+    if (block1->header == NULL) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The block header is null.");
+        return false;
+    }
+
+    return check_block_header_valid(block1->header);
+}
+
 /**
  * Register a block in the system.
  * @param block_finalize The block to register.
@@ -159,6 +237,8 @@ bool check_block_valid(block *block1) {
  * @author Junjian Chen
  */
 bool finalize_block(block *block_finalize) {
+    memoize_block_header_hash(block_finalize->header);
+
     // check if the block is valid
     if (!check_block_valid(block_finalize)) {
         return false;
@@ -173,7 +253,7 @@ bool finalize_block(block *block_finalize) {
  * @return The block.
  * @author Junjian Chen
  */
-block *get_block_by_hash(char *hash) { return get_block(hash); }
+block *get_block_by_hash(sha256_digest *hash) { return get_block(hash); }
 
 /**
  * Add transaction into the block.
@@ -184,24 +264,121 @@ block *get_block_by_hash(char *hash) { return get_block(hash); }
  * @author Junjian Chen
  */
 bool append_transaction_into_block(block *block1, transaction *transaction1, unsigned int input_idx) {
+    if (input_idx >= block1->txn_count) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot put a transaction at %u in a block of %u transactions.", input_idx, block1->txn_count);
+        return false;
+    }
     block1->txns[input_idx] = transaction1;
+
+    // Only the path from this leaf to the root is rehashed.
+    if (block1->txid_tree == NULL) block1->txid_tree = create_merkle_tree();
+    sha256_digest txid = get_transaction_txid(transaction1);
+    set_merkle_tree_leaf(block1->txid_tree, input_idx, &txid);
+    block1->header->merkle_root_hash = get_merkle_tree_root(block1->txid_tree);
     return true;
 }
 
 /**
- * Verify transactions in a block
- * @param block1  The block to verify transaction in it
+ * Compute the Merkle root over the txids of a block from scratch.
+ * @param block1 The block.
+ * @return The Merkle root; all zeros for a block without transactions.
+ */
+sha256_digest compute_block_merkle_root(block *block1) {
+    sha256_digest *txids = (sha256_digest *)malloc((block1->txn_count + 1) * sizeof(sha256_digest));
+    for (unsigned int i = 0; i < block1->txn_count; i++) txids[i] = get_transaction_txid(block1->txns[i]);
+    sha256_digest root = compute_merkle_root(txids, block1->txn_count);
+    free(txids);
+    return root;
+}
+
+/**
+ * Check that no outpoint is spent twice within a block.
+ * Outpoints are compared by their binary UTXO keys.
+ * @param flat_block The transactions of the block, packed one after another.
+ * @param txn_count Number of transactions.
+ * @return True if every outpoint is spent at most once, false otherwise.
+ */
+bool verify_block_outpoints_unique(flat_transaction *flat_block, unsigned int txn_count) {
+    unsigned int outpoint_count = 0;
+    flat_transaction *current = flat_block;
+    for (unsigned int i = 0; i < txn_count; i++, current = get_next_flat_transaction(current)) outpoint_count += current->tx_in_count;
+    if (outpoint_count < 2) return true;
+
+    bool result = true;
+    utxo_table *spent = create_utxo_table(outpoint_count);
+    current = flat_block;
+    for (unsigned int i = 0; i < txn_count && result; i++, current = get_next_flat_transaction(current)) {
+        for (unsigned int j = 0; j < current->tx_in_count; j++) {
+            utxo_key *key = &get_flat_transaction_input(current, j)->previous_outpoint;
+            if (get_utxo_table_entry(spent, key, NULL)) {
+                sha256_digest hash;
+                char hash_hex[SHA256_HEX_LENGTH];
+                memcpy(hash.data, key->txid, SHA256_DIGEST_LENGTH);
+                convert_digest_to_hex(&hash, hash_hex);
+                general_log(LOG_SCOPE, LOG_ERROR, "Outpoint %s:%u is spent twice in the block.", hash_hex, key->index);
+                result = false;
+                break;
+            }
+            put_utxo_table_entry(spent, key, 0);
+        }
+    }
+
+    destroy_utxo_table(spent);
+    return result;
+}
+
+/**
+ * Verify the transactions of a block, already packed. A
+ * transaction may spend outputs of earlier transactions in
+ * the same block.
+ * @param flat_block The transactions of the block, packed one after another.
+ * @param txn_count Number of transactions.
  * @return True for the valid transactions in the block, false for invalid
- * @author Junjian Chen
  */
-bool verify_block_transaction(block *block1) {
-    for (int i = 0; i < block1->txn_count; i++) {
-        if (!verify_transaction(block1->txns[i])) {
-            return false;
+static bool verify_flat_block_transactions(flat_transaction *flat_block, unsigned int txn_count) {
+    if (!verify_block_outpoints_unique(flat_block, txn_count)) return false;
+
+    // Check everything but the signatures, following the
+    // dependencies within the block across threads, then
+    // verify all signatures in parallel.
+    unsigned int check_count = 0;
+    flat_transaction *current = flat_block;
+    for (unsigned int i = 0; i < txn_count; i++, current = get_next_flat_transaction(current)) check_count += current->tx_in_count;
+    signature_check *checks = (signature_check *)malloc((check_count + 1) * sizeof(signature_check));
+
+    long failed_txn = prepare_flat_block_transaction_checks(flat_block, txn_count, BLOCK_VALIDATION_THREADS, checks);
+    if (failed_txn >= 0) general_log(LOG_SCOPE, LOG_ERROR, "Transaction %ld in the block is invalid.", failed_txn);
+    bool result = failed_txn < 0;
+
+    long failed_check = result ? verify_signatures(checks, check_count) : -1;
+    if (failed_check >= 0) {
+        unsigned int txn_idx = 0;
+        current = flat_block;
+        while (failed_check >= current->tx_in_count) {
+            failed_check -= current->tx_in_count;
+            current = get_next_flat_transaction(current);
+            txn_idx++;
         }
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to verify the signature of input %ld of transaction %u in the block.", failed_check, txn_idx);
+        result = false;
     }
 
-    return true;
+    free(checks);
+    return result;
+}
+
+/**
+ * Verify transactions in a block. A transaction may spend
+ * outputs of earlier transactions in the same block.
+ * @param block1  The block to verify transaction in it
+ * @return True for the valid transactions in the block, false for invalid
+ * @author Junjian Chen
+ */
+bool verify_block_transaction(block *block1) {
+    flat_transaction *flat_block = flatten_transactions(block1->txns, block1->txn_count);
+    bool result = verify_flat_block_transactions(flat_block, block1->txn_count);
+    free(flat_block);
+    return result;
 }
 
 /**
@@ -222,10 +399,10 @@ bool verify_block_chain(block *chain_tail) {
             return false;
         }
 
-        if (strcmp(temp->header->prev_block_header_hash, "") == 0) {
+        if (is_digest_zero(&temp->header->prev_block_header_hash)) {
             // When temp is genesis block
-            char *hash = hash_block_header(temp->header);
-            if (strcmp(hash, g_genesis_block_hash) == 0) {
+            sha256_digest hash = hash_block_header(temp->header);
+            if (is_digest_equal(&hash, &g_genesis_block_hash)) {
                 general_log(LOG_SCOPE, LOG_INFO, "The chain is valid!");
                 return true;
             } else {
@@ -237,15 +414,16 @@ bool verify_block_chain(block *chain_tail) {
             }
         } else {
             // When temp isn't genesis block
-            block *prev_block = get_block_by_hash(temp->header->prev_block_header_hash);
+            sha256_digest *prev_block_header_hash = &temp->header->prev_block_header_hash;
+            block *prev_block = get_block_by_hash(prev_block_header_hash);
             if (prev_block == NULL) {
                 general_log(LOG_SCOPE, LOG_ERROR, "The chain is invalid: no previous block found for a block!\n Error block: the last %dth block", i);
                 return false;
             }
 
-            char *hash = hash_block_header(prev_block->header);
-            if (strcmp(hash, temp->header->prev_block_header_hash) == 0) {
-                temp = get_block_by_hash(temp->header->prev_block_header_hash);
+            sha256_digest hash = hash_block_header(prev_block->header);
+            if (is_digest_equal(&hash, prev_block_header_hash)) {
+                temp = prev_block;
             } else {
                 general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid: previous block hash doesn't match!\n Error block: the last %dth block", i);
                 return false;
@@ -258,13 +436,20 @@ bool verify_block_chain(block *chain_tail) {
 
 /**
  * Verify a single block:
- * 1. Verify whether all transactions in this block are valid
- * 2. Verify whether the previous block header is valid
+ * 1. Verify whether the Merkle root matches the transactions
+ * 2. Verify whether all transactions in this block are valid
+ * 3. Verify whether the previous block header is valid
  * @param block1 The block to be verified
  * @return True if valid. False otherwise
  * @author Junjian Chen
  */
 bool verify_block(block *block1) {
+    sha256_digest merkle_root = compute_block_merkle_root(block1);
+    if (!is_digest_equal(&merkle_root, &block1->header->merkle_root_hash)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid since its Merkle root does not match its transactions.");
+        return false;
+    }
+
     if (!verify_block_transaction(block1)) {
         return false;
     }
@@ -281,7 +466,7 @@ bool verify_block(block *block1) {
  * @return The hash of the genesis block.
  * @author Junjian Chen
  */
-char *get_genesis_block_hash() { return g_genesis_block_hash; }
+sha256_digest *get_genesis_block_hash() { return &g_genesis_block_hash; }
 
 /**
  * Create a new block based on its header information, transactions information
@@ -292,19 +477,20 @@ char *get_genesis_block_hash() { return g_genesis_block_hash; }
  */
 bool create_new_block_shortcut(block_create_shortcut *block_data, block *dest) {
     block *ret_block = create_an_empty_block(block_data->transaction_list->txn_count);
-    memcpy(ret_block->header->prev_block_header_hash, block_data->header->prev_block_header_hash, 65);
+    ret_block->header->prev_block_header_hash = block_data->header->prev_block_header_hash;
     ret_block->header->time = block_data->header->time;
-    memcpy(ret_block->header->merkle_root_hash, block_data->header->merkle_root_hash, 65);
+    ret_block->header->merkle_root_hash = block_data->header->merkle_root_hash;
     ret_block->header->nBits = block_data->header->nBits;
     ret_block->header->nonce = block_data->header->nonce;
     ret_block->header->version = block_data->header->version;
     ret_block->txn_count = block_data->transaction_list->txn_count;
     ret_block->txns = block_data->transaction_list->txns;
+    ret_block->header->merkle_root_hash = compute_block_merkle_root(ret_block);
     *dest = *ret_block;
     return true;
 }
 
-bool block_rollback(char *rollback_block_hash, char *current_block_hash) {
+bool block_rollback(sha256_digest *rollback_block_hash, sha256_digest *current_block_hash) {
     if (rollback_block_hash == NULL) {
         general_log(LOG_SCOPE, LOG_ERROR, "The block hash is null.");
         return false;
@@ -314,12 +500,13 @@ bool block_rollback(char *rollback_block_hash, char *current_block_hash) {
         general_log(LOG_SCOPE, LOG_ERROR, "The block is null.");
         return false;
     }
-    block *current_block = get_block_by_hash(current_block_hash);
+    sha256_digest current_hash = *current_block_hash;
+    block *current_block = get_block_by_hash(&current_hash);
 
-    while (strcmp(current_block_hash, rollback_block_hash) != 0) {
-        current_block_hash = current_block->header->prev_block_header_hash;
+    while (!is_digest_equal(&current_hash, rollback_block_hash)) {
+        current_hash = current_block->header->prev_block_header_hash;
         destroy_block(current_block);
-        current_block = get_block_by_hash(current_block_hash);
+        current_block = get_block_by_hash(&current_hash);
     }
     return true;
 }
@@ -331,88 +518,257 @@ bool block_rollback(char *rollback_block_hash, char *current_block_hash) {
  * @author Junjian Chen
  */
 socket_block *cast_to_socket_block(block *b) {
-    int txns_total_length = 0;
-    int txns_ptr_deviation[b->txn_count + 1];
-
-    for (int i = 0; i < b->txn_count; i++) {
-        txns_ptr_deviation[i] = txns_total_length;
-        socket_transaction *tmp = cast_to_socket_transaction(b->txns[i]);
-        txns_total_length += get_socket_transaction_length(tmp);
-        free(tmp);
-    }
-    txns_ptr_deviation[b->txn_count] = txns_total_length;
+    socket_block *socket_blk = (socket_block *)malloc(get_socket_block_length(b));
+    write_socket_block(b, socket_blk);
+    return socket_blk;
+}
 
-    socket_block *socket_blk = (socket_block *)malloc(sizeof(socket_block) + txns_total_length);
-    socket_blk->version = b->header->version;
-    socket_blk->nonce = b->header->version;
+/**
+ * Write a block as a socket block into a buffer of the
+ * caller, in a single pass; every transaction is written
+ * in place.
+ * @param b A block.
+ * @param socket_blk Where get_socket_block_length() bytes are written into.
+ */
+void write_socket_block(block *b, socket_block *socket_blk) {
+    serialize_block_header(b->header, socket_blk->header);
     socket_blk->txn_count = b->txn_count;
-    socket_blk->nBits = b->header->nBits;
-    socket_blk->time = b->header->time;
-    memcpy(socket_blk->prev_block_header_hash, b->header->prev_block_header_hash, 65);
-    memcpy(socket_blk->merkle_root_hash, b->header->merkle_root_hash, 65);
 
+    int txns_total_length = 0;
     for (int i = 0; i < b->txn_count; i++) {
-        char *tx_starting_address = socket_blk->txns + txns_ptr_deviation[i];
-        socket_transaction *current_socket_tx = (socket_transaction *)(tx_starting_address);
-        socket_transaction *tmp = cast_to_socket_transaction(b->txns[i]);
-        memcpy(current_socket_tx, tmp, txns_ptr_deviation[i + 1] - txns_ptr_deviation[i]);
-        free(tmp);
+        write_socket_transaction(b->txns[i], (socket_transaction *)(socket_blk->txns + txns_total_length));
+        txns_total_length += get_transaction_socket_length(b->txns[i]);
     }
-
     socket_blk->txns_size = txns_total_length;
-
-    return socket_blk;
 }
 
 /**
- * Cast to a block from a socket block.
+ * Cast to a block from a socket block. The block, its
+ * header and its transactions are allocated from one
+ * arena, so that destroy_block() frees them at once.
  * @param socket_blk A socket block.
- * @return A block.
+ * @return A block, or NULL if it is malformed.
  * @author Junjian Chen
  */
 block *cast_to_block(socket_block *socket_blk) {
+    socket_block_view view;
+    if (!view_socket_block((const unsigned char *)socket_blk, sizeof(socket_block) + socket_blk->txns_size, &view)) return NULL;
+    return materialize_socket_block(&view);
+}
+
+/**
+ * View a socket block where it was received. Its bounds,
+ * and those of every transaction in it, are checked once
+ * here; the other view functions trust them.
+ * @param src The socket block.
+ * @param length Bytes of it; there must be nothing after the block.
+ * @param dest Where the view is written into.
+ * @return True for success, false if it is malformed.
+ */
+bool view_socket_block(const unsigned char *src, size_t length, socket_block_view *dest) {
+    if (length < sizeof(socket_block)) return false;
+    unsigned int txns_size;
+    memcpy(&dest->txn_count, src + offsetof(socket_block, txn_count), sizeof(dest->txn_count));
+    memcpy(&txns_size, src + offsetof(socket_block, txns_size), sizeof(txns_size));
+    if (dest->txn_count > BLOCK_MAX_TRANSACTIONS || txns_size != length - sizeof(socket_block)) return false;
+    dest->data = src;
+    dest->length = length;
+
+    // The transactions fill txns exactly.
+    size_t offset = sizeof(socket_block);
+    for (unsigned int i = 0; i < dest->txn_count; i++) {
+        socket_transaction_view t;
+        if (!view_socket_transaction(src + offset, length - offset, &t)) return false;
+        offset += get_socket_transaction_view_length(&t);
+    }
+    return offset == length;
+}
+
+/**
+ * Read the header of a viewed socket block.
+ * @param view A view.
+ * @param dest Where the header is written into.
+ */
+void get_socket_block_view_header(socket_block_view *view, block_header *dest) {
+    deserialize_block_header(view->data + offsetof(socket_block, header), dest);
+}
+
+/**
+ * View the first transaction of a viewed socket block.
+ * @param view A view of a block with transactions.
+ * @param dest Where the view of the transaction is written into.
+ */
+void get_first_socket_block_view_transaction(socket_block_view *view, socket_transaction_view *dest) {
+    view_socket_transaction(view->data + sizeof(socket_block), view->length - sizeof(socket_block), dest);
+}
+
+/**
+ * Move a transaction view on to the next transaction of
+ * its socket block, if there is one.
+ * @param view A view of the block.
+ * @param t A view of one of its transactions, which is then of the next.
+ */
+void get_next_socket_block_view_transaction(socket_block_view *view, socket_transaction_view *t) {
+    const unsigned char *next = t->data + get_socket_transaction_view_length(t);
+    view_socket_transaction(next, view->data + view->length - next, t);
+}
+
+/**
+ * Verify a viewed socket block, as verify_block() does,
+ * where it was received. The Merkle root and the header are
+ * checked without allocating anything; only then are the
+ * transactions packed, straight from the socket block, and
+ * checked. No transaction or script is ever copied out.
+ * @param view A view of the block.
+ * @return True if valid. False otherwise
+ */
+bool verify_socket_block_view(socket_block_view *view) {
+    block_header header;
+    get_socket_block_view_header(view, &header);
+
+    merkle_root_builder txids = {.count = 0};
+    size_t flat_size = 0;
+    socket_transaction_view t;
+    get_first_socket_block_view_transaction(view, &t);
+    for (unsigned int i = 0; i < view->txn_count; i++, get_next_socket_block_view_transaction(view, &t)) {
+        sha256_digest txid = get_socket_transaction_view_txid(&t);
+        add_merkle_root_builder_leaf(&txids, &txid);
+        flat_size += get_flat_transaction_size(t.tx_in_count, t.tx_out_count);
+    }
+    sha256_digest merkle_root = get_merkle_root_builder_root(&txids);
+    if (!is_digest_equal(&merkle_root, &header.merkle_root_hash)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The block is invalid since its Merkle root does not match its transactions.");
+        return false;
+    }
+
+    if (!check_block_header_valid(&header)) {
+        return false;
+    }
+
+    flat_transaction *flat_block = (flat_transaction *)malloc(flat_size > 0 ? flat_size : 1);
+    flat_transaction *current = flat_block;
+    get_first_socket_block_view_transaction(view, &t);
+    for (unsigned int i = 0; i < view->txn_count; i++, get_next_socket_block_view_transaction(view, &t)) {
+        flatten_socket_transaction_view(&t, current);
+        current = get_next_flat_transaction(current);
+    }
+    bool result = verify_flat_block_transactions(flat_block, view->txn_count);
+    free(flat_block);
+    return result;
+}
+
+/**
+ * Copy a viewed socket block into a block of its own, e.g.
+ * once it is accepted. The block, its header and its
+ * transactions are allocated from one arena, so that
+ * destroy_block() frees them at once.
+ * @param view A view of the block.
+ * @return A block.
+ */
+block *materialize_socket_block(socket_block_view *view) {
+    // Size the arena so that the whole block fits in a single chunk.
+    size_t arena_size = get_arena_allocation_size(sizeof(block)) + get_arena_allocation_size(sizeof(block_header)) +
+                        get_arena_allocation_size(view->txn_count * sizeof(transaction *));
+    socket_transaction_view t;
+    get_first_socket_block_view_transaction(view, &t);
+    for (unsigned int i = 0; i < view->txn_count; i++, get_next_socket_block_view_transaction(view, &t)) {
+        arena_size += get_socket_transaction_arena_size(&t);
+    }
+    arena *block_arena = create_arena(arena_size);
+
     // Initialize a block header.
-    block_header *blk_header = (block_header *)malloc(sizeof(block_header));
-    blk_header->time = socket_blk->time;
-    blk_header->version = socket_blk->version;
-    blk_header->nBits = socket_blk->nBits;
-    blk_header->nonce = socket_blk->nonce;
-    memcpy(blk_header->prev_block_header_hash, socket_blk->prev_block_header_hash, 65);
-    memcpy(blk_header->merkle_root_hash, socket_blk->merkle_root_hash, 65);
+    block_header *blk_header = (block_header *)arena_alloc(block_arena, sizeof(block_header));
+    get_socket_block_view_header(view, blk_header);
 
     // Initialize a block.
-    block *blk = (block *)malloc(sizeof(block));
-    blk->txn_count = socket_blk->txn_count;
+    block *blk = (block *)arena_alloc(block_arena, sizeof(block));
+    blk->txn_count = view->txn_count;
     blk->header = blk_header;
-    blk->txns = (transaction **)malloc(blk->txn_count * sizeof(transaction *));
-
-    // Get the total length of txns.
-    int total_length = 0;
-    for (int i = 0; i < socket_blk->txn_count; i++) {
-        // Get current socket transaction.
-        socket_transaction *current_socket_tx = (socket_transaction *)(socket_blk->txns + total_length);
-        int current_socket_transaction_length = get_socket_transaction_length(current_socket_tx);
-        total_length += current_socket_transaction_length;
-
-        // Initialize current tx.
-        blk->txns[i] = cast_to_transaction(current_socket_tx);
-    }
+    blk->txns = (transaction **)arena_alloc(block_arena, blk->txn_count * sizeof(transaction *));
+    blk->txid_tree = NULL;
+    blk->arena = block_arena;
 
+    get_first_socket_block_view_transaction(view, &t);
+    for (unsigned int i = 0; i < view->txn_count; i++, get_next_socket_block_view_transaction(view, &t)) {
+        blk->txns[i] = materialize_socket_transaction(&t, block_arena);
+    }
     return blk;
 }
 
 /**
- * Get the socket block length.
+ * Get the socket block length, without casting anything.
  * @param b A block.
  * @return The length of it if it was a socket block.
  * @author Junjian Chen
  */
 int get_socket_block_length(block *b) {
     int txns_total_length = sizeof(socket_block);
-    for (int i = 0; i < b->txn_count; i++) {
-        socket_transaction *tmp = cast_to_socket_transaction(b->txns[i]);
-        txns_total_length += get_socket_transaction_length(tmp);
-        free(tmp);
-    }
+    for (int i = 0; i < b->txn_count; i++) txns_total_length += get_transaction_socket_length(b->txns[i]);
     return txns_total_length;
 }
+
+/**
+ * Get the number of bytes serialize_block() writes.
+ * @param b A block.
+ * @return The size of the block in the raw format.
+ */
+unsigned int get_serialized_block_size(block *b) {
+    unsigned int size = BLOCK_HEADER_SERIALIZED_LENGTH + get_compact_size_length(b->txn_count);
+    for (unsigned int i = 0; i < b->txn_count; i++) size += get_transaction_size(b->txns[i]);
+    return size;
+}
+
+/**
+ * Serialize a block in the raw format: its header, a
+ * CompactSize transaction count, and every transaction as
+ * by serialize_transaction().
+ * @param b A block.
+ * @param dest Where get_serialized_block_size() bytes are written into.
+ * @return The number of bytes written.
+ */
+unsigned int serialize_block(block *b, unsigned char *dest) {
+    serialize_block_header(b->header, dest);
+    unsigned char *p = write_compact_size(dest + BLOCK_HEADER_SERIALIZED_LENGTH, b->txn_count);
+    for (unsigned int i = 0; i < b->txn_count; i++) p += serialize_transaction(b->txns[i], p);
+    return p - dest;
+}
+
+/**
+ * Read a block written by serialize_block(). It is checked
+ * to be complete first, then the block, its header and its
+ * transactions are allocated from one arena, as in cast_to_block().
+ * @param src The serialized block.
+ * @param length Bytes of it; there must be nothing after the block.
+ * @return A block, or NULL if it is malformed.
+ */
+block *deserialize_block(const unsigned char *src, size_t length) {
+    byte_reader reader = {.data = src, .length = length, .offset = 0};
+    const unsigned char *header = read_bytes(&reader, BLOCK_HEADER_SERIALIZED_LENGTH);
+    unsigned long long txn_count;
+    if (header == NULL || !read_compact_size(&reader, &txn_count) || txn_count > BLOCK_MAX_TRANSACTIONS ||
+        txn_count > get_remaining_bytes(&reader) / SERIALIZED_TRANSACTION_MIN_LENGTH)
+        return NULL;
+
+    // Size the arena so that the whole block fits in a single chunk.
+    size_t transactions_offset = reader.offset;
+    size_t arena_size = get_arena_allocation_size(sizeof(block)) + get_arena_allocation_size(sizeof(block_header)) +
+                        get_arena_allocation_size(txn_count * sizeof(transaction *));
+    for (unsigned int i = 0; i < txn_count; i++) {
+        if (!measure_serialized_transaction(&reader, &arena_size)) return NULL;
+    }
+    if (get_remaining_bytes(&reader) != 0) return NULL;
+    arena *block_arena = create_arena(arena_size);
+
+    block_header *blk_header = (block_header *)arena_alloc(block_arena, sizeof(block_header));
+    deserialize_block_header(header, blk_header);
+    block *blk = (block *)arena_alloc(block_arena, sizeof(block));
+    blk->txn_count = txn_count;
+    blk->header = blk_header;
+    blk->txns = (transaction **)arena_alloc(block_arena, blk->txn_count * sizeof(transaction *));
+    blk->txid_tree = NULL;
+    blk->arena = block_arena;
+
+    reader.offset = transactions_offset;
+    for (unsigned int i = 0; i < blk->txn_count; i++) blk->txns[i] = deserialize_transaction(&reader, block_arena);
+    return blk;
+}
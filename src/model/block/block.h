@@ -4,6 +4,10 @@
 #include <stdbool.h>
 
 #include "../transaction/transaction.h"
+#include "utils/merkle_tree.h"
+
+// Version, binary previous and merkle root hashes, time, nBits and nonce; little endian.
+#define BLOCK_HEADER_SERIALIZED_LENGTH 80
 
 /*
  * The following field is for defining blocks.
@@ -11,28 +15,37 @@
  * https://developer.bitcoin.org/reference/block_chain.html
  */
 
+typedef struct BlockHeaderHashCache {
+    bool valid;                                                // False until memoize_block_header_hash() fills it in.
+    unsigned char serialized[BLOCK_HEADER_SERIALIZED_LENGTH];  // The header the hash was computed from; it is stale once they differ.
+    sha256_digest hash;
+} block_header_hash_cache;
+
 typedef struct BlockHeader {
-    int version;                      // The block version number indicates which set of block validation rules to follow.
-    char prev_block_header_hash[65];  // A SHA256(SHA256()) hash in internal byte order of the previous block’s header.
-    char merkle_root_hash[65];        // A SHA256(SHA256()) hash in internal byte order.
-    unsigned int time;                // The block time is a Unix epoch time when the miner started hashing the header (according to the miner).
-    unsigned int nBits;               // An encoded version of the target threshold this block’s header hash must be less than or equal to.
-    unsigned int nonce;               // An arbitrary number miners change to modify the header hash for the PoW.
+    int version;                           // The block version number indicates which set of block validation rules to follow.
+    sha256_digest prev_block_header_hash;  // A SHA256(SHA256()) hash in internal byte order of the previous block’s header; all zeros for none.
+    sha256_digest merkle_root_hash;        // A SHA256(SHA256()) hash in internal byte order.
+    unsigned int time;                     // The block time is a Unix epoch time when the miner started hashing the header (according to the miner).
+    unsigned int nBits;                    // An encoded version of the target threshold this block’s header hash must be less than or equal to.
+    unsigned int nonce;                    // An arbitrary number miners change to modify the header hash for the PoW.
+    block_header_hash_cache hash_cache;    // The memoized header hash.
 } block_header;
 
 typedef struct Block {
     block_header *header;    // The block header in the format described in the block header section.
     transaction **txns;      // Every transaction in this block, one after another, in raw transaction format.
     unsigned int txn_count;  // The total number of transactions in this block, including the coinbase transaction.
+    merkle_tree *txid_tree;  // The Merkle tree over the txids, kept by append_transaction_into_block(); NULL until then.
+    arena *arena;            // The arena holding the block and its transactions, which frees them; NULL if they are on the heap.
 } block;
 
 typedef struct BlockHeaderShortcut {
     int version;
-    char prev_block_header_hash[65];  // A SHA256(SHA256()) hash in internal byte order of the previous block’s header.
-    char merkle_root_hash[65];        // A SHA256(SHA256()) hash in internal byte order.
-    unsigned int time;                // The block time is a Unix epoch time when the miner started hashing the header (according to the miner).
-    unsigned int nBits;               // An encoded version of the target threshold this block’s header hash must be less than or equal to.
-    unsigned int nonce;               // An arbitrary number miners change to modify the header hash for the PoW.
+    sha256_digest prev_block_header_hash;  // A SHA256(SHA256()) hash in internal byte order of the previous block’s header.
+    sha256_digest merkle_root_hash;        // A SHA256(SHA256()) hash in internal byte order.
+    unsigned int time;                     // The block time is a Unix epoch time when the miner started hashing the header (according to the miner).
+    unsigned int nBits;                    // An encoded version of the target threshold this block’s header hash must be less than or equal to.
+    unsigned int nonce;                    // An arbitrary number miners change to modify the header hash for the PoW.
 } block_header_shortcut;
 
 typedef struct TransactionsShortcut {
@@ -52,30 +65,50 @@ typedef struct BlockCreateShortcut {
  */
 
 typedef struct SocketBlock {
-    int version;                      // The block version number indicates which set of block validation rules to follow.
-    char prev_block_header_hash[65];  // A SHA256(SHA256()) hash in internal byte order of the previous block’s header.
-    char merkle_root_hash[65];        // A SHA256(SHA256()) hash in internal byte order.
-    unsigned int time;                // The block time is a Unix epoch time when the miner started hashing the header (according to the miner).
-    unsigned int nBits;               // An encoded version of the target threshold this block’s header hash must be less than or equal to.
-    unsigned int nonce;               // An arbitrary number miners change to modify the header hash for the PoW.
-    unsigned int txn_count;           // Number of transaction
-    unsigned int txns_size;           // Size of the txns
-    char txns[0];                     // Script of Transactions
+    unsigned char header[BLOCK_HEADER_SERIALIZED_LENGTH];  // The block header, as serialized by serialize_block_header().
+    unsigned int txn_count;                                // Number of transaction
+    unsigned int txns_size;                                // Size of the txns
+    char txns[0];                                          // Script of Transactions
 } socket_block;
 
-char *hash_block_header(block_header *header);
+/*
+ * A read only view over a socket block where it was
+ * received; see view_socket_block(). Its transactions are
+ * viewed one after another, as socket_transaction_view.
+ */
+typedef struct SocketBlockView {
+    const unsigned char *data;  // The socket block.
+    unsigned int txn_count;     // Number of transactions.
+    size_t length;              // Bytes of the socket block, its transactions included.
+} socket_block_view;
+
+void serialize_block_header(block_header *header, unsigned char *dest);
+void deserialize_block_header(const unsigned char *src, block_header *dest);
+sha256_digest hash_block_header(block_header *header);
+void memoize_block_header_hash(block_header *header);
 block *initialize_block_system(bool skip_genesis);
 void destroy_block_system();
 block *create_an_empty_block(unsigned int);
 bool append_prev_block(block *prev_block, block *cur_block);
 bool finalize_block(block *);
-block *get_block_by_hash(char *);
+block *get_block_by_hash(sha256_digest *);
 bool append_transaction_into_block(block *, transaction *, unsigned int input_idx);
+sha256_digest compute_block_merkle_root(block *);
 bool verify_block_chain(block *);
 bool verify_block(block *);
-char *get_genesis_block_hash();
+sha256_digest *get_genesis_block_hash();
 bool create_new_block_shortcut(block_create_shortcut *block_data, block *dest);
 socket_block *cast_to_socket_block(block *);
+void write_socket_block(block *, socket_block *);
 block *cast_to_block(socket_block *);
+bool view_socket_block(const unsigned char *, size_t, socket_block_view *);
+void get_socket_block_view_header(socket_block_view *, block_header *);
+void get_first_socket_block_view_transaction(socket_block_view *, socket_transaction_view *);
+void get_next_socket_block_view_transaction(socket_block_view *, socket_transaction_view *);
+bool verify_socket_block_view(socket_block_view *);
+block *materialize_socket_block(socket_block_view *);
 int get_socket_block_length(block *);
+unsigned int get_serialized_block_size(block *);
+unsigned int serialize_block(block *, unsigned char *);
+block *deserialize_block(const unsigned char *, size_t);
 #endif
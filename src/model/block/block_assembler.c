@@ -0,0 +1,51 @@
+#include "block_assembler.h"
+
+#include <stdlib.h>
+
+#include "utils/constants.h"
+#include "utils/cryptography.h"
+#include "utils/log_utils.h"
+
+#define LOG_SCOPE "block_assembler"
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Assemble a block template from the best transactions of
+ * a mempool, ready to be mined. Transactions come in
+ * priority order, except that every transaction comes
+ * after whatever it spends from in the block. The block
+ * shares its transactions with the pool; once the block
+ * is accepted, hand them over with remove_mempool_block_transactions().
+ * @param pool The mempool.
+ * @param previous_block_header_hash The hash of the header of the block to build on.
+ * @param max_block_size Bytes the block may take, header included, in the raw format.
+ * @param max_txn_count Transactions the block may hold.
+ * @return The block, with its Merkle root set and a nonce of 0.
+ */
+block *assemble_block(mempool *pool, sha256_digest *previous_block_header_hash, unsigned int max_block_size, unsigned int max_txn_count) {
+    // Leave room for the header and the transaction count, a CompactSize of up to 9 bytes.
+    unsigned int overhead = BLOCK_HEADER_SERIALIZED_LENGTH + 9;
+    unsigned int max_txns_size = max_block_size > overhead ? max_block_size - overhead : 0;
+
+    transaction **txns;
+    sha256_digest *txids;
+    unsigned int txn_count = select_mempool_transactions(pool, max_txns_size, max_txn_count, &txns, &txids);
+
+    // The pool already knows every TXID, so the Merkle tree is built in one pass without rehashing a transaction.
+    block *template = create_an_empty_block(0);
+    free(template->txns);
+    template->txns = txns;
+    template->txn_count = txn_count;
+    template->header->nBits = MINING_NBITS;
+    template->header->prev_block_header_hash = *previous_block_header_hash;
+    template->header->merkle_root_hash = compute_merkle_root(txids, txn_count);
+    free(txids);
+
+    general_log(LOG_SCOPE, LOG_INFO, "Assembled a block template of %u transactions.", txn_count);
+    return template;
+}
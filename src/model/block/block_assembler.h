@@ -0,0 +1,9 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_ASSEMBLER_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_ASSEMBLER_H
+
+#include "block.h"
+#include "model/transaction/mempool.h"
+
+block *assemble_block(mempool *, sha256_digest *, unsigned int, unsigned int);
+
+#endif
@@ -0,0 +1,284 @@
+#include "block_miner.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils/log_utils.h"
+#include "utils/sys_utils.h"
+
+#define LOG_SCOPE "miner"
+#define MINING_CHECK_INTERVAL 4096  // Hashes between two looks at the found and cancel flags.
+
+// Everything before the last partial SHA256 block of the
+// serialized header stays the same while nonces are tried.
+#define HEADER_PREFIX_LENGTH (BLOCK_HEADER_SERIALIZED_LENGTH / SHA256_BLOCK_LENGTH * SHA256_BLOCK_LENGTH)
+#define HEADER_TAIL_LENGTH (BLOCK_HEADER_SERIALIZED_LENGTH - HEADER_PREFIX_LENGTH)
+_Static_assert(HEADER_TAIL_LENGTH + 9 <= SHA256_BLOCK_LENGTH, "The header tail and its padding must fit into one SHA256 block.");
+
+typedef struct MiningJob {
+    unsigned int initial_state[8];                // The SHA256 initial state.
+    unsigned int midstate[8];                     // The SHA256 state after the constant header prefix.
+    unsigned char tail[SHA256_BLOCK_LENGTH];      // The padded last block; only the nonce changes.
+    unsigned char target[SHA256_DIGEST_LENGTH];  // Big endian.
+    unsigned int num_of_threads;
+    unsigned long epoch;  // The job is abandoned once g_mining_epoch moves on.
+    atomic_bool found;
+    unsigned int nonce;  // Written once by the thread that sets found.
+    atomic_ullong hashes;
+} mining_job;
+
+typedef struct MiningThread {
+    pthread_t thread;
+    mining_job *job;
+    unsigned int index;  // This thread tries nonces index, index + num_of_threads, ...
+} mining_thread;
+
+static atomic_ulong g_mining_epoch = 0;  // Bumped by cancel_mining().
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Write a word in big endian.
+ * @param dest Four bytes.
+ * @param word The word.
+ */
+static inline void store_be32(unsigned char *dest, unsigned int word) {
+    dest[0] = word >> 24;
+    dest[1] = word >> 16;
+    dest[2] = word >> 8;
+    dest[3] = word;
+}
+
+/**
+ * Hash a header with the given nonce, starting from the
+ * cached midstate: two compressions instead of a full
+ * SHA256(SHA256()) of the header.
+ * @param job The mining job.
+ * @param tail A copy of the job's tail block.
+ * @param second A padded block for the second SHA256.
+ * @param nonce The nonce to try.
+ * @param dest Where the header hash is written into.
+ */
+static inline void hash_header_with_nonce(const mining_job *job, unsigned char *tail, unsigned char *second, unsigned int nonce, sha256_digest *dest) {
+    // The nonce is the last field, in little endian.
+    unsigned char *nonce_bytes = tail + HEADER_TAIL_LENGTH - sizeof(nonce);
+    nonce_bytes[0] = nonce;
+    nonce_bytes[1] = nonce >> 8;
+    nonce_bytes[2] = nonce >> 16;
+    nonce_bytes[3] = nonce >> 24;
+
+    unsigned int state[8];
+    memcpy(state, job->midstate, sizeof(state));
+    sha256_transform(state, tail, 1);
+    for (int i = 0; i < 8; i++) store_be32(second + 4 * i, state[i]);
+
+    memcpy(state, job->initial_state, sizeof(state));
+    sha256_transform(state, second, 1);
+    for (int i = 0; i < 8; i++) store_be32(dest->data + 4 * i, state[i]);
+}
+
+/**
+ * The body of a mining thread.
+ * @param arg The mining_thread of this thread.
+ * @return NULL.
+ */
+static void *mine_nonces(void *arg) {
+    mining_thread *self = (mining_thread *)arg;
+    mining_job *job = self->job;
+
+    unsigned char tail[SHA256_BLOCK_LENGTH];
+    memcpy(tail, job->tail, sizeof(tail));
+    unsigned char second[SHA256_BLOCK_LENGTH] = {0};
+    second[SHA256_DIGEST_LENGTH] = 0x80;
+    second[SHA256_BLOCK_LENGTH - 2] = (SHA256_DIGEST_LENGTH * 8) >> 8;
+
+    sha256_digest hash;
+    unsigned long long hashes = 0;
+    for (unsigned long long nonce = self->index; nonce <= UINT_MAX; nonce += job->num_of_threads) {
+        hash_header_with_nonce(job, tail, second, (unsigned int)nonce, &hash);
+        hashes++;
+
+        if (is_hash_within_target(&hash, job->target)) {
+            bool expected = false;
+            if (atomic_compare_exchange_strong(&job->found, &expected, true)) job->nonce = (unsigned int)nonce;
+            break;
+        }
+
+        if (hashes % MINING_CHECK_INTERVAL == 0 && (atomic_load(&job->found) || atomic_load(&g_mining_epoch) != job->epoch)) break;
+    }
+
+    atomic_fetch_add(&job->hashes, hashes);
+    return NULL;
+}
+
+/**
+ * Try every nonce for a header on many threads, until one
+ * meets the target or mining is cancelled.
+ * @param job The job, whose target, number of threads and epoch are set.
+ * @param header The header to mine; its nonce is ignored.
+ * @return True if a nonce was found, in job->nonce.
+ */
+static bool run_mining_job(mining_job *job, block_header *header) {
+    atomic_init(&job->found, false);
+
+    // Cache the midstate of the constant prefix, and pad
+    // the tail once so that only the nonce changes.
+    unsigned char serialized[BLOCK_HEADER_SERIALIZED_LENGTH];
+    serialize_block_header(header, serialized);
+    sha256_context ctx;
+    sha256_init(&ctx);
+    memcpy(job->initial_state, ctx.state, sizeof(job->initial_state));
+    sha256_update(&ctx, serialized, HEADER_PREFIX_LENGTH);
+    memcpy(job->midstate, ctx.state, sizeof(job->midstate));
+    memset(job->tail, 0, sizeof(job->tail));
+    memcpy(job->tail, serialized + HEADER_PREFIX_LENGTH, HEADER_TAIL_LENGTH);
+    job->tail[HEADER_TAIL_LENGTH] = 0x80;
+    unsigned long long bit_length = (unsigned long long)BLOCK_HEADER_SERIALIZED_LENGTH * 8;
+    for (int i = 0; i < 8; i++) job->tail[SHA256_BLOCK_LENGTH - 1 - i] = bit_length >> (8 * i);
+
+    mining_thread *threads = (mining_thread *)malloc(job->num_of_threads * sizeof(mining_thread));
+    bool *started = (bool *)malloc(job->num_of_threads * sizeof(bool));
+    for (unsigned int i = 0; i < job->num_of_threads; i++) {
+        threads[i].job = job;
+        threads[i].index = i;
+        started[i] = pthread_create(&threads[i].thread, NULL, mine_nonces, &threads[i]) == 0;
+    }
+    for (unsigned int i = 0; i < job->num_of_threads; i++) {
+        // A thread that failed to start has its nonces tried here instead.
+        if (started[i])
+            pthread_join(threads[i].thread, NULL);
+        else
+            mine_nonces(&threads[i]);
+    }
+    free(started);
+    free(threads);
+    return atomic_load(&job->found);
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Decode the compact nBits encoding into a 256-bit target,
+ * i.e., mantissa * 256^(exponent - 3).
+ * @param nBits The compact target.
+ * @param target Where the 32-byte big endian target is written into.
+ * @return True for success, false for a negative, zero or overflowing target.
+ */
+bool decode_compact_target(unsigned int nBits, unsigned char *target) {
+    unsigned int exponent = nBits >> 24;
+    unsigned int mantissa = nBits & 0x007fffff;
+    memset(target, 0, SHA256_DIGEST_LENGTH);
+    if (nBits & 0x00800000) return false;
+
+    bool is_zero = true;
+    for (int i = 0; i < 3; i++) {
+        // The mantissa's bytes, most significant first.
+        unsigned char byte = mantissa >> (8 * (2 - i));
+        int position = SHA256_DIGEST_LENGTH - (int)exponent + i;
+        if (position < 0) {
+            if (byte != 0) return false;
+        } else if (position < SHA256_DIGEST_LENGTH) {
+            target[position] = byte;
+            is_zero = is_zero && byte == 0;
+        }
+    }
+    return !is_zero;
+}
+
+/**
+ * Check a hash against a target. The hash is read as a
+ * big endian number, as printed by convert_digest_to_hex().
+ * @param hash A hash.
+ * @param target A 32-byte big endian target.
+ * @return True if the hash is at or below the target.
+ */
+bool is_hash_within_target(const sha256_digest *hash, const unsigned char *target) { return memcmp(hash->data, target, SHA256_DIGEST_LENGTH) <= 0; }
+
+/**
+ * Check the proof of work of a block header.
+ * @param header A header.
+ * @return True if its hash meets the target in nBits.
+ */
+bool check_block_proof_of_work(block_header *header) {
+    unsigned char target[SHA256_DIGEST_LENGTH];
+    if (!decode_compact_target(header->nBits, target)) return false;
+    sha256_digest hash = hash_block_header(header);
+    return is_hash_within_target(&hash, target);
+}
+
+/**
+ * Search for a nonce that makes the header hash meet the
+ * target in nBits. On success the nonce is stored in the
+ * header. Returns early when cancel_mining() is called.
+ * If all 2^32 nonces fail, the time in the header is moved
+ * on and they are tried again.
+ * @param header The header to mine.
+ * @param num_of_threads Mining threads; 0 uses one per online CPU.
+ * @return What was found and how fast.
+ */
+mining_result mine_block_header(block_header *header, unsigned int num_of_threads) {
+    mining_result result = {.found = false, .nonce = 0, .hashes = 0, .hashes_per_second = 0};
+    mining_job *job = (mining_job *)malloc(sizeof(mining_job));
+    if (!decode_compact_target(header->nBits, job->target)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot mine with invalid nBits %08x.", header->nBits);
+        free(job);
+        return result;
+    }
+
+    if (num_of_threads == 0) {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_of_threads = online_cpus > 0 ? (unsigned int)online_cpus : 1;
+    }
+    job->num_of_threads = num_of_threads;
+    job->epoch = atomic_load(&g_mining_epoch);
+    atomic_init(&job->hashes, 0);
+
+    // Once every nonce fails, a later time makes a new header to try them on.
+    unsigned long start = get_timestamp();
+    while (!run_mining_job(job, header) && atomic_load(&g_mining_epoch) == job->epoch) {
+        unsigned int now = (unsigned int)get_current_unix_time();
+        header->time = now > header->time ? now : header->time + 1;
+        general_log(LOG_SCOPE, LOG_INFO, "Every nonce failed; mining again with time %u.", header->time);
+    }
+    unsigned long elapsed = get_timestamp() - start;
+
+    result.found = atomic_load(&job->found);
+    result.nonce = job->nonce;
+    result.hashes = atomic_load(&job->hashes);
+    result.hashes_per_second = elapsed > 0 ? result.hashes * 1e9 / elapsed : 0;
+
+    if (result.found) {
+        header->nonce = result.nonce;
+        general_log(LOG_SCOPE,
+                    LOG_INFO,
+                    "Mined nonce %u after %llu hashes on %u threads (%.0f hashes/s).",
+                    result.nonce,
+                    result.hashes,
+                    num_of_threads,
+                    result.hashes_per_second);
+    } else {
+        general_log(
+            LOG_SCOPE, LOG_INFO, "Stopped mining without a nonce after %llu hashes (%.0f hashes/s).", result.hashes, result.hashes_per_second);
+    }
+
+    free(job);
+    return result;
+}
+
+/**
+ * Abandon every mining job in progress, e.g., because a
+ * new tip arrived and the header being mined is stale.
+ */
+void cancel_mining() { atomic_fetch_add(&g_mining_epoch, 1); }
@@ -0,0 +1,20 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_MINER_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_MINER_H
+#include <stdbool.h>
+
+#include "block.h"
+
+typedef struct MiningResult {
+    bool found;                 // False if cancelled or nBits is invalid.
+    unsigned int nonce;         // The winning nonce, when found.
+    unsigned long long hashes;  // Headers hashed by all threads together.
+    double hashes_per_second;
+} mining_result;
+
+bool decode_compact_target(unsigned int, unsigned char *);
+bool is_hash_within_target(const sha256_digest *, const unsigned char *);
+bool check_block_proof_of_work(block_header *);
+mining_result mine_block_header(block_header *, unsigned int);
+void cancel_mining();
+
+#endif
@@ -11,15 +11,22 @@
 #define LOG_SCOPE "block_persistence"
 
 static GHashTable *g_global_block_table;  // The global block table that maps block header hash to the block.
+static sha256_digest g_last_block_hash;   // In RAM mode, the header hash of the last block saved; zeros if none.
 block *g_genesis_block = NULL;            // The genesis block.
 
 /**
- * Free the memory space of a block.
+ * Free the memory space of a block. A block decoded by
+ * cast_to_block() goes along with its transactions.
  * @param block_destroy The block to be destroyed.
  * @author Junjian Chen
  */
 void destroy_block(block *block_destroy) {
     if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
+        destroy_merkle_tree(block_destroy->txid_tree);
+        if (block_destroy->arena != NULL) {
+            destroy_arena(block_destroy->arena);
+            return;
+        }
         free(block_destroy->header);
         free(block_destroy);
     } else if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
@@ -77,7 +84,8 @@ bool initialize_block_persistence() {
         sprintf(filtered_query, sql_query, PERSISTENCE_ENGINE, PERSISTENCE_ENGINE);
         return mysql_create_table(filtered_query);
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        g_global_block_table = g_hash_table_new(g_str_hash, g_str_equal);
+        g_global_block_table = g_hash_table_new(hash_digest_key, are_digest_keys_equal);
+        memset(&g_last_block_hash, 0, sizeof(sha256_digest));
         return true;
     }
 
@@ -116,6 +124,11 @@ bool save_block(block *bl) {
 
         // Insert block header.
         block_header *current_header = bl->header;
+        sha256_digest header_hash = hash_block_header(current_header);
+        char header_hash_hex[SHA256_HEX_LENGTH], prev_block_header_hash_hex[SHA256_HEX_LENGTH], merkle_root_hash_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(&header_hash, header_hash_hex);
+        convert_digest_to_hex(&current_header->prev_block_header_hash, prev_block_header_hash_hex);
+        convert_digest_to_hex(&current_header->merkle_root_hash, merkle_root_hash_hex);
         sprintf(sql_query,
                 "set @version = %d;\n"
                 "set @prev_block_header_hash = '%s';\n"
@@ -127,9 +140,9 @@ bool save_block(block *bl) {
                 "insert into block_header(block_h_id, version, block_header_hash, prev_block_header_hash, merkle_root_hash, time, nBits, nonce)\n"
                 "values (@block_h_id, @version, @block_header_hash, @prev_block_header_hash, @merkle_root_hash, @time, @nBits, @nonce);",
                 current_header->version,
-                current_header->prev_block_header_hash,
-                current_header->merkle_root_hash,
-                hash_block_header(current_header),
+                prev_block_header_hash_hex,
+                merkle_root_hash_hex,
+                header_hash_hex,
                 current_header->time,
                 current_header->nBits,
                 current_header->nonce);
@@ -143,18 +156,20 @@ bool save_block(block *bl) {
         unsigned long block_id = get_block_id_in_database(bl);
         for (int i = 0; i < bl->txn_count; i++) {
             transaction *current_transaction = bl->txns[i];
-            char *txid = get_transaction_txid(current_transaction);
-            if (!does_transaction_exist(txid)) {
+            sha256_digest txid = get_transaction_txid(current_transaction);
+            if (!does_transaction_exist(&txid)) {
                 save_transaction(current_transaction);
             }
-            update_transaction_block_id(block_id, txid);
-            free(txid);
+            update_transaction_block_id(block_id, &txid);
         }
 
-        return true;
+        // A block boundary; make the UTXO changes of its transactions durable.
+        return flush_utxo_entries();
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        char *cur_block_hash = hash_block_header(bl->header);
+        sha256_digest *cur_block_hash = (sha256_digest *)malloc(sizeof(sha256_digest));
+        *cur_block_hash = hash_block_header(bl->header);
         g_hash_table_insert(g_global_block_table, cur_block_hash, bl);
+        g_last_block_hash = *cur_block_hash;
         return true;
     }
 
@@ -167,9 +182,11 @@ bool save_block(block *bl) {
  * @return Its block ID.
  */
 unsigned long get_block_id_in_database(block *block) {
-    char *header_hash = hash_block_header(block->header);
+    sha256_digest header_hash = hash_block_header(block->header);
+    char header_hash_hex[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(&header_hash, header_hash_hex);
     char sql_query[1000];
-    sprintf(sql_query, "select block_h_id from block_header where block_header_hash='%s';", header_hash);
+    sprintf(sql_query, "select block_h_id from block_header where block_header_hash='%s';", header_hash_hex);
     MYSQL_RES *res = mysql_read(sql_query);
 
     MYSQL_ROW row;
@@ -177,7 +194,6 @@ unsigned long get_block_id_in_database(block *block) {
     while ((row = mysql_fetch_row(res))) {
         block_header_id = atoi(row[0]);
     }
-    free(header_hash);
     return block_header_id;
 }
 
@@ -187,10 +203,12 @@ unsigned long get_block_id_in_database(block *block) {
  * @return True for exists and false otherwise.
  * @author Luke E
  */
-bool does_block_exist(char *block_header_hash) {
+bool does_block_exist(sha256_digest *block_header_hash) {
+    char block_header_hash_hex[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(block_header_hash, block_header_hash_hex);
     char sql_query[1000];
     memset(sql_query, '\0', 1000);
-    sprintf(sql_query, "select * from block_header where block_header_hash='%s';", block_header_hash);
+    sprintf(sql_query, "select * from block_header where block_header_hash='%s';", block_header_hash_hex);
     MYSQL_RES *res = mysql_read(sql_query);
     bool result = res->row_count > 0;
     mysql_free_result(res);
@@ -203,8 +221,10 @@ bool does_block_exist(char *block_header_hash) {
  * @return The block.
  * @author Luke E
  */
-block *get_block(char *block_header_hash) {
+block *get_block(sha256_digest *block_header_hash) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        char block_header_hash_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(block_header_hash, block_header_hash_hex);
         block *b = (block *)malloc(sizeof(block));
         memset(b, 0, sizeof(block));
         b->header = (block_header *)(malloc(sizeof(block_header)));
@@ -213,17 +233,18 @@ block *get_block(char *block_header_hash) {
         char sql_query[temp_sql_query_size];
 
         // Read block header.
-        sprintf(sql_query, "select * from block_header where block_header_hash='%s';", block_header_hash);
+        sprintf(sql_query, "select * from block_header where block_header_hash='%s';", block_header_hash_hex);
         MYSQL_RES *res = mysql_read(sql_query);
         MYSQL_ROW row = mysql_fetch_row(res);
         unsigned long block_id;
         block_id = atoi(row[0]);
         b->header->version = atoi(row[1]);
-        memcpy(b->header->prev_block_header_hash, row[2], 64);
-        memcpy(b->header->merkle_root_hash, row[3], 64);
+        convert_hex_to_digest(row[2], &b->header->prev_block_header_hash);
+        convert_hex_to_digest(row[3], &b->header->merkle_root_hash);
         b->header->time = atoi(row[4]);
         b->header->nBits = atoi(row[5]);
         b->header->nonce = atoi(row[6]);
+        memoize_block_header_hash(b->header);
         mysql_free_result(res);
         memset(sql_query, 0, temp_sql_query_size);
 
@@ -236,28 +257,23 @@ block *get_block(char *block_header_hash) {
         memset(sql_query, 0, temp_sql_query_size);
 
         // Read associated transactions.
-        char **txids = (char **)malloc(b->txn_count * sizeof(char *));
-        memset(txids, 0, b->txn_count);
-        for (int i = 0; i < b->txn_count; i++) {
-            txids[i] = (char *)malloc(65);
-            memset(txids[i], 0, 65);
-        }
+        sha256_digest *txids = (sha256_digest *)malloc(b->txn_count * sizeof(sha256_digest));
+        memset(txids, 0, b->txn_count * sizeof(sha256_digest));
 
         sprintf(sql_query, "select txid from transaction where block_id=%lu;", block_id);
         res = mysql_read(sql_query);
         int tx_count = 0;
         while ((row = mysql_fetch_row(res))) {
-            memcpy(txids[tx_count], row[0], 64);
+            convert_hex_to_digest(row[0], &txids[tx_count]);
             tx_count++;
         }
         b->txns = (transaction **)malloc(b->txn_count * sizeof(transaction *));
         for (int i = 0; i < b->txn_count; i++) {
-            b->txns[i] = get_transaction(txids[i]);
+            b->txns[i] = get_transaction(&txids[i]);
         }
 
         mysql_free_result(res);
         memset(sql_query, 0, temp_sql_query_size);
-        for (int i = 0; i < b->txn_count; i++) free(txids[i]);
         free(txids);
 
         return b;
@@ -281,14 +297,13 @@ block *get_genesis_block() {
         MYSQL_RES *res = mysql_read(sql_query);
 
         MYSQL_ROW row;
-        char genesis_block_header_id[65];
-        genesis_block_header_id[64] = '\0';
+        sha256_digest genesis_block_header_id;
         while ((row = mysql_fetch_row(res))) {
-            strcpy(genesis_block_header_id, row[0]);
+            convert_hex_to_digest(row[0], &genesis_block_header_id);
         }
 
         mysql_free_result(res);
-        block *genesis_block = get_block(genesis_block_header_id);
+        block *genesis_block = get_block(&genesis_block_header_id);
         g_genesis_block = genesis_block;
         return g_genesis_block;
     }
@@ -344,25 +359,36 @@ unsigned int get_total_number_of_blocks() {
 };
 
 /**
- * Get last inserted block from the database.
- * @return A block.
- * @author Ing Tian
+ * Get the header hash of the last block saved, the tip
+ * of the chain.
+ * @return The hash, or zeros if no block is saved.
  */
-block *get_last_inserted_block() {
-    unsigned int last_block_idx = get_total_number_of_blocks();
+sha256_digest get_last_inserted_block_hash() {
+    sha256_digest last_block_hash;
+    memset(&last_block_hash, 0, sizeof(sha256_digest));
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        char sql_query[1000];
+        sprintf(sql_query, "select block_header_hash from block_header where block_h_id=%u;", get_total_number_of_blocks());
+        MYSQL_RES *res = mysql_read(sql_query);
 
-    char sql_query[1000];
-    sprintf(sql_query, "select block_header_hash from block_header where block_h_id=%u;", last_block_idx);
-    MYSQL_RES *res = mysql_read(sql_query);
+        MYSQL_ROW row;
+        while ((row = mysql_fetch_row(res))) {
+            convert_hex_to_digest(row[0], &last_block_hash);
+        }
 
-    MYSQL_ROW row;
-    char temp_header_id[65];
-    temp_header_id[64] = '\0';
-    while ((row = mysql_fetch_row(res))) {
-        strcpy(temp_header_id, row[0]);
+        mysql_free_result(res);
+    } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
+        last_block_hash = g_last_block_hash;
     }
+    return last_block_hash;
+}
 
-    mysql_free_result(res);
-    block *blk = get_block(temp_header_id);
-    return blk;
+/**
+ * Get last inserted block from the database.
+ * @return A block.
+ * @author Ing Tian
+ */
+block *get_last_inserted_block() {
+    sha256_digest last_block_hash = get_last_inserted_block_hash();
+    return get_block(&last_block_hash);
 }
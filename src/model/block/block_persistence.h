@@ -6,10 +6,11 @@
 
 bool initialize_block_persistence();
 bool save_block(block *);
-bool does_block_exist(char *);
-block *get_block(char *);
+bool does_block_exist(sha256_digest *);
+block *get_block(sha256_digest *);
 block *get_genesis_block();
 block *get_last_inserted_block();
+sha256_digest get_last_inserted_block_hash();
 unsigned long get_block_id_in_database(block *);
 void destroy_block(block *);
 bool destroy_block_persistence();
@@ -0,0 +1,525 @@
+#include "block_validator.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "model/transaction/flat_transaction.h"
+#include "model/transaction/transaction_persistence.h"
+#include "utils/constants.h"
+#include "utils/log_utils.h"
+
+#define LOG_SCOPE "block validator"
+
+/*
+ * The transactions of a block, linked by who spends whose
+ * outputs. A transaction becomes ready once every parent in
+ * the block has been checked; ready transactions sit in the
+ * deque of one thread, which takes the newest from the back
+ * while idle threads steal the oldest from the front.
+ */
+typedef struct ValidationDeque {
+    pthread_mutex_t lock;
+    unsigned int *items;  // A ring of transaction indices.
+    unsigned int head;    // Stolen from here.
+    unsigned int tail;    // Pushed and popped here by the owner.
+} validation_deque;
+
+typedef struct ValidationJob {
+    unsigned int txn_count;
+    flat_transaction *flat_block;  // The transactions of the block packed one after another.
+    flat_transaction **flat_txns;  // Where each transaction starts in flat_block.
+    utxo_table *txid_indices;      // The index of every transaction in the block, keyed by TXID and output index 0.
+    unsigned int *check_offsets;   // Where the signature checks of each transaction start.
+    signature_check *checks;       // One per input of the block.
+    unsigned int *child_offsets;   // Children of transaction i are children[child_offsets[i]..child_offsets[i + 1]).
+    unsigned int *children;        // One per input spending an earlier transaction of the block.
+    atomic_uint *pending_parents;  // In-block parents of each transaction not yet checked.
+    validation_deque *deques;      // One per thread.
+    unsigned int num_of_threads;
+    atomic_uint remaining;      // Transactions not yet checked or skipped.
+    atomic_uint first_failure;  // The lowest invalid transaction; txn_count while none.
+    atomic_uint queued;         // Transactions sitting in the deques.
+    atomic_uint sleepers;       // Threads waiting for a transaction to become ready.
+    pthread_mutex_t idle_lock;
+    pthread_cond_t work_ready;  // Signalled when a transaction is queued or none remain.
+} validation_job;
+
+typedef struct BlockValidatorWorker {
+    pthread_t thread;
+    unsigned int index;             // Its deque in a job; the calling thread has deque 0.
+    unsigned long seen_generation;  // The last job this worker picked up.
+} block_validator_worker;
+
+// Thread pool
+static block_validator_worker *g_workers = NULL;
+static unsigned int g_num_of_workers = 0;
+static bool g_shutting_down = false;
+
+// The job in progress. Only one job runs at a time; the
+// calling thread checks alongside the workers.
+static pthread_mutex_t g_submit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_job_done = PTHREAD_COND_INITIALIZER;
+static unsigned long g_job_generation = 0;
+static unsigned int g_busy_workers = 0;
+static validation_job *g_job;
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Find the transaction of the block an outpoint refers to.
+ * @param job The job.
+ * @param key The outpoint.
+ * @param index Where the index of the transaction is written into.
+ * @return True if it is in the block, false otherwise.
+ */
+static bool find_block_transaction(validation_job *job, const utxo_key *key, unsigned int *index) {
+    utxo_key txid_key = *key;
+    txid_key.index = 0;
+    long int value;
+    if (!get_utxo_table_entry(job->txid_indices, &txid_key, &value)) return false;
+    *index = (unsigned int)value;
+    return true;
+}
+
+/**
+ * Check everything about a transaction of a block except
+ * its signatures, which are collected. An input may spend
+ * an output of an earlier transaction of the same block.
+ * @param job The job.
+ * @param txn_idx The transaction.
+ * @return True for valid so far, false otherwise.
+ */
+static bool check_block_transaction(validation_job *job, unsigned int txn_idx) {
+    flat_transaction *t = job->flat_txns[txn_idx];
+    signature_check *checks = job->checks + job->check_offsets[txn_idx];
+    unsigned long input_sum = 0, output_sum = 0;
+    if (!t->well_formed) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Transaction %u has an invalid outpoint or a script that is too long.", txn_idx);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < t->tx_in_count; i++) {
+        flat_transaction_input *input = get_flat_transaction_input(t, i);
+        utxo_key *key = &input->previous_outpoint;
+        flat_transaction_output external_output;
+        flat_transaction_output *previous_output;
+        unsigned int previous_idx;
+        if (find_block_transaction(job, key, &previous_idx)) {
+            if (previous_idx >= txn_idx) {
+                general_log(
+                    LOG_SCOPE, LOG_ERROR, "Transaction %u spends an output of transaction %u, which does not come before it.", txn_idx, previous_idx);
+                return false;
+            }
+            flat_transaction *previous_transaction = job->flat_txns[previous_idx];
+            if (key->index >= previous_transaction->tx_out_count) {
+                general_log(LOG_SCOPE,
+                            LOG_ERROR,
+                            "The output index (%u) is bigger than the output size (%u).",
+                            key->index,
+                            previous_transaction->tx_out_count);
+                return false;
+            }
+            previous_output = get_flat_transaction_output(previous_transaction, key->index);
+        } else {
+            sha256_digest previous_txid;
+            memcpy(previous_txid.data, key->txid, SHA256_DIGEST_LENGTH);
+            transaction *previous_transaction = get_transaction(&previous_txid);
+            if (previous_transaction == NULL) {
+                general_log(LOG_SCOPE, LOG_ERROR, "Could not find previous transaction");
+                return false;
+            }
+            if (key->index >= previous_transaction->tx_out_count) {
+                general_log(LOG_SCOPE,
+                            LOG_ERROR,
+                            "The output index (%u) is bigger than the output size (%u).",
+                            key->index,
+                            previous_transaction->tx_out_count);
+                release_transaction(previous_transaction);
+                return false;
+            }
+            bool flattened = flatten_transaction_output(&previous_transaction->tx_outs[key->index], &external_output);
+            release_transaction(previous_transaction);
+            if (!flattened) {
+                general_log(LOG_SCOPE, LOG_ERROR, "The script of the output spent by transaction %u is too long.", txn_idx);
+                return false;
+            }
+            previous_output = &external_output;
+        }
+
+        get_flat_transaction_input_signature_check(input, previous_output, &checks[i]);
+        input_sum += previous_output->value;
+    }
+
+    for (unsigned int i = 0; i < t->tx_out_count; i++) output_sum += get_flat_transaction_output(t, i)->value;
+    if (input_sum != output_sum) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Transaction verify: Input sum (%ld) does not equal to output sum (%ld).", input_sum, output_sum);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Remember an invalid transaction, keeping only the lowest index.
+ * @param job The job.
+ * @param txn_idx The transaction.
+ */
+static void record_failure(validation_job *job, unsigned int txn_idx) {
+    unsigned int current = atomic_load(&job->first_failure);
+    while (txn_idx < current && !atomic_compare_exchange_weak(&job->first_failure, &current, txn_idx)) {
+    }
+}
+
+/**
+ * Wake a thread waiting for a ready transaction, if any.
+ * @param job The job.
+ * @param all Whether to wake every waiting thread, as once none remain.
+ */
+static void wake_validation_threads(validation_job *job, bool all) {
+    if (atomic_load(&job->sleepers) == 0) return;
+    pthread_mutex_lock(&job->idle_lock);
+    if (all)
+        pthread_cond_broadcast(&job->work_ready);
+    else
+        pthread_cond_signal(&job->work_ready);
+    pthread_mutex_unlock(&job->idle_lock);
+}
+
+static void push_deque(validation_job *job, unsigned int deque_idx, unsigned int txn_idx) {
+    validation_deque *deque = &job->deques[deque_idx];
+    pthread_mutex_lock(&deque->lock);
+    deque->items[deque->tail++ % job->txn_count] = txn_idx;
+    pthread_mutex_unlock(&deque->lock);
+    atomic_fetch_add(&job->queued, 1);
+    wake_validation_threads(job, false);
+}
+
+/**
+ * Take a transaction from a deque.
+ * @param job The job.
+ * @param deque_idx The deque.
+ * @param steal Whether to take the oldest, as a thief, or the newest, as the owner.
+ * @param txn_idx Where the transaction is written into.
+ * @return True if there was one, false otherwise.
+ */
+static bool pop_deque(validation_job *job, unsigned int deque_idx, bool steal, unsigned int *txn_idx) {
+    validation_deque *deque = &job->deques[deque_idx];
+    unsigned int capacity = job->txn_count;
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->head != deque->tail;
+    if (found) *txn_idx = steal ? deque->items[deque->head++ % capacity] : deque->items[--deque->tail % capacity];
+    pthread_mutex_unlock(&deque->lock);
+    if (found) atomic_fetch_sub(&job->queued, 1);
+    return found;
+}
+
+/**
+ * Block until a transaction is queued or none remain.
+ * @param job The job.
+ */
+static void wait_for_ready_transaction(validation_job *job) {
+    pthread_mutex_lock(&job->idle_lock);
+    // A pusher either sees this thread asleep or is seen to have queued.
+    atomic_fetch_add(&job->sleepers, 1);
+    while (atomic_load(&job->queued) == 0 && atomic_load(&job->remaining) > 0) pthread_cond_wait(&job->work_ready, &job->idle_lock);
+    atomic_fetch_sub(&job->sleepers, 1);
+    pthread_mutex_unlock(&job->idle_lock);
+}
+
+/**
+ * Check ready transactions, from its own deque first and
+ * stolen from the others otherwise, until none are left.
+ * Once a transaction is known to be invalid, later ones are
+ * skipped, since the block is rejected either way.
+ * @param job The job.
+ * @param index The deque of this thread.
+ */
+static void run_validation(validation_job *job, unsigned int index) {
+    while (atomic_load(&job->remaining) > 0) {
+        unsigned int txn_idx;
+        bool found = pop_deque(job, index, false, &txn_idx);
+        for (unsigned int i = 1; !found && i < job->num_of_threads; i++) found = pop_deque(job, (index + i) % job->num_of_threads, true, &txn_idx);
+        if (!found) {
+            // Whatever is left waits for parents being checked elsewhere.
+            wait_for_ready_transaction(job);
+            continue;
+        }
+
+        if (txn_idx < atomic_load(&job->first_failure) && !check_block_transaction(job, txn_idx)) record_failure(job, txn_idx);
+
+        // Children of an invalid transaction come after it, so they are skipped rather than stranded.
+        for (unsigned int i = job->child_offsets[txn_idx]; i < job->child_offsets[txn_idx + 1]; i++) {
+            unsigned int child = job->children[i];
+            if (atomic_fetch_sub(&job->pending_parents[child], 1) == 1) push_deque(job, index, child);
+        }
+        if (atomic_fetch_sub(&job->remaining, 1) == 1) wake_validation_threads(job, true);
+    }
+}
+
+/**
+ * The body of a worker thread: wait for a job, help
+ * finish it, report back, repeat.
+ * @param arg The block_validator_worker of this thread.
+ * @return NULL.
+ */
+static void *worker_main(void *arg) {
+    block_validator_worker *worker = (block_validator_worker *)arg;
+    pthread_mutex_lock(&g_pool_lock);
+    while (true) {
+        while (worker->seen_generation == g_job_generation && !g_shutting_down) pthread_cond_wait(&g_job_ready, &g_pool_lock);
+        if (g_shutting_down) break;
+        worker->seen_generation = g_job_generation;
+        validation_job *job = g_job;
+        pthread_mutex_unlock(&g_pool_lock);
+
+        // A job may ask for fewer threads than the pool has.
+        if (worker->index < job->num_of_threads) run_validation(job, worker->index);
+
+        pthread_mutex_lock(&g_pool_lock);
+        if (--g_busy_workers == 0) pthread_cond_signal(&g_job_done);
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+    return NULL;
+}
+
+/**
+ * Check the transactions of a job across the thread pool.
+ * @param job The job, with its dependency graph built and its deques filled.
+ */
+static void run_validation_job(validation_job *job) {
+    pthread_mutex_lock(&g_submit_lock);
+
+    pthread_mutex_lock(&g_pool_lock);
+    g_job = job;
+    g_busy_workers = g_num_of_workers;
+    g_job_generation++;
+    pthread_cond_broadcast(&g_job_ready);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    run_validation(job, 0);
+
+    pthread_mutex_lock(&g_pool_lock);
+    while (g_busy_workers > 0) pthread_cond_wait(&g_job_done, &g_pool_lock);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    pthread_mutex_unlock(&g_submit_lock);
+}
+
+/**
+ * Link every transaction of a block to the earlier
+ * transactions of the block whose outputs it spends.
+ * @param job The job, whose txid_indices is filled in.
+ */
+static void build_dependency_graph(validation_job *job) {
+    unsigned int txn_count = job->txn_count;
+    unsigned int *parents = (unsigned int *)malloc((job->check_offsets[txn_count] + 1) * sizeof(unsigned int));
+    memset(job->child_offsets, 0, (txn_count + 1) * sizeof(unsigned int));
+
+    // Count the children of each transaction, remembering the parent of each input.
+    for (unsigned int i = 0; i < txn_count; i++) {
+        atomic_init(&job->pending_parents[i], 0);
+        flat_transaction *t = job->flat_txns[i];
+        for (unsigned int j = 0; j < t->tx_in_count; j++) {
+            unsigned int *parent = &parents[job->check_offsets[i] + j];
+            *parent = txn_count;
+            if (!t->well_formed) continue;
+            if (!find_block_transaction(job, &get_flat_transaction_input(t, j)->previous_outpoint, parent) || *parent >= i) {
+                *parent = txn_count;  // Not an earlier transaction; check_block_transaction() rejects a later one.
+                continue;
+            }
+            job->child_offsets[*parent + 1]++;
+            atomic_fetch_add(&job->pending_parents[i], 1);
+        }
+    }
+    for (unsigned int i = 0; i < txn_count; i++) job->child_offsets[i + 1] += job->child_offsets[i];
+
+    // Fill the children in, reusing the offsets as cursors.
+    job->children = (unsigned int *)malloc((job->child_offsets[txn_count] + 1) * sizeof(unsigned int));
+    unsigned int *cursors = (unsigned int *)malloc((txn_count + 1) * sizeof(unsigned int));
+    memcpy(cursors, job->child_offsets, (txn_count + 1) * sizeof(unsigned int));
+    for (unsigned int i = 0; i < txn_count; i++) {
+        for (unsigned int j = 0; j < job->flat_txns[i]->tx_in_count; j++) {
+            unsigned int parent = parents[job->check_offsets[i] + j];
+            if (parent < txn_count) job->children[cursors[parent]++] = i;
+        }
+    }
+    free(cursors);
+    free(parents);
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Start the block validator. Replaces a running one.
+ * @param num_of_threads Threads checking a block, the calling
+ * thread included. 0 uses one thread per online CPU.
+ * @return True for success, false otherwise.
+ */
+bool initialize_block_validator(unsigned int num_of_threads) {
+    if (g_workers != NULL) destroy_block_validator();
+
+    if (num_of_threads == 0) {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_of_threads = online_cpus > 0 ? (unsigned int)online_cpus : 1;
+    }
+
+    g_workers = (block_validator_worker *)calloc(num_of_threads, sizeof(block_validator_worker));
+    for (g_num_of_workers = 0; g_num_of_workers < num_of_threads - 1; g_num_of_workers++) {
+        block_validator_worker *worker = &g_workers[g_num_of_workers];
+        worker->index = g_num_of_workers + 1;
+        worker->seen_generation = g_job_generation;
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Failed to start block validator worker %u.", g_num_of_workers);
+            destroy_block_validator();
+            return false;
+        }
+    }
+
+    general_log(LOG_SCOPE, LOG_INFO, "Initialized the block validator with %u threads.", num_of_threads);
+    return true;
+}
+
+/**
+ * Stop the worker threads.
+ */
+void destroy_block_validator() {
+    pthread_mutex_lock(&g_pool_lock);
+    g_shutting_down = true;
+    pthread_cond_broadcast(&g_job_ready);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    for (unsigned int i = 0; i < g_num_of_workers; i++) pthread_join(g_workers[i].thread, NULL);
+    free(g_workers);
+    g_workers = NULL;
+    g_num_of_workers = 0;
+    g_shutting_down = false;
+}
+
+/**
+ * Get the number of threads checking a block.
+ * @return The number of threads, the calling thread included.
+ */
+unsigned int get_block_validator_threads() { return g_num_of_workers + 1; }
+
+/**
+ * Check everything about the transactions of a block except
+ * their signatures, which are collected for verify_signatures().
+ * A transaction may spend outputs of earlier transactions of
+ * the block. Transactions are checked in parallel, each once
+ * the transactions it spends from are; the result is the same
+ * as checking them one after another.
+ * @param b The block.
+ * @param num_of_threads Threads checking, the calling thread included, at most
+ * as many as the block validator has; 0 uses all of them. With MySQL persistence,
+ * only the calling thread checks.
+ * @param checks Where the signature checks are written into, one per input of the block, in order.
+ * @return The index of the first invalid transaction, or -1 if all are valid so far.
+ */
+long prepare_block_transaction_checks(block *b, unsigned int num_of_threads, signature_check *checks) {
+    flat_transaction *flat_block = flatten_transactions(b->txns, b->txn_count);
+    long result = prepare_flat_block_transaction_checks(flat_block, b->txn_count, num_of_threads, checks);
+    free(flat_block);
+    return result;
+}
+
+/**
+ * Check everything about the transactions of a block except
+ * their signatures, as prepare_block_transaction_checks()
+ * does, on the transactions already packed.
+ * @param flat_block The transactions of the block, packed one after another.
+ * @param txn_count Number of transactions.
+ * @param num_of_threads Threads checking, as for prepare_block_transaction_checks().
+ * @param checks Where the signature checks are written into, one per input of the block, in order.
+ * @return The index of the first invalid transaction, or -1 if all are valid so far.
+ */
+long prepare_flat_block_transaction_checks(flat_transaction *flat_block,
+                                           unsigned int txn_count,
+                                           unsigned int num_of_threads,
+                                           signature_check *checks) {
+    if (num_of_threads == 0 || num_of_threads > get_block_validator_threads()) num_of_threads = get_block_validator_threads();
+    // The MySQL connection is shared and cannot be used by many threads at once.
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL || txn_count < BLOCK_VALIDATOR_MIN_PARALLEL) num_of_threads = 1;
+
+    // Everything below walks the packed transactions, one after another.
+    validation_job job = {.txn_count = txn_count, .flat_block = flat_block, .checks = checks, .num_of_threads = num_of_threads};
+    job.flat_txns = (flat_transaction **)malloc((txn_count + 1) * sizeof(flat_transaction *));
+    job.check_offsets = (unsigned int *)malloc((txn_count + 1) * sizeof(unsigned int));
+    job.check_offsets[0] = 0;
+    flat_transaction *current = job.flat_block;
+    for (unsigned int i = 0; i < txn_count; i++, current = get_next_flat_transaction(current)) {
+        job.flat_txns[i] = current;
+        job.check_offsets[i + 1] = job.check_offsets[i] + current->tx_in_count;
+    }
+
+    // The first of duplicate TXIDs is the one spent from, as when checking one after another.
+    job.txid_indices = create_utxo_table(txn_count);
+    for (unsigned int i = 0; i < txn_count; i++) {
+        utxo_key key = {.index = 0};
+        memcpy(key.txid, job.flat_txns[i]->txid.data, SHA256_DIGEST_LENGTH);
+        if (!get_utxo_table_entry(job.txid_indices, &key, NULL)) put_utxo_table_entry(job.txid_indices, &key, i);
+    }
+
+    long result = -1;
+    if (num_of_threads == 1) {
+        for (unsigned int i = 0; i < txn_count && result < 0; i++) {
+            if (!check_block_transaction(&job, i)) result = i;
+        }
+        destroy_utxo_table(job.txid_indices);
+        free(job.check_offsets);
+        free(job.flat_txns);
+        return result;
+    }
+
+    job.child_offsets = (unsigned int *)malloc((txn_count + 1) * sizeof(unsigned int));
+    job.pending_parents = (atomic_uint *)malloc((txn_count + 1) * sizeof(atomic_uint));
+    build_dependency_graph(&job);
+    atomic_init(&job.remaining, txn_count);
+    atomic_init(&job.first_failure, txn_count);
+    atomic_init(&job.queued, 0);
+    atomic_init(&job.sleepers, 0);
+    pthread_mutex_init(&job.idle_lock, NULL);
+    pthread_cond_init(&job.work_ready, NULL);
+
+    // Hand the transactions without parents in the block out round robin, lowest on top.
+    job.deques = (validation_deque *)malloc(num_of_threads * sizeof(validation_deque));
+    for (unsigned int i = 0; i < num_of_threads; i++) {
+        pthread_mutex_init(&job.deques[i].lock, NULL);
+        job.deques[i].items = (unsigned int *)malloc(txn_count * sizeof(unsigned int));
+        job.deques[i].head = job.deques[i].tail = 0;
+    }
+    for (unsigned int i = txn_count, next = 0; i-- > 0;) {
+        if (atomic_load(&job.pending_parents[i]) == 0) push_deque(&job, next++ % num_of_threads, i);
+    }
+
+    run_validation_job(&job);
+
+    unsigned int first_failure = atomic_load(&job.first_failure);
+    if (first_failure < txn_count) result = first_failure;
+
+    for (unsigned int i = 0; i < num_of_threads; i++) {
+        pthread_mutex_destroy(&job.deques[i].lock);
+        free(job.deques[i].items);
+    }
+    pthread_cond_destroy(&job.work_ready);
+    pthread_mutex_destroy(&job.idle_lock);
+    free(job.deques);
+    free(job.children);
+    free(job.pending_parents);
+    free(job.child_offsets);
+    destroy_utxo_table(job.txid_indices);
+    free(job.check_offsets);
+    free(job.flat_txns);
+    return result;
+}
@@ -0,0 +1,17 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_VALIDATOR_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_BLOCK_BLOCK_VALIDATOR_H
+
+#include <stdbool.h>
+
+#include "block.h"
+#include "model/transaction/flat_transaction.h"
+
+#define BLOCK_VALIDATOR_MIN_PARALLEL 64  // Smaller blocks are validated on the calling thread alone.
+
+bool initialize_block_validator(unsigned int);
+void destroy_block_validator();
+unsigned int get_block_validator_threads();
+long prepare_block_transaction_checks(block *, unsigned int, signature_check *);
+long prepare_flat_block_transaction_checks(flat_transaction *, unsigned int, unsigned int, signature_check *);
+
+#endif
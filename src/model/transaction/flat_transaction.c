@@ -0,0 +1,189 @@
+#include "flat_transaction.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ALIGN_FLAT(size) (((size) + FLAT_TRANSACTION_ALIGNMENT - 1) / FLAT_TRANSACTION_ALIGNMENT * FLAT_TRANSACTION_ALIGNMENT)
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Copy a script inline, padding it with zeros, which is
+ * how get_transaction_input_signature_check() reads it too.
+ * @param dest FLAT_TRANSACTION_SCRIPT_LENGTH bytes.
+ * @param script The script.
+ * @param length Its length; only what fits is copied.
+ */
+static void copy_flat_script(unsigned char *dest, const char *script, unsigned int length) {
+    if (length > FLAT_TRANSACTION_SCRIPT_LENGTH) length = FLAT_TRANSACTION_SCRIPT_LENGTH;
+    memcpy(dest, script, length);
+    memset(dest + length, 0, FLAT_TRANSACTION_SCRIPT_LENGTH - length);
+}
+
+static size_t get_flat_inputs_offset() { return ALIGN_FLAT(sizeof(flat_transaction)); }
+
+static size_t get_flat_outputs_offset(unsigned int tx_in_count) {
+    return get_flat_inputs_offset() + ALIGN_FLAT(tx_in_count * sizeof(flat_transaction_input));
+}
+
+/**
+ * Pack a transaction into a buffer.
+ * @param t A transaction.
+ * @param dest At least get_flat_transaction_size() bytes, aligned.
+ */
+static void flatten_transaction(transaction *t, flat_transaction *dest) {
+    dest->size = get_flat_transaction_size(t->tx_in_count, t->tx_out_count);
+    dest->version = t->version;
+    dest->tx_in_count = t->tx_in_count;
+    dest->tx_out_count = t->tx_out_count;
+    dest->lock_time = t->lock_time;
+    dest->well_formed = true;
+    dest->txid = get_transaction_txid(t);
+
+    for (unsigned int i = 0; i < t->tx_in_count; i++) {
+        transaction_input *input = &t->tx_ins[i];
+        flat_transaction_input *flat_input = get_flat_transaction_input(dest, i);
+        get_outpoint_utxo_key(&input->previous_outpoint, &flat_input->previous_outpoint);
+        flat_input->sequence = input->sequence;
+        flat_input->script_bytes = input->script_bytes;
+        if (input->script_bytes > FLAT_TRANSACTION_SCRIPT_LENGTH) dest->well_formed = false;
+        copy_flat_script(flat_input->signature_script, input->signature_script, input->script_bytes);
+    }
+    for (unsigned int i = 0; i < t->tx_out_count; i++) {
+        if (!flatten_transaction_output(&t->tx_outs[i], get_flat_transaction_output(dest, i))) dest->well_formed = false;
+    }
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Get the bytes a flat transaction takes.
+ * @param tx_in_count Number of inputs.
+ * @param tx_out_count Number of outputs.
+ * @return Bytes, a multiple of FLAT_TRANSACTION_ALIGNMENT.
+ */
+size_t get_flat_transaction_size(unsigned int tx_in_count, unsigned int tx_out_count) {
+    return get_flat_outputs_offset(tx_in_count) + ALIGN_FLAT(tx_out_count * sizeof(flat_transaction_output));
+}
+
+/**
+ * Pack transactions one after another into a single buffer.
+ * @param txns The transactions.
+ * @param txn_count Number of transactions.
+ * @return The first flat transaction, at the start of a new buffer
+ * the caller frees; get_next_flat_transaction() walks the others.
+ */
+flat_transaction *flatten_transactions(transaction **txns, unsigned int txn_count) {
+    size_t size = 0;
+    for (unsigned int i = 0; i < txn_count; i++) size += get_flat_transaction_size(txns[i]->tx_in_count, txns[i]->tx_out_count);
+
+    flat_transaction *first = (flat_transaction *)malloc(size > 0 ? size : 1);
+    flat_transaction *current = first;
+    for (unsigned int i = 0; i < txn_count; i++) {
+        flatten_transaction(txns[i], current);
+        current = get_next_flat_transaction(current);
+    }
+    return first;
+}
+
+/**
+ * Pack a viewed socket transaction, straight from where it
+ * was received. Its scripts, which the view checked, fit inline.
+ * @param view A view of a socket transaction.
+ * @param dest At least get_flat_transaction_size() bytes, aligned.
+ */
+void flatten_socket_transaction_view(socket_transaction_view *view, flat_transaction *dest) {
+    dest->size = get_flat_transaction_size(view->tx_in_count, view->tx_out_count);
+    dest->version = view->version;
+    dest->tx_in_count = view->tx_in_count;
+    dest->tx_out_count = view->tx_out_count;
+    dest->lock_time = view->lock_time;
+    dest->well_formed = true;
+    dest->txid = get_socket_transaction_view_txid(view);
+
+    for (unsigned int i = 0; i < view->tx_in_count; i++) {
+        transaction_input_view input;
+        get_socket_transaction_view_input(view, i, &input);
+        flat_transaction_input *flat_input = get_flat_transaction_input(dest, i);
+        memcpy(flat_input->previous_outpoint.txid, input.previous_txid, SHA256_DIGEST_LENGTH);
+        flat_input->previous_outpoint.index = input.previous_index;
+        flat_input->sequence = input.sequence;
+        flat_input->script_bytes = input.script_bytes;
+        copy_flat_script(flat_input->signature_script, (const char *)input.signature_script, input.script_bytes);
+    }
+    for (unsigned int i = 0; i < view->tx_out_count; i++) {
+        transaction_output_view output;
+        get_socket_transaction_view_output(view, i, &output);
+        flat_transaction_output *flat_output = get_flat_transaction_output(dest, i);
+        flat_output->value = output.value;
+        flat_output->pk_script_bytes = output.pk_script_bytes;
+        copy_flat_script(flat_output->pk_script, (const char *)output.pk_script, output.pk_script_bytes);
+    }
+}
+
+/**
+ * Pack a transaction output.
+ * @param output A transaction output.
+ * @param dest Where the flat output is written into.
+ * @return True for success, false if its script does not fit inline.
+ */
+bool flatten_transaction_output(transaction_output *output, flat_transaction_output *dest) {
+    dest->value = output->value;
+    dest->pk_script_bytes = output->pk_script_bytes;
+    copy_flat_script(dest->pk_script, output->pk_script, output->pk_script_bytes);
+    if (output->pk_script_bytes <= FLAT_TRANSACTION_SCRIPT_LENGTH) return true;
+    dest->pk_script_bytes = FLAT_TRANSACTION_SCRIPT_LENGTH;
+    return false;
+}
+
+/**
+ * Get the flat transaction following another in a buffer.
+ * @param t A flat transaction.
+ * @return Where the next one starts.
+ */
+flat_transaction *get_next_flat_transaction(flat_transaction *t) { return (flat_transaction *)((unsigned char *)t + t->size); }
+
+flat_transaction_input *get_flat_transaction_input(flat_transaction *t, unsigned int index) {
+    return (flat_transaction_input *)((unsigned char *)t + get_flat_inputs_offset()) + index;
+}
+
+flat_transaction_output *get_flat_transaction_output(flat_transaction *t, unsigned int index) {
+    return (flat_transaction_output *)((unsigned char *)t + get_flat_outputs_offset(t->tx_in_count)) + index;
+}
+
+/**
+ * Get the SHA256 hashcode of a flat transaction output,
+ * the same as that of the output it was packed from.
+ * @param output A flat transaction output.
+ * @return The SHA256 hashcode.
+ */
+sha256_digest hash_flat_transaction_output(flat_transaction_output *output) {
+    sha256_digest result;
+    sha256_context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, &output->value, sizeof(output->value));
+    sha256_update(&ctx, &output->pk_script_bytes, sizeof(output->pk_script_bytes));
+    sha256_update(&ctx, output->pk_script, output->pk_script_bytes);
+    sha256_final(&ctx, &result);
+    return result;
+}
+
+/**
+ * Collect what checking the signature of a flat input needs.
+ * @param i A flat transaction input.
+ * @param previous_output The output it spends.
+ * @param check Where the signature check is written into.
+ */
+void get_flat_transaction_input_signature_check(flat_transaction_input *i, flat_transaction_output *previous_output, signature_check *check) {
+    check->msg_hash = hash_flat_transaction_output(previous_output);
+    memcpy(check->public_key.data, previous_output->pk_script, 64);
+    memcpy(check->signature.data, i->signature_script, 64);
+}
@@ -0,0 +1,52 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_FLAT_TRANSACTION_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_FLAT_TRANSACTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "transaction.h"
+
+#define FLAT_TRANSACTION_SCRIPT_LENGTH 64  // Inline room for a script, as in socket transactions.
+#define FLAT_TRANSACTION_ALIGNMENT 8       // Inputs, outputs and consecutive transactions start on this boundary.
+
+/*
+ * A transaction packed into one buffer: this header, its
+ * inputs, then its outputs, scripts and binary outpoints
+ * inline. The transactions of a block follow one another,
+ * so walking them is a linear scan. Read only; built from
+ * a transaction by flatten_transactions().
+ */
+typedef struct FlatTransactionInput {
+    utxo_key previous_outpoint;  // The outpoint spent, with its TXID in binary.
+    unsigned int sequence;       // Sequence number.
+    unsigned int script_bytes;   // The number of bytes in the signature script.
+    unsigned char signature_script[FLAT_TRANSACTION_SCRIPT_LENGTH];
+} flat_transaction_input;
+
+typedef struct FlatTransactionOutput {
+    long int value;                // Number of crypto to spend.
+    unsigned int pk_script_bytes;  // Number of bytes in the pubkey script.
+    unsigned char pk_script[FLAT_TRANSACTION_SCRIPT_LENGTH];
+} flat_transaction_output;
+
+typedef struct FlatTransaction {
+    unsigned int size;          // Bytes of the whole transaction, padding included; the next one follows.
+    int version;                // Transaction version number.
+    unsigned int tx_in_count;   // Number of transaction inputs.
+    unsigned int tx_out_count;  // Number of transaction outputs.
+    unsigned int lock_time;     // A time number.
+    bool well_formed;           // False if a script does not fit inline.
+    sha256_digest txid;         // The TXID of the transaction.
+} flat_transaction;
+
+size_t get_flat_transaction_size(unsigned int, unsigned int);
+flat_transaction *flatten_transactions(transaction **, unsigned int);
+void flatten_socket_transaction_view(socket_transaction_view *, flat_transaction *);
+bool flatten_transaction_output(transaction_output *, flat_transaction_output *);
+flat_transaction *get_next_flat_transaction(flat_transaction *);
+flat_transaction_input *get_flat_transaction_input(flat_transaction *, unsigned int);
+flat_transaction_output *get_flat_transaction_output(flat_transaction *, unsigned int);
+sha256_digest hash_flat_transaction_output(flat_transaction_output *);
+void get_flat_transaction_input_signature_check(flat_transaction_input *, flat_transaction_output *, signature_check *);
+
+#endif
@@ -0,0 +1,479 @@
+#include "mempool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "model/transaction/transaction_persistence.h"
+#include "utils/log_utils.h"
+
+#define LOG_SCOPE "mempool"
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+static unsigned int hash_outpoint_key(const void *key) {
+    const utxo_key *outpoint = (const utxo_key *)key;
+    unsigned int hash;
+    memcpy(&hash, outpoint->txid, sizeof(hash));
+    return hash ^ outpoint->index * 0x9E3779B9u;
+}
+
+static int are_outpoint_keys_equal(const void *a, const void *b) {
+    const utxo_key *x = (const utxo_key *)a, *y = (const utxo_key *)b;
+    return x->index == y->index && memcmp(x->txid, y->txid, SHA256_DIGEST_LENGTH) == 0;
+}
+
+/**
+ * Order entries by priority, then by arrival.
+ * @param a An entry.
+ * @param b Another entry.
+ * @param user_data Unused.
+ * @return Negative if a comes first, positive if b does.
+ */
+static int compare_mempool_entries(const void *a, const void *b, void *user_data) {
+    const mempool_entry *x = (const mempool_entry *)a, *y = (const mempool_entry *)b;
+    if (x->priority != y->priority) return x->priority > y->priority ? -1 : 1;
+    return x->sequence < y->sequence ? -1 : x->sequence > y->sequence;
+}
+
+/**
+ * Estimate the heap memory a transaction occupies.
+ * @param tx A transaction.
+ * @return Bytes.
+ */
+static size_t get_transaction_memory_usage(transaction *tx) {
+    size_t memory = sizeof(transaction);
+    for (unsigned int i = 0; i < tx->tx_in_count; i++) memory += sizeof(transaction_input) + tx->tx_ins[i].script_bytes + 1;
+    for (unsigned int i = 0; i < tx->tx_out_count; i++) memory += sizeof(transaction_output) + tx->tx_outs[i].pk_script_bytes + 1;
+    return memory;
+}
+
+/**
+ * Find what every input of a transaction spends: an
+ * output of an entry in the pool, or an unspent one.
+ * The pool must be locked.
+ * @param pool The pool.
+ * @param tx The transaction.
+ * @param keys Where the spent outpoints are written into, one per input.
+ * @param parents Where the entries spent from are added to; may be NULL.
+ * @param checks Where the signature checks are written into, one per input; may be NULL.
+ * @param input_sum Where the sum of the spent values is written into.
+ * @return MEMPOOL_ACCEPTED if every input can be spent, why not otherwise.
+ */
+static mempool_result resolve_mempool_inputs(
+    mempool *pool, transaction *tx, utxo_key *keys, GPtrArray *parents, signature_check *checks, long int *input_sum) {
+    *input_sum = 0;
+    for (unsigned int i = 0; i < tx->tx_in_count; i++) {
+        get_outpoint_utxo_key(&tx->tx_ins[i].previous_outpoint, &keys[i]);
+        for (unsigned int j = 0; j < i; j++) {
+            if (are_outpoint_keys_equal(&keys[i], &keys[j])) return MEMPOOL_INVALID;
+        }
+        if (g_hash_table_contains(pool->spent_outpoints, &keys[i])) return MEMPOOL_CONFLICT;
+
+        sha256_digest previous_txid;
+        memcpy(previous_txid.data, keys[i].txid, SHA256_DIGEST_LENGTH);
+        transaction *previous_tx;
+        transaction *stored_tx = NULL;  // Got from the persistence, hence released below.
+        mempool_entry *parent = g_hash_table_lookup(pool->transactions, &previous_txid);
+        if (parent != NULL) {
+            previous_tx = parent->tx;
+            if (parents != NULL && !g_ptr_array_find(parents, parent, NULL)) g_ptr_array_add(parents, parent);
+        } else {
+            if (!does_utxo_entry_exist(&keys[i])) return MEMPOOL_MISSING_INPUTS;
+            previous_tx = stored_tx = get_transaction(&previous_txid);
+            if (previous_tx == NULL) return MEMPOOL_MISSING_INPUTS;
+        }
+        if (keys[i].index >= previous_tx->tx_out_count) {
+            release_transaction(stored_tx);
+            return MEMPOOL_MISSING_INPUTS;
+        }
+
+        transaction_output *previous_output = &previous_tx->tx_outs[keys[i].index];
+        *input_sum += previous_output->value;
+        if (checks != NULL) get_transaction_input_signature_check(&tx->tx_ins[i], previous_output, &checks[i]);
+        release_transaction(stored_tx);
+    }
+    return MEMPOOL_ACCEPTED;
+}
+
+/**
+ * Check if an entry is an ancestor of another.
+ * @param ancestor The possible ancestor.
+ * @param entry The entry.
+ * @return True if the entry spends, directly or not, an output of the ancestor.
+ */
+static bool is_mempool_ancestor(mempool_entry *ancestor, mempool_entry *entry) {
+    for (unsigned int i = 0; i < entry->parents->len; i++) {
+        mempool_entry *parent = g_ptr_array_index(entry->parents, i);
+        if (parent == ancestor || is_mempool_ancestor(ancestor, parent)) return true;
+    }
+    return false;
+}
+
+static void free_mempool_entry(mempool_entry *entry) {
+    if (entry->tx != NULL) destroy_transaction(entry->tx);
+    g_ptr_array_free(entry->parents, TRUE);
+    g_ptr_array_free(entry->children, TRUE);
+    free(entry->spent_outpoints);
+    free(entry);
+}
+
+/**
+ * Take an entry out of the pool without freeing it. The pool must be locked.
+ * @param pool The pool.
+ * @param entry The entry.
+ * @param with_descendants Whether whatever spends its outputs goes too; otherwise
+ * its children merely lose a parent, as when it is confirmed.
+ */
+static void unlink_mempool_entry(mempool *pool, mempool_entry *entry, bool with_descendants);
+
+/**
+ * Remove an entry from the pool and free it. The pool must be locked.
+ * @param pool The pool.
+ * @param entry The entry.
+ * @param with_descendants Whether whatever spends its outputs goes too.
+ */
+static void remove_mempool_entry(mempool *pool, mempool_entry *entry, bool with_descendants) {
+    unlink_mempool_entry(pool, entry, with_descendants);
+    free_mempool_entry(entry);
+}
+
+static void unlink_mempool_entry(mempool *pool, mempool_entry *entry, bool with_descendants) {
+    while (entry->children->len > 0) {
+        mempool_entry *child = g_ptr_array_index(entry->children, entry->children->len - 1);
+        if (with_descendants) {
+            remove_mempool_entry(pool, child, true);
+        } else {
+            g_ptr_array_remove_fast(child->parents, entry);
+            g_ptr_array_remove_index_fast(entry->children, entry->children->len - 1);
+        }
+    }
+    for (unsigned int i = 0; i < entry->parents->len; i++) {
+        g_ptr_array_remove_fast(((mempool_entry *)g_ptr_array_index(entry->parents, i))->children, entry);
+    }
+    g_ptr_array_set_size(entry->parents, 0);
+
+    for (unsigned int i = 0; i < entry->tx->tx_in_count; i++) g_hash_table_remove(pool->spent_outpoints, &entry->spent_outpoints[i]);
+    g_hash_table_remove(pool->transactions, &entry->txid);
+    g_sequence_remove(entry->position);
+    pool->memory_usage -= entry->memory;
+}
+
+/**
+ * Evict the lowest priority entries until a new one fits.
+ * Nothing of higher priority than the new entry, nor
+ * anything it spends from, is evicted. The pool must be locked.
+ * @param pool The pool.
+ * @param entry The new entry.
+ * @return True if it fits now, false otherwise.
+ */
+static bool make_mempool_room(mempool *pool, mempool_entry *entry) {
+    while (pool->memory_usage + entry->memory > pool->memory_limit) {
+        if (g_sequence_is_empty(pool->by_priority)) return false;
+        mempool_entry *lowest = g_sequence_get(g_sequence_iter_prev(g_sequence_get_end_iter(pool->by_priority)));
+        if (compare_mempool_entries(entry, lowest, NULL) > 0 || is_mempool_ancestor(lowest, entry)) return false;
+        remove_mempool_entry(pool, lowest, true);
+    }
+    return true;
+}
+
+/**
+ * Add an entry into the pool. The pool must be locked.
+ * @param pool The pool.
+ * @param entry The entry.
+ */
+static void insert_mempool_entry(mempool *pool, mempool_entry *entry) {
+    pool->next_sequence++;
+    g_hash_table_insert(pool->transactions, &entry->txid, entry);
+    for (unsigned int i = 0; i < entry->tx->tx_in_count; i++) g_hash_table_insert(pool->spent_outpoints, &entry->spent_outpoints[i], entry);
+    for (unsigned int i = 0; i < entry->parents->len; i++) g_ptr_array_add(((mempool_entry *)g_ptr_array_index(entry->parents, i))->children, entry);
+    entry->position = g_sequence_insert_sorted(pool->by_priority, entry, compare_mempool_entries, NULL);
+    pool->memory_usage += entry->memory;
+}
+
+/**
+ * Collect an entry and whichever of its ancestors are not
+ * selected yet, parents before children, marking them selected.
+ * @param entry The entry.
+ * @param package Where the entries are added to.
+ * @param size Where their sizes are added to.
+ */
+static void collect_mempool_package(mempool_entry *entry, GPtrArray *package, unsigned long *size) {
+    entry->selected = true;
+    for (unsigned int i = 0; i < entry->parents->len; i++) {
+        mempool_entry *parent = g_ptr_array_index(entry->parents, i);
+        if (!parent->selected) collect_mempool_package(parent, package, size);
+    }
+    g_ptr_array_add(package, entry);
+    *size += entry->size;
+}
+
+static void free_mempool_sequence_entry(void *entry, void *user_data) { free_mempool_entry(entry); }
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Create an empty mempool.
+ * @param memory_limit Bytes the entries may occupy.
+ * @return The pool.
+ */
+mempool *create_mempool(size_t memory_limit) {
+    mempool *pool = (mempool *)malloc(sizeof(mempool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->transactions = g_hash_table_new(hash_digest_key, are_digest_keys_equal);
+    pool->spent_outpoints = g_hash_table_new(hash_outpoint_key, are_outpoint_keys_equal);
+    pool->by_priority = g_sequence_new(NULL);
+    pool->memory_usage = 0;
+    pool->memory_limit = memory_limit;
+    pool->next_sequence = 0;
+    return pool;
+}
+
+/**
+ * Destroy a mempool and every transaction in it.
+ * @param pool The pool.
+ */
+void destroy_mempool(mempool *pool) {
+    if (pool == NULL) return;
+    g_hash_table_destroy(pool->transactions);
+    g_hash_table_destroy(pool->spent_outpoints);
+    g_sequence_foreach(pool->by_priority, free_mempool_sequence_entry, NULL);
+    g_sequence_free(pool->by_priority);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+/**
+ * Validate a transaction and add it into the pool. Its
+ * inputs may spend unspent outputs or outputs of other
+ * transactions in the pool, but no outpoint another
+ * transaction in the pool spends. The signatures are
+ * verified without holding the pool, so other threads
+ * can add transactions meanwhile.
+ * @param pool The pool.
+ * @param tx The transaction; owned by the pool if accepted.
+ * @return MEMPOOL_ACCEPTED if it was added, why not otherwise.
+ */
+mempool_result add_mempool_transaction(mempool *pool, transaction *tx) {
+    if (tx->tx_in_count == 0) return MEMPOOL_INVALID;
+
+    mempool_entry *entry = (mempool_entry *)malloc(sizeof(mempool_entry));
+    entry->tx = tx;
+    entry->txid = get_transaction_txid(tx);
+    entry->spent_outpoints = (utxo_key *)malloc(tx->tx_in_count * sizeof(utxo_key));
+    entry->parents = g_ptr_array_new();
+    entry->children = g_ptr_array_new();
+    entry->size = get_transaction_size(tx);
+    entry->memory = sizeof(mempool_entry) + tx->tx_in_count * sizeof(utxo_key) + get_transaction_memory_usage(tx);
+    entry->value = 0;
+    bool has_negative_output = false;
+    for (unsigned int i = 0; i < tx->tx_out_count; i++) {
+        has_negative_output |= tx->tx_outs[i].value < 0;
+        entry->value += tx->tx_outs[i].value;
+    }
+    entry->priority = (double)entry->value / entry->size;
+    entry->selected = false;
+
+    // Look the inputs up, then verify the signatures with the pool released.
+    signature_check *checks = (signature_check *)malloc(tx->tx_in_count * sizeof(signature_check));
+    long int input_sum = 0;
+    pthread_mutex_lock(&pool->lock);
+    mempool_result result = g_hash_table_contains(pool->transactions, &entry->txid)
+                                ? MEMPOOL_DUPLICATE
+                                : resolve_mempool_inputs(pool, tx, entry->spent_outpoints, NULL, checks, &input_sum);
+    pthread_mutex_unlock(&pool->lock);
+    if (result == MEMPOOL_ACCEPTED && (has_negative_output || input_sum != entry->value)) result = MEMPOOL_INVALID;
+    if (result == MEMPOOL_ACCEPTED && verify_signatures(checks, tx->tx_in_count) >= 0) result = MEMPOOL_INVALID;
+    free(checks);
+
+    // The pool may have changed meanwhile, so the inputs are looked up again.
+    if (result == MEMPOOL_ACCEPTED) {
+        pthread_mutex_lock(&pool->lock);
+        entry->sequence = pool->next_sequence;
+        result = g_hash_table_contains(pool->transactions, &entry->txid)
+                     ? MEMPOOL_DUPLICATE
+                     : resolve_mempool_inputs(pool, tx, entry->spent_outpoints, entry->parents, NULL, &input_sum);
+        if (result == MEMPOOL_ACCEPTED && !make_mempool_room(pool, entry)) result = MEMPOOL_FULL;
+        if (result == MEMPOOL_ACCEPTED) insert_mempool_entry(pool, entry);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (result != MEMPOOL_ACCEPTED) {
+        char txid_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(&entry->txid, txid_hex);
+        general_log(LOG_SCOPE, LOG_ERROR, "Rejected transaction %s: %s.", txid_hex, get_mempool_result_name(result));
+        entry->tx = NULL;
+        free_mempool_entry(entry);
+    }
+    return result;
+}
+
+/**
+ * Describe the result of adding a transaction.
+ * @param result The result.
+ * @return A description.
+ */
+const char *get_mempool_result_name(mempool_result result) {
+    switch (result) {
+        case MEMPOOL_ACCEPTED:
+            return "accepted";
+        case MEMPOOL_DUPLICATE:
+            return "already in the mempool";
+        case MEMPOOL_CONFLICT:
+            return "conflicts with a transaction in the mempool";
+        case MEMPOOL_MISSING_INPUTS:
+            return "spends an unknown or spent output";
+        case MEMPOOL_INVALID:
+            return "invalid";
+        case MEMPOOL_FULL:
+            return "mempool full";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * Check if a transaction is in the pool.
+ * @param pool The pool.
+ * @param txid The TXID of the transaction.
+ * @return True if it is, false otherwise.
+ */
+bool does_mempool_transaction_exist(mempool *pool, sha256_digest *txid) {
+    pthread_mutex_lock(&pool->lock);
+    bool result = g_hash_table_contains(pool->transactions, txid);
+    pthread_mutex_unlock(&pool->lock);
+    return result;
+}
+
+/**
+ * Check if a transaction in the pool spends an outpoint.
+ * @param pool The pool.
+ * @param key The outpoint.
+ * @return True if one does, false otherwise.
+ */
+bool is_mempool_outpoint_spent(mempool *pool, const utxo_key *key) {
+    pthread_mutex_lock(&pool->lock);
+    bool result = g_hash_table_contains(pool->spent_outpoints, key);
+    pthread_mutex_unlock(&pool->lock);
+    return result;
+}
+
+/**
+ * Remove the transactions of a new block from the pool,
+ * along with every transaction that conflicts with them
+ * and whatever spends the outputs of those. A confirmed
+ * transaction is destroyed unless the block holds that
+ * very transaction, which it then keeps.
+ * @param pool The pool.
+ * @param txns The transactions of the block.
+ * @param txn_count Number of transactions.
+ */
+void remove_mempool_block_transactions(mempool *pool, transaction **txns, unsigned int txn_count) {
+    pthread_mutex_lock(&pool->lock);
+    for (unsigned int i = 0; i < txn_count; i++) {
+        sha256_digest txid = get_transaction_txid(txns[i]);
+        mempool_entry *entry = g_hash_table_lookup(pool->transactions, &txid);
+        if (entry == NULL) continue;
+        unlink_mempool_entry(pool, entry, false);
+        if (entry->tx == txns[i]) entry->tx = NULL;
+        free_mempool_entry(entry);
+    }
+
+    // Whatever still spends an outpoint the block spent can never be mined.
+    for (unsigned int i = 0; i < txn_count; i++) {
+        for (unsigned int j = 0; j < txns[i]->tx_in_count; j++) {
+            utxo_key key;
+            get_outpoint_utxo_key(&txns[i]->tx_ins[j].previous_outpoint, &key);
+            mempool_entry *conflict = g_hash_table_lookup(pool->spent_outpoints, &key);
+            if (conflict != NULL) remove_mempool_entry(pool, conflict, true);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Pick transactions for a block, highest priority first.
+ * A transaction is picked together with whatever it spends
+ * from in the pool, which comes before it; if the lot does
+ * not fit, none of it is picked. The transactions stay in
+ * the pool, which keeps owning them until they are handed
+ * over by remove_mempool_block_transactions().
+ * @param pool The pool.
+ * @param max_size Bytes the transactions may take in the raw transaction format.
+ * @param max_count Number of transactions that may be picked.
+ * @param txns Where a new array of the picked transactions is written into.
+ * @param txids Where a new array of their TXIDs is written into.
+ * @return The number of transactions picked.
+ */
+unsigned int select_mempool_transactions(
+    mempool *pool, unsigned int max_size, unsigned int max_count, transaction ***txns, sha256_digest **txids) {
+    pthread_mutex_lock(&pool->lock);
+    unsigned int capacity = g_hash_table_size(pool->transactions);
+    if (capacity > max_count) capacity = max_count;
+    *txns = (transaction **)malloc((capacity + 1) * sizeof(transaction *));
+    *txids = (sha256_digest *)malloc((capacity + 1) * sizeof(sha256_digest));
+
+    GPtrArray *selected = g_ptr_array_new();
+    GPtrArray *package = g_ptr_array_new();
+    unsigned long total_size = 0;
+    GSequenceIter *iter = g_sequence_get_begin_iter(pool->by_priority);
+    while (!g_sequence_iter_is_end(iter) && selected->len < capacity) {
+        mempool_entry *entry = g_sequence_get(iter);
+        iter = g_sequence_iter_next(iter);
+        if (entry->selected) continue;
+
+        unsigned long package_size = 0;
+        g_ptr_array_set_size(package, 0);
+        collect_mempool_package(entry, package, &package_size);
+        if (total_size + package_size <= max_size && selected->len + package->len <= capacity) {
+            for (unsigned int i = 0; i < package->len; i++) g_ptr_array_add(selected, g_ptr_array_index(package, i));
+            total_size += package_size;
+        } else {
+            for (unsigned int i = 0; i < package->len; i++) ((mempool_entry *)g_ptr_array_index(package, i))->selected = false;
+        }
+    }
+
+    for (unsigned int i = 0; i < selected->len; i++) {
+        mempool_entry *entry = g_ptr_array_index(selected, i);
+        entry->selected = false;
+        (*txns)[i] = entry->tx;
+        (*txids)[i] = entry->txid;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    unsigned int count = selected->len;
+    g_ptr_array_free(package, TRUE);
+    g_ptr_array_free(selected, TRUE);
+    return count;
+}
+
+/**
+ * Get the number of transactions in the pool.
+ * @param pool The pool.
+ * @return The number of transactions.
+ */
+size_t get_mempool_size(mempool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    size_t size = g_hash_table_size(pool->transactions);
+    pthread_mutex_unlock(&pool->lock);
+    return size;
+}
+
+/**
+ * Get the memory the entries of the pool occupy.
+ * @param pool The pool.
+ * @return Bytes.
+ */
+size_t get_mempool_memory_usage(mempool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    size_t memory = pool->memory_usage;
+    pthread_mutex_unlock(&pool->lock);
+    return memory;
+}
@@ -0,0 +1,68 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_MEMPOOL_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_MEMPOOL_H
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "transaction.h"
+
+/*
+ * A validated transaction waiting in a mempool.
+ */
+typedef struct MempoolEntry {
+    transaction *tx;            // Owned by the mempool.
+    sha256_digest txid;         // The key of the entry.
+    utxo_key *spent_outpoints;  // The outpoints it spends, one per input.
+    GPtrArray *parents;         // Entries whose outputs it spends.
+    GPtrArray *children;        // Entries spending its outputs.
+    GSequenceIter *position;    // Where it is in the priority order.
+    unsigned int size;          // Bytes in the raw transaction format.
+    size_t memory;              // Bytes it occupies in the mempool.
+    long int value;             // Coins it moves.
+    double priority;            // Coins moved per byte.
+    unsigned long sequence;     // Arrival order; breaks priority ties.
+    bool selected;              // Already picked by select_mempool_transactions().
+} mempool_entry;
+
+/*
+ * Unconfirmed transactions, staged between their arrival
+ * and their block. Every spent outpoint is indexed, so a
+ * double spend is rejected with one lookup, and entries
+ * are kept in priority order. Once over its memory limit,
+ * the pool evicts its lowest priority entries along with
+ * whatever spends their outputs. Safe to use from many
+ * threads at once.
+ */
+typedef struct Mempool {
+    pthread_mutex_t lock;
+    GHashTable *transactions;     // Maps each TXID to its entry.
+    GHashTable *spent_outpoints;  // Maps each spent outpoint to the entry spending it.
+    GSequence *by_priority;       // The entries, highest priority first.
+    size_t memory_usage;          // Bytes occupied by the entries.
+    size_t memory_limit;          // Bytes the entries may occupy.
+    unsigned long next_sequence;  // The arrival order of the next entry.
+} mempool;
+
+typedef enum MempoolResult {
+    MEMPOOL_ACCEPTED,        // Now in the pool, which owns it.
+    MEMPOOL_DUPLICATE,       // Already in the pool.
+    MEMPOOL_CONFLICT,        // Spends an outpoint that another transaction in the pool spends.
+    MEMPOOL_MISSING_INPUTS,  // Spends an outpoint that is neither unspent nor created in the pool.
+    MEMPOOL_INVALID,         // Unbalanced, malformed, or badly signed.
+    MEMPOOL_FULL,            // No room, even after evicting everything of lower priority.
+} mempool_result;
+
+mempool *create_mempool(size_t);
+void destroy_mempool(mempool *);
+mempool_result add_mempool_transaction(mempool *, transaction *);
+const char *get_mempool_result_name(mempool_result);
+bool does_mempool_transaction_exist(mempool *, sha256_digest *);
+bool is_mempool_outpoint_spent(mempool *, const utxo_key *);
+void remove_mempool_block_transactions(mempool *, transaction **, unsigned int);
+unsigned int select_mempool_transactions(mempool *, unsigned int, unsigned int, transaction ***, sha256_digest **);
+size_t get_mempool_size(mempool *);
+size_t get_mempool_memory_usage(mempool *);
+
+#endif
@@ -1,6 +1,7 @@
 #include "transaction.h"
 
 #include <glib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -8,15 +9,21 @@
 #include "transaction_persistence.h"
 #include "utils/constants.h"
 #include "utils/log_utils.h"
+#include "utils/serialize.h"
+#include "utils/signature_cache.h"
 #include "utils/sys_utils.h"
 
 #define LOG_SCOPE "transaction"
+#define TRANSACTION_STACK_CHECKS 16  // Signature checks verify_transaction() keeps on the stack.
+#define TRANSACTION_STACK_SERIALIZATION 512  // Bytes of a transaction compute_transaction_txid() serializes on the stack.
+#define SERIALIZED_INPUT_MIN_LENGTH (SHA256_DIGEST_LENGTH + 4 + 1 + 4)  // Outpoint, an empty script and sequence.
+#define SERIALIZED_OUTPUT_MIN_LENGTH (8 + 1)                            // Value and an empty script.
 
 char *g_genesis_private_key;
 secp256k1_pubkey *g_genesis_public_key;
 
-char *hash_transaction_outpoint(transaction_outpoint *);
-char *hash_transaction_output(transaction_output *);
+sha256_digest hash_transaction_outpoint(transaction_outpoint *);
+sha256_digest hash_transaction_output(transaction_output *);
 transaction *create_an_empty_transaction(unsigned int, unsigned int);
 bool append_new_transaction_input(transaction *, transaction_input, unsigned int);
 bool append_new_transaction_output(transaction *, transaction_output, unsigned int);
@@ -27,51 +34,179 @@ bool append_new_transaction_output(transaction *, transaction_output, unsigned i
  * -----------------------------------------------------------
  */
 /**
- * Verify that the transaction input is valid, i.e.,
- * whoever signs the input has the right to use the
- * specified output.
+ * Get the bytes a script is given in memory: room for at
+ * least the 64 bytes of a signature or a public key, as
+ * every script has, and a terminating NUL.
+ * @param script_bytes Number of bytes in the script.
+ * @return Bytes to allocate.
+ */
+static size_t get_script_allocation_size(unsigned int script_bytes) { return (script_bytes < 64 ? 64 : script_bytes) + 1; }
+
+/**
+ * Copy a script into an arena. Bytes past its end are zeros.
+ * @param memory_arena The arena to allocate from.
+ * @param script The script.
+ * @param script_bytes Number of bytes in the script.
+ * @return The copy.
+ */
+static char *copy_script_into_arena(arena *memory_arena, const unsigned char *script, unsigned int script_bytes) {
+    size_t size = get_script_allocation_size(script_bytes);
+    char *dest = (char *)arena_alloc(memory_arena, size);
+    memcpy(dest, script, script_bytes);
+    memset(dest + script_bytes, 0, size - script_bytes);
+    return dest;
+}
+
+/**
+ * Copy the 64 bytes a signature or a public key takes from
+ * a script. Bytes past its end are zeros, as in scripts read
+ * from the wire and in flat transactions, so that every path
+ * checks a signature against the same bytes.
+ * @param dest 64 bytes.
+ * @param script The script.
+ * @param script_bytes Number of bytes in the script.
+ */
+static void copy_signature_check_script(unsigned char *dest, const char *script, unsigned int script_bytes) {
+    if (script_bytes > 64) script_bytes = 64;
+    memcpy(dest, script, script_bytes);
+    memset(dest + script_bytes, 0, 64 - script_bytes);
+}
+
+/**
+ * Walk a transaction in the raw transaction format, checking
+ * that it is complete. With a destination, the transaction
+ * is filled in from an arena on the way.
+ * @param reader A reader at the start of the transaction, left after its end.
+ * @param dest The transaction to fill; NULL to only check it.
+ * @param memory_arena The arena to allocate from; unused without a destination.
+ * @param arena_size Where the bytes of arena the transaction takes up are added to.
+ * @return True for success, false if it is malformed.
+ */
+static bool parse_serialized_transaction(byte_reader *reader, transaction *dest, arena *memory_arena, size_t *arena_size) {
+    unsigned int version, index, sequence, lock_time;
+    unsigned long long tx_in_count, tx_out_count, script_bytes, value;
+    const unsigned char *hash, *script;
+
+    // Counts are bounded by the bytes left before anything is allocated for them.
+    if (!read_le32(reader, &version) || !read_compact_size(reader, &tx_in_count) ||
+        tx_in_count > get_remaining_bytes(reader) / SERIALIZED_INPUT_MIN_LENGTH)
+        return false;
+    *arena_size += get_arena_allocation_size(sizeof(transaction)) + get_arena_allocation_size(tx_in_count * sizeof(transaction_input));
+    if (dest != NULL) {
+        dest->version = (int)version;
+        dest->tx_in_count = tx_in_count;
+        dest->tx_ins = (transaction_input *)arena_alloc(memory_arena, tx_in_count * sizeof(transaction_input));
+    }
+
+    for (unsigned int i = 0; i < tx_in_count; i++) {
+        if ((hash = read_bytes(reader, SHA256_DIGEST_LENGTH)) == NULL || !read_le32(reader, &index) || !read_compact_size(reader, &script_bytes) ||
+            script_bytes > TRANSACTION_MAX_SCRIPT_BYTES || (script = read_bytes(reader, script_bytes)) == NULL || !read_le32(reader, &sequence))
+            return false;
+        *arena_size += get_arena_allocation_size(get_script_allocation_size(script_bytes));
+        if (dest == NULL) continue;
+
+        transaction_input *input = &dest->tx_ins[i];
+        memcpy(input->previous_outpoint.hash.data, hash, SHA256_DIGEST_LENGTH);
+        input->previous_outpoint.index = index;
+        input->script_bytes = script_bytes;
+        input->signature_script = copy_script_into_arena(memory_arena, script, script_bytes);
+        input->sequence = sequence;
+    }
+
+    if (!read_compact_size(reader, &tx_out_count) || tx_out_count > get_remaining_bytes(reader) / SERIALIZED_OUTPUT_MIN_LENGTH) return false;
+    *arena_size += get_arena_allocation_size(tx_out_count * sizeof(transaction_output));
+    if (dest != NULL) {
+        dest->tx_out_count = tx_out_count;
+        dest->tx_outs = (transaction_output *)arena_alloc(memory_arena, tx_out_count * sizeof(transaction_output));
+    }
+
+    for (unsigned int i = 0; i < tx_out_count; i++) {
+        if (!read_le64(reader, &value) || !read_compact_size(reader, &script_bytes) || script_bytes > TRANSACTION_MAX_SCRIPT_BYTES ||
+            (script = read_bytes(reader, script_bytes)) == NULL)
+            return false;
+        *arena_size += get_arena_allocation_size(get_script_allocation_size(script_bytes));
+        if (dest == NULL) continue;
+
+        transaction_output *output = &dest->tx_outs[i];
+        output->value = (long int)value;
+        output->pk_script_bytes = script_bytes;
+        output->pk_script = copy_script_into_arena(memory_arena, script, script_bytes);
+    }
+
+    if (!read_le32(reader, &lock_time)) return false;
+    if (dest != NULL) dest->lock_time = lock_time;
+    return true;
+}
+
+/**
+ * Collect what checking the signature of an input needs.
  * @param i A transaction input.
- * @return True for valid, false otherwise
- * @author Ing Tian
+ * @param previous_output The output it spends.
+ * @param check Where the signature check is written into.
  */
-bool verify_transaction_input(transaction_input *i, bool skip_UTXO_check) {
-    transaction_outpoint outpoint = i->previous_outpoint;
-    char *transaction_hash = outpoint.hash;
-    unsigned int output_idx = outpoint.index;
+void get_transaction_input_signature_check(transaction_input *i, transaction_output *previous_output, signature_check *check) {
+    check->msg_hash = hash_transaction_output(previous_output);
+    copy_signature_check_script(check->public_key.data, previous_output->pk_script, previous_output->pk_script_bytes);
+    copy_signature_check_script(check->signature.data, i->signature_script, i->script_bytes);
+}
 
-    if (!does_transaction_exist(transaction_hash)) {
+/**
+ * Check everything about a transaction input except its
+ * signature, and collect what the signature check needs.
+ * The previous transaction is looked up once, and nothing
+ * is allocated.
+ * @param i A transaction input.
+ * @param skip_UTXO_check Whether to skip checking that the outpoint is unspent.
+ * @param check Where the signature check is written into.
+ * @param previous_value Where the value of the spent output is written into; may be NULL.
+ * @return True for valid so far, false otherwise.
+ */
+bool prepare_transaction_input_check(transaction_input *i, bool skip_UTXO_check, signature_check *check, long int *previous_value) {
+    utxo_key key;
+    get_outpoint_utxo_key(&i->previous_outpoint, &key);
+    transaction *previous_transaction = get_transaction(&i->previous_outpoint.hash);
+    if (previous_transaction == NULL) {
         general_log(LOG_SCOPE, LOG_ERROR, "Could not find previous transaction");
         return false;
     }
 
-    transaction *previous_transaction = get_transaction(transaction_hash);
-
-    if (output_idx >= previous_transaction->tx_out_count) {
+    if (key.index >= previous_transaction->tx_out_count) {
         general_log(
-            LOG_SCOPE, LOG_ERROR, "The output index (%u) is bigger than the output size (%u).", output_idx, previous_transaction->tx_out_count);
+            LOG_SCOPE, LOG_ERROR, "The output index (%u) is bigger than the output size (%u).", key.index, previous_transaction->tx_out_count);
+        release_transaction(previous_transaction);
         return false;
     }
 
-    transaction_output previous_transaction_output = previous_transaction->tx_outs[output_idx];
-    char *hash_msg = hash_transaction_output(&previous_transaction_output);
-    secp256k1_pubkey pubkey;
-    secp256k1_ecdsa_signature signature;
-    memcpy(pubkey.data, previous_transaction_output.pk_script, 64);
-    memcpy(signature.data, i->signature_script, 64);
+    transaction_output *previous_output = &previous_transaction->tx_outs[key.index];
+    get_transaction_input_signature_check(i, previous_output, check);
+    if (previous_value != NULL) *previous_value = previous_output->value;
+    release_transaction(previous_transaction);
 
-    transaction_outpoint *copied_outpoint = (transaction_outpoint *)malloc(sizeof(transaction_outpoint));
-    memcpy(copied_outpoint->hash, outpoint.hash, 64);
-    copied_outpoint->hash[64] = '\0';
-    copied_outpoint->index = outpoint.index;
-    char *utxo_key = hash_transaction_outpoint(copied_outpoint);
-    if (!does_utxo_entry_exist(utxo_key) && !skip_UTXO_check) {
+    if (!skip_UTXO_check && !does_utxo_entry_exist(&key)) {
         general_log(LOG_SCOPE, LOG_ERROR, "UTXO is over spent.");
         return false;
     }
-    free(utxo_key);
 
-    bool result = verify(&pubkey, (unsigned char *)hash_msg, &signature);
-    free(hash_msg);
+    return true;
+}
+
+/**
+ * Verify that the transaction input is valid, i.e.,
+ * whoever signs the input has the right to use the
+ * specified output.
+ * @param i A transaction input.
+ * @return True for valid, false otherwise
+ * @author Ing Tian
+ */
+bool verify_transaction_input(transaction_input *i, bool skip_UTXO_check) {
+    signature_check check;
+    if (!prepare_transaction_input_check(i, skip_UTXO_check, &check, NULL)) return false;
+
+    sha256_digest cache_key = get_signature_cache_key(&check);
+    if (is_signature_cached(&cache_key)) return true;
+
+    bool result = verify(&check.public_key, check.msg_hash.data, &check.signature);
+    if (result) cache_valid_signature(&cache_key);
 
     if (!result) {
         general_log(LOG_SCOPE, LOG_ERROR, "Failed to verify signature.");
@@ -119,7 +254,7 @@ transaction *initialize_transaction_system(bool skip_genesis) {
         g_genesis_public_key = get_a_new_public_key(g_genesis_private_key);
         if (skip_genesis) return NULL;
         transaction *genesis_transaction = create_an_empty_transaction(1, 1);
-        genesis_transaction->tx_ins[0].signature_script = (char *)malloc(65);
+        genesis_transaction->tx_ins[0].signature_script = (char *)calloc(65, 1);
         genesis_transaction->tx_ins[0].signature_script[0] = 'A';
         genesis_transaction->tx_ins[0].sequence = 1;
         genesis_transaction->tx_ins[0].script_bytes = 1;
@@ -129,19 +264,16 @@ transaction *initialize_transaction_system(bool skip_genesis) {
         memcpy(genesis_transaction->tx_outs->pk_script, g_genesis_public_key->data, 64);
         genesis_transaction->tx_outs[0].pk_script_bytes = 64;
 
-        char *genesis_txid = get_transaction_txid(genesis_transaction);
+        sha256_digest genesis_txid = get_transaction_txid(genesis_transaction);
 
-        transaction_outpoint outpoint = {.index = 0};
-        memcpy(outpoint.hash, genesis_txid, 64);
-        outpoint.hash[64] = '\0';
-        char *outpoint_hash = hash_transaction_outpoint(&outpoint);
-        long int *genesis_balance = (long int *)malloc(sizeof(long int));
-        *genesis_balance = TOTAL_NUMBER_OF_COINS;
-
-        save_utxo_entry(outpoint_hash, genesis_balance);
+        utxo_key key = {.index = 0};
+        memcpy(key.txid, genesis_txid.data, SHA256_DIGEST_LENGTH);
+        save_utxo_entry(&key, TOTAL_NUMBER_OF_COINS);
         save_transaction(genesis_transaction);
 
-        general_log(LOG_SCOPE, LOG_INFO, "Initialized the transaction module. Genesis TXID: %s", genesis_txid);
+        char genesis_txid_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(&genesis_txid, genesis_txid_hex);
+        general_log(LOG_SCOPE, LOG_INFO, "Initialized the transaction module. Genesis TXID: %s", genesis_txid_hex);
 
         return genesis_transaction;
     } else {
@@ -159,21 +291,55 @@ void destroy_transaction_system() {
 }
 
 /**
- * Get the transaction_id of a transaction.
+ * Compute the TXID of a transaction from scratch: the hash
+ * of all of it in the raw transaction format.
+ * @param t A transaction.
+ * @return The TXID.
+ */
+static sha256_digest compute_transaction_txid(transaction *t) {
+    unsigned char stack_buffer[TRANSACTION_STACK_SERIALIZATION];
+    unsigned int size = get_transaction_size(t);
+    unsigned char *serialized = size <= TRANSACTION_STACK_SERIALIZATION ? stack_buffer : (unsigned char *)malloc(size);
+    serialize_transaction(t, serialized);
+    sha256_digest txid = hash_struct(serialized, size);
+    if (serialized != stack_buffer) free(serialized);
+    return txid;
+}
+
+/**
+ * Get the transaction_id of a transaction. The TXID memoized
+ * in the transaction is returned unless a field it covers has
+ * changed since; otherwise it is computed without memoizing it,
+ * so that threads sharing a transaction only ever read it.
  * @param transaction
  * @return The hash of the transaction (32 bytes).
  * @author Ing Tian
  */
-char *get_transaction_txid(transaction *t) {
-    transaction *copied_tx = (transaction *)malloc(sizeof(transaction));
-    memset(copied_tx, 0, sizeof(transaction));
-    copied_tx->tx_out_count = t->tx_out_count;
-    copied_tx->tx_in_count = t->tx_in_count;
-    copied_tx->lock_time = t->lock_time;
-    copied_tx->version = t->version;
-    char *result = hash_struct_in_hex(copied_tx, sizeof(transaction));
-    free(copied_tx);
-    return result;
+sha256_digest get_transaction_txid(transaction *t) {
+    transaction_txid_cache *cache = &t->txid_cache;
+    if (cache->valid && cache->version == t->version && cache->tx_in_count == t->tx_in_count && cache->tx_ins == t->tx_ins &&
+        cache->tx_out_count == t->tx_out_count && cache->tx_outs == t->tx_outs && cache->lock_time == t->lock_time)
+        return cache->txid;
+    return compute_transaction_txid(t);
+}
+
+/**
+ * Memoize the TXID of a transaction in it. Only done while a
+ * single thread holds the transaction, once it is complete: as
+ * it is created, read or finalized. Its inputs and outputs are
+ * not to be edited in place afterwards.
+ * @param t A transaction.
+ */
+void memoize_transaction_txid(transaction *t) {
+    transaction_txid_cache *cache = &t->txid_cache;
+    cache->txid = compute_transaction_txid(t);
+    cache->version = t->version;
+    cache->tx_in_count = t->tx_in_count;
+    cache->tx_ins = t->tx_ins;
+    cache->tx_out_count = t->tx_out_count;
+    cache->tx_outs = t->tx_outs;
+    cache->lock_time = t->lock_time;
+    cache->valid = true;
 }
 
 /**
@@ -182,15 +348,14 @@ char *get_transaction_txid(transaction *t) {
  * @return The SHA256 hashcode.
  * @author Ing Tian
  */
-char *hash_transaction_output(transaction_output *output) {
-    unsigned long total_size_needed = sizeof(transaction_output) + output->pk_script_bytes;
-    transaction_output *copied_output = (transaction_output *)malloc(total_size_needed);
-    memset(copied_output, 0, total_size_needed);
-    copied_output->pk_script_bytes = output->pk_script_bytes;
-    copied_output->value = output->value;
-    memcpy(copied_output + sizeof(transaction_output), output->pk_script, output->pk_script_bytes);
-    char *result = hash_struct_in_hex(copied_output, total_size_needed);
-    free(copied_output);
+sha256_digest hash_transaction_output(transaction_output *output) {
+    sha256_digest result;
+    sha256_context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, &output->value, sizeof(output->value));
+    sha256_update(&ctx, &output->pk_script_bytes, sizeof(output->pk_script_bytes));
+    sha256_update(&ctx, output->pk_script, output->pk_script_bytes);
+    sha256_final(&ctx, &result);
     return result;
 }
 
@@ -200,16 +365,27 @@ char *hash_transaction_output(transaction_output *output) {
  * @return The SHA256 hashcode.
  * @author Ing Tian
  */
-char *hash_transaction_outpoint(transaction_outpoint *outpoint) {
-    transaction_outpoint *copied_transaction_outpoint = (transaction_outpoint *)malloc(sizeof(transaction_outpoint));
-    memset(copied_transaction_outpoint, 0, sizeof(transaction_outpoint));
-    memcpy(copied_transaction_outpoint->hash, outpoint->hash, 65);
-    copied_transaction_outpoint->index = outpoint->index;
-    char *result = hash_struct_in_hex(copied_transaction_outpoint, sizeof(transaction_outpoint));
-    free(copied_transaction_outpoint);
+sha256_digest hash_transaction_outpoint(transaction_outpoint *outpoint) {
+    sha256_digest result;
+    sha256_context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, outpoint->hash.data, SHA256_DIGEST_LENGTH);
+    sha256_update(&ctx, &outpoint->index, sizeof(outpoint->index));
+    sha256_final(&ctx, &result);
     return result;
 }
 
+/**
+ * Get the UTXO key of an outpoint, i.e., its binary
+ * TXID and output index. No hashing involved.
+ * @param outpoint A transaction outpoint.
+ * @param dest Where the key is written into.
+ */
+void get_outpoint_utxo_key(transaction_outpoint *outpoint, utxo_key *dest) {
+    dest->index = outpoint->index;
+    memcpy(dest->txid, outpoint->hash.data, SHA256_DIGEST_LENGTH);
+}
+
 /**
  * Get the private key of the genesis transaction.
  * @return Private key of the genesis transaction.
@@ -249,11 +425,17 @@ transaction *create_an_empty_transaction(unsigned int num_of_inputs, unsigned in
  * Destroy a transaction, free all of its memory space.
  * Notice that the transaction should not have been
  * registered in the system. A transaction registered
- * shall not be destroyed.
+ * shall not be destroyed. One sharing an arena with
+ * others, as those of a received block do, is freed
+ * with the arena instead.
  * @param t A transaction
  * @author Ing Tian
  */
 void destroy_transaction(transaction *t) {
+    if (t->arena != NULL) {
+        if (t->owns_arena) destroy_arena(t->arena);
+        return;
+    }
     for (int i = 0; i < t->tx_in_count; i++) free_transaction_input(&t->tx_ins[i]);
     free(t->tx_ins);
     for (int i = 0; i < t->tx_out_count; i++) free_transaction_output(&t->tx_outs[i]);
@@ -290,7 +472,8 @@ bool append_new_transaction_output(transaction *t, transaction_output output, un
 /**
  * Finalize a transaction in the system; this action
  * will update the global transaction table and the
- * UTXO.
+ * UTXO. It fails, leaving both untouched, if any of
+ * its inputs has been spent already.
  * @param t A transaction.
  * @return True for success, false otherwise.
  * @author Ing Tian
@@ -302,10 +485,15 @@ bool finalize_transaction(transaction *t) {
 
     for (int i = 0; i < t->tx_in_count; i++) {
         transaction_input input = t->tx_ins[i];
-        char *previous_transaction_id = input.previous_outpoint.hash;
         unsigned int previous_output_id = input.previous_outpoint.index;
-        transaction *previous_transaction = get_transaction(previous_transaction_id);
+        transaction *previous_transaction = get_transaction(&input.previous_outpoint.hash);
+        if (previous_transaction == NULL || previous_output_id >= previous_transaction->tx_out_count) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Could not find previous transaction");
+            release_transaction(previous_transaction);
+            return false;
+        }
         input_sum += previous_transaction->tx_outs[previous_output_id].value;
+        release_transaction(previous_transaction);
     }
 
     for (int i = 0; i < t->tx_out_count; i++) {
@@ -317,37 +505,64 @@ bool finalize_transaction(transaction *t) {
         return false;
     }
 
-    // Register this transaction in the system.
-    char *txid = get_transaction_txid(t);
-    save_transaction(t);
-
-    // Update UTXO.
+    // Spend the inputs. Every spend is atomic, so of several
+    // transactions racing for one outpoint only one gets it.
+    utxo_key key;
+    long int spent_values[t->tx_in_count > 0 ? t->tx_in_count : 1];
     for (int i = 0; i < t->tx_in_count; i++) {
-        char *outpoint_hash = hash_transaction_outpoint(&t->tx_ins[i].previous_outpoint);
-        remove_utxo_entry(outpoint_hash);
-        free(outpoint_hash);
+        get_outpoint_utxo_key(&t->tx_ins[i].previous_outpoint, &key);
+        if (spend_utxo_entry(&key, &spent_values[i])) continue;
+
+        general_log(LOG_SCOPE, LOG_ERROR, "Input %d spends an outpoint that is not in the UTXO.", i);
+        for (int j = 0; j < i; j++) {
+            get_outpoint_utxo_key(&t->tx_ins[j].previous_outpoint, &key);
+            save_utxo_entry(&key, spent_values[j]);
+        }
+        return false;
     }
 
+    // Register this transaction in the system.
+    memoize_transaction_txid(t);
+    sha256_digest txid = get_transaction_txid(t);
+    save_transaction(t);
+
+    // Add the outputs to the UTXO.
+    memcpy(key.txid, txid.data, SHA256_DIGEST_LENGTH);
     for (int i = 0; i < t->tx_out_count; i++) {
-        long int *value = (long int *)malloc(sizeof(long int));
-        *value = t->tx_outs[i].value;
-        transaction_outpoint *outpoint = (transaction_outpoint *)malloc(sizeof(transaction_outpoint));
-        memcpy(outpoint->hash, txid, 64);
-        outpoint->hash[64] = '\0';
-        outpoint->index = i;
-        char *outpoint_hash = hash_transaction_outpoint(outpoint);
-        save_utxo_entry(outpoint_hash, value);
+        key.index = i;
+        save_utxo_entry(&key, t->tx_outs[i].value);
     }
 
     return true;
 }
 
+/**
+ * Get the size of a transaction in the raw transaction format.
+ * @param t A transaction.
+ * @return Its size in bytes.
+ */
+unsigned int get_transaction_size(transaction *t) {
+    // Version, input and output counts, and lock time.
+    unsigned int size = 4 + get_compact_size_length(t->tx_in_count) + get_compact_size_length(t->tx_out_count) + 4;
+    for (int i = 0; i < t->tx_in_count; i++) {
+        // Outpoint, script, and sequence.
+        unsigned int script_bytes = t->tx_ins[i].script_bytes;
+        size += SHA256_DIGEST_LENGTH + 4 + get_compact_size_length(script_bytes) + script_bytes + 4;
+    }
+    for (int i = 0; i < t->tx_out_count; i++) {
+        // Value and script.
+        unsigned int pk_script_bytes = t->tx_outs[i].pk_script_bytes;
+        size += 8 + get_compact_size_length(pk_script_bytes) + pk_script_bytes;
+    }
+    return size;
+}
+
 /**
  * Get a transaction by its txid.
  * @return A new transaction
  * @author Junjian Chen
  */
-transaction *get_transaction_by_txid(char *txid) {
+transaction *get_transaction_by_txid(sha256_digest *txid) {
     transaction *t = get_transaction(txid);
     return t;
 }
@@ -365,11 +580,13 @@ bool create_new_transaction_shortcut(transaction_create_shortcut *transaction_da
     for (int i = 0; i < transaction_data->num_of_inputs; i++) {
         transaction_create_shortcut_input curr_input_data = transaction_data->inputs[i];
 
-        if (!does_transaction_exist(curr_input_data.previous_txid)) {
-            general_log(LOG_SCOPE, LOG_ERROR, "Failed to find the previous transaction with the given TXID: %s", curr_input_data.previous_txid);
+        transaction *previous_tx = get_transaction(&curr_input_data.previous_txid);
+        if (previous_tx == NULL) {
+            char previous_txid_hex[SHA256_HEX_LENGTH];
+            convert_digest_to_hex(&curr_input_data.previous_txid, previous_txid_hex);
+            general_log(LOG_SCOPE, LOG_ERROR, "Failed to find the previous transaction with the given TXID: %s", previous_txid_hex);
             return false;
         }
-        transaction *previous_tx = get_transaction(curr_input_data.previous_txid);
 
         if (curr_input_data.previous_output_idx >= previous_tx->tx_out_count) {
             general_log(LOG_SCOPE,
@@ -377,22 +594,20 @@ bool create_new_transaction_shortcut(transaction_create_shortcut *transaction_da
                         "Previous output index (%u) is out of scope (%u).",
                         curr_input_data.previous_output_idx,
                         previous_tx->tx_out_count);
+            release_transaction(previous_tx);
             return false;
         }
-        transaction_output previous_tx_output = previous_tx->tx_outs[curr_input_data.previous_output_idx];
+        sha256_digest msg = hash_transaction_output(&previous_tx->tx_outs[curr_input_data.previous_output_idx]);
+        release_transaction(previous_tx);
 
-        transaction_input input = {.previous_outpoint = {.index = curr_input_data.previous_output_idx},
+        transaction_input input = {.previous_outpoint = {.hash = curr_input_data.previous_txid, .index = curr_input_data.previous_output_idx},
                                    .sequence = 1,
                                    .script_bytes = 64,
                                    .signature_script = (char *)malloc(65)};
         input.signature_script[64] = '\0';
-        memcpy(input.previous_outpoint.hash, transaction_data->inputs[i].previous_txid, 64);
-        input.previous_outpoint.hash[64] = '\0';
-        char *msg = hash_transaction_output(&previous_tx_output);
-        secp256k1_ecdsa_signature *signature = sign((unsigned char *)curr_input_data.private_key, (unsigned char *)msg);
+        secp256k1_ecdsa_signature *signature = sign((unsigned char *)curr_input_data.private_key, msg.data);
         memcpy(input.signature_script, signature->data, 64);
         free(signature);
-        free(msg);
 
         if (!append_new_transaction_input(ret_tx, input, i)) {
             general_log(LOG_SCOPE, LOG_ERROR, "Failed to append input to transaction.");
@@ -413,30 +628,30 @@ bool create_new_transaction_shortcut(transaction_create_shortcut *transaction_da
         }
     }
 
+    memoize_transaction_txid(ret_tx);
     *dest = *ret_tx;
 
     return true;
 }
 
 /**
- * Verify a transaction with a txid
- * @param txid txid of the transaction
- * @return True if it is valid. False otherwise
- * @author Junjian Chen
+ * Verify everything about a transaction except its
+ * signatures, which are collected for verify_signatures().
+ * @param t A transaction.
+ * @param checks Where the signature checks are written into, one per input.
+ * @return True for valid so far, false otherwise.
  */
-bool verify_transaction(transaction *t) {
+bool prepare_transaction_checks(transaction *t, signature_check *checks) {
     unsigned long input_sum = 0, output_sum = 0;
 
     // Check the validity of each input, and record its unspent amount.
     for (int i = 0; i < t->tx_in_count; i++) {
-        if (!verify_transaction_input(&t->tx_ins[i], true)) {
+        long int previous_value;
+        if (!prepare_transaction_input_check(&t->tx_ins[i], true, &checks[i], &previous_value)) {
             general_log(LOG_SCOPE, LOG_ERROR, "One of the transaction input is invalid.");
             return false;
         }
-
-        unsigned int previous_output_index = t->tx_ins[i].previous_outpoint.index;
-        transaction *previous_transaction = get_transaction(t->tx_ins[i].previous_outpoint.hash);
-        input_sum += previous_transaction->tx_outs[previous_output_index].value;
+        input_sum += previous_value;
     }
 
     // Iterate over the outputs and sum up the output sum.
@@ -452,6 +667,31 @@ bool verify_transaction(transaction *t) {
     return true;
 }
 
+/**
+ * Verify a transaction with a txid
+ * @param txid txid of the transaction
+ * @return True if it is valid. False otherwise
+ * @author Junjian Chen
+ */
+bool verify_transaction(transaction *t) {
+    // Transactions of a few inputs, by far the most common, are checked without touching the heap.
+    signature_check stack_checks[TRANSACTION_STACK_CHECKS];
+    signature_check *checks =
+        t->tx_in_count <= TRANSACTION_STACK_CHECKS ? stack_checks : (signature_check *)malloc(t->tx_in_count * sizeof(signature_check));
+    bool result = prepare_transaction_checks(t, checks);
+
+    if (result) {
+        long failed_input = verify_signatures(checks, t->tx_in_count);
+        if (failed_input >= 0) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Failed to verify the signature of input %ld.", failed_input);
+            result = false;
+        }
+    }
+
+    if (checks != stack_checks) free(checks);
+    return result;
+}
+
 /**
  * Cast a transaction to socket transaction for transmitting.
  * @param tx A transaction.
@@ -459,10 +699,20 @@ bool verify_transaction(transaction *t) {
  * @author Junjian Chen
  */
 socket_transaction *cast_to_socket_transaction(transaction *tx) {
+    socket_transaction *socket_tx = (socket_transaction *)malloc(get_transaction_socket_length(tx));
+    write_socket_transaction(tx, socket_tx);
+    return socket_tx;
+}
+
+/**
+ * Write a transaction as a socket transaction into a
+ * buffer of the caller, e.g. in the middle of a block.
+ * @param tx A transaction.
+ * @param socket_tx Where get_transaction_socket_length() bytes are written into.
+ */
+void write_socket_transaction(transaction *tx, socket_transaction *socket_tx) {
     unsigned int tx_in_count = tx->tx_in_count;
     unsigned int tx_out_count = tx->tx_out_count;
-    socket_transaction *socket_tx = (socket_transaction *)malloc(sizeof(socket_transaction) + tx_in_count * sizeof(socket_transaction_input) +
-                                                                 tx_out_count * sizeof(socket_transaction_output));
 
     // Initialize transaction fields.
     socket_tx->version = tx->version;
@@ -477,7 +727,7 @@ socket_transaction *cast_to_socket_transaction(transaction *tx) {
         current_socket_tx_in->script_bytes = tx->tx_ins[i].script_bytes;
         memcpy(current_socket_tx_in->signature_script, tx->tx_ins[i].signature_script, 64);
         current_socket_tx_in->sequence = tx->tx_ins[i].sequence;
-        memcpy(current_socket_tx_in->previous_outpoint.hash, tx->tx_ins[i].previous_outpoint.hash, 64);
+        current_socket_tx_in->previous_outpoint.hash = tx->tx_ins[i].previous_outpoint.hash;
         current_socket_tx_in->previous_outpoint.index = tx->tx_ins[i].previous_outpoint.index;
     }
 
@@ -490,64 +740,295 @@ socket_transaction *cast_to_socket_transaction(transaction *tx) {
         current_socket_tx_out->value = tx->tx_outs[i].value;
         memcpy(current_socket_tx_out->pk_script, tx->tx_outs[i].pk_script, 64);
     }
+}
 
-    return socket_tx;
+/**
+ * Get the data length of the socket transaction a
+ * transaction is cast to, without casting it.
+ * @param tx A transaction.
+ * @return The data length.
+ */
+int get_transaction_socket_length(transaction *tx) {
+    return sizeof(socket_transaction) + tx->tx_in_count * sizeof(socket_transaction_input) + tx->tx_out_count * sizeof(socket_transaction_output);
 }
 
 /**
  * Cast an input socket transaction into a transaction.
+ * Everything it consists of is allocated from one arena.
  * @param socket_transaction A socket transaction.
- * @return A transaction
+ * @param memory_arena The arena to allocate from, which then frees the
+ * transaction; NULL to give it an arena of its own, freed by destroy_transaction().
+ * @return A transaction, or NULL if it is malformed.
  * @author Junjian Chen
  */
-transaction *cast_to_transaction(socket_transaction *socket_transaction) {
+transaction *cast_to_transaction(socket_transaction *socket_transaction, arena *memory_arena) {
+    socket_transaction_view view;
+    if (!view_socket_transaction((const unsigned char *)socket_transaction, get_socket_transaction_length(socket_transaction), &view))
+        return NULL;
+    return materialize_socket_transaction(&view, memory_arena);
+}
+
+/**
+ * Get the data length of a socket transaction.
+ * @param socket_tx A socket transaction.
+ * @return The data length.
+ * @author Junjian Chen
+ */
+int get_socket_transaction_length(socket_transaction *socket_tx) {
+    return sizeof(socket_transaction) + socket_tx->tx_in_count * sizeof(socket_transaction_input) +
+           socket_tx->tx_out_count * sizeof(socket_transaction_output);
+}
+
+/**
+ * Get the bytes of an arena materialize_socket_transaction()
+ * takes up at most for a socket transaction.
+ * @param view A view of the socket transaction.
+ * @return Bytes of the arena.
+ */
+size_t get_socket_transaction_arena_size(socket_transaction_view *view) {
+    size_t script_size = get_arena_allocation_size(65);
+    return get_arena_allocation_size(sizeof(transaction)) + get_arena_allocation_size(view->tx_in_count * sizeof(transaction_input)) +
+           get_arena_allocation_size(view->tx_out_count * sizeof(transaction_output)) +
+           (size_t)(view->tx_in_count + view->tx_out_count) * script_size;
+}
+
+/**
+ * View a socket transaction where it was received. Its
+ * bounds and script lengths are checked once here; the
+ * other view functions trust them.
+ * @param src The socket transaction; it may be followed by other bytes.
+ * @param length Bytes available at src.
+ * @param dest Where the view is written into.
+ * @return True for success, false if the transaction does not fit or a script
+ * is longer than the 64 bytes a socket transaction holds.
+ */
+bool view_socket_transaction(const unsigned char *src, size_t length, socket_transaction_view *dest) {
+    if (length < sizeof(socket_transaction)) return false;
+    dest->data = src;
+    memcpy(&dest->version, src + offsetof(socket_transaction, version), sizeof(dest->version));
+    memcpy(&dest->tx_in_count, src + offsetof(socket_transaction, tx_in_count), sizeof(dest->tx_in_count));
+    memcpy(&dest->tx_out_count, src + offsetof(socket_transaction, tx_out_count), sizeof(dest->tx_out_count));
+    memcpy(&dest->lock_time, src + offsetof(socket_transaction, lock_time), sizeof(dest->lock_time));
+
+    // Each count is bounded by the bytes left, so that nothing overflows.
+    size_t remaining = length - sizeof(socket_transaction);
+    if (dest->tx_in_count > remaining / sizeof(socket_transaction_input)) return false;
+    remaining -= dest->tx_in_count * sizeof(socket_transaction_input);
+    if (dest->tx_out_count > remaining / sizeof(socket_transaction_output)) return false;
+
+    // A script_bytes beyond what is held would make every later reader run past its script.
+    for (unsigned int i = 0; i < dest->tx_in_count; i++) {
+        transaction_input_view input;
+        get_socket_transaction_view_input(dest, i, &input);
+        if (input.script_bytes > 64) return false;
+    }
+    for (unsigned int i = 0; i < dest->tx_out_count; i++) {
+        transaction_output_view output;
+        get_socket_transaction_view_output(dest, i, &output);
+        if (output.pk_script_bytes > 64) return false;
+    }
+    return true;
+}
+
+/**
+ * Get the data length of a viewed socket transaction.
+ * @param view A view.
+ * @return The data length.
+ */
+size_t get_socket_transaction_view_length(socket_transaction_view *view) {
+    return sizeof(socket_transaction) + (size_t)view->tx_in_count * sizeof(socket_transaction_input) +
+           (size_t)view->tx_out_count * sizeof(socket_transaction_output);
+}
+
+/**
+ * Feed a CompactSize count into a hash, as serialize_transaction() writes it.
+ * @param ctx A hash context.
+ * @param n The count.
+ */
+static void update_compact_size(sha256_context *ctx, unsigned long long n) {
+    unsigned char buffer[9];
+    sha256_update(ctx, buffer, write_compact_size(buffer, n) - buffer);
+}
+
+/**
+ * Get the TXID of a viewed socket transaction, the same as
+ * get_transaction_txid() of the transaction it holds. Its raw
+ * transaction format is hashed as it is read off the view.
+ * @param view A view.
+ * @return The TXID.
+ */
+sha256_digest get_socket_transaction_view_txid(socket_transaction_view *view) {
+    unsigned char buffer[8];
+    sha256_context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, buffer, write_le32(buffer, (unsigned int)view->version) - buffer);
+    update_compact_size(&ctx, view->tx_in_count);
+    for (unsigned int i = 0; i < view->tx_in_count; i++) {
+        transaction_input_view input;
+        get_socket_transaction_view_input(view, i, &input);
+        sha256_update(&ctx, input.previous_txid, SHA256_DIGEST_LENGTH);
+        sha256_update(&ctx, buffer, write_le32(buffer, input.previous_index) - buffer);
+        update_compact_size(&ctx, input.script_bytes);
+        sha256_update(&ctx, input.signature_script, input.script_bytes);
+        sha256_update(&ctx, buffer, write_le32(buffer, input.sequence) - buffer);
+    }
+    update_compact_size(&ctx, view->tx_out_count);
+    for (unsigned int i = 0; i < view->tx_out_count; i++) {
+        transaction_output_view output;
+        get_socket_transaction_view_output(view, i, &output);
+        sha256_update(&ctx, buffer, write_le64(buffer, (unsigned long long)output.value) - buffer);
+        update_compact_size(&ctx, output.pk_script_bytes);
+        sha256_update(&ctx, output.pk_script, output.pk_script_bytes);
+    }
+    sha256_update(&ctx, buffer, write_le32(buffer, view->lock_time) - buffer);
+
+    sha256_digest txid;
+    sha256_final(&ctx, &txid);
+    return txid;
+}
+
+/**
+ * Read an input of a viewed socket transaction.
+ * @param view A view.
+ * @param index The index of the input, below its tx_in_count.
+ * @param dest Where the input is written into; its hash and script point into the socket transaction.
+ */
+void get_socket_transaction_view_input(socket_transaction_view *view, unsigned int index, transaction_input_view *dest) {
+    const unsigned char *input = view->data + sizeof(socket_transaction) + (size_t)index * sizeof(socket_transaction_input);
+    dest->previous_txid = input + offsetof(socket_transaction_input, previous_outpoint.hash);
+    memcpy(&dest->previous_index, input + offsetof(socket_transaction_input, previous_outpoint.index), sizeof(dest->previous_index));
+    memcpy(&dest->script_bytes, input + offsetof(socket_transaction_input, script_bytes), sizeof(dest->script_bytes));
+    dest->signature_script = input + offsetof(socket_transaction_input, signature_script);
+    memcpy(&dest->sequence, input + offsetof(socket_transaction_input, sequence), sizeof(dest->sequence));
+}
+
+/**
+ * Read an output of a viewed socket transaction.
+ * @param view A view.
+ * @param index The index of the output, below its tx_out_count.
+ * @param dest Where the output is written into; its script points into the socket transaction.
+ */
+void get_socket_transaction_view_output(socket_transaction_view *view, unsigned int index, transaction_output_view *dest) {
+    const unsigned char *output = view->data + sizeof(socket_transaction) + (size_t)view->tx_in_count * sizeof(socket_transaction_input) +
+                                  (size_t)index * sizeof(socket_transaction_output);
+    memcpy(&dest->value, output + offsetof(socket_transaction_output, value), sizeof(dest->value));
+    memcpy(&dest->pk_script_bytes, output + offsetof(socket_transaction_output, pk_script_bytes), sizeof(dest->pk_script_bytes));
+    dest->pk_script = output + offsetof(socket_transaction_output, pk_script);
+}
+
+/**
+ * Copy a viewed socket transaction into a transaction of
+ * its own. Everything it consists of is allocated from one arena.
+ * @param view A view.
+ * @param memory_arena The arena to allocate from, which then frees the
+ * transaction; NULL to give it an arena of its own, freed by destroy_transaction().
+ * @return A transaction.
+ */
+transaction *materialize_socket_transaction(socket_transaction_view *view, arena *memory_arena) {
+    bool owns_arena = memory_arena == NULL;
+    if (owns_arena) memory_arena = create_arena(get_socket_transaction_arena_size(view));
+
     // Get general transaction fields.
-    transaction *tx = (transaction *)malloc(sizeof(transaction));
-    tx->version = socket_transaction->version;
-    tx->tx_in_count = socket_transaction->tx_in_count;
-    tx->tx_out_count = socket_transaction->tx_out_count;
-    tx->lock_time = socket_transaction->lock_time;
-    tx->tx_ins = (transaction_input *)malloc(tx->tx_in_count * sizeof(transaction_input));
-    tx->tx_outs = (transaction_output *)malloc(tx->tx_out_count * sizeof(transaction_output));
+    transaction *tx = (transaction *)arena_alloc(memory_arena, sizeof(transaction));
+    tx->version = view->version;
+    tx->tx_in_count = view->tx_in_count;
+    tx->tx_out_count = view->tx_out_count;
+    tx->lock_time = view->lock_time;
+    tx->arena = memory_arena;
+    tx->owns_arena = owns_arena;
+    tx->tx_ins = (transaction_input *)arena_alloc(memory_arena, tx->tx_in_count * sizeof(transaction_input));
+    tx->tx_outs = (transaction_output *)arena_alloc(memory_arena, tx->tx_out_count * sizeof(transaction_output));
 
     // Initialize inputs.
-    socket_transaction_input *socket_inputs = (socket_transaction_input *)socket_transaction->transaction_input;
-    for (int i = 0; i < tx->tx_in_count; i++) {
-        socket_transaction_input current_socket_input = socket_inputs[i];
+    for (unsigned int i = 0; i < tx->tx_in_count; i++) {
+        transaction_input_view input;
+        get_socket_transaction_view_input(view, i, &input);
         transaction_input *current_input = &tx->tx_ins[i];
-        current_input->sequence = current_socket_input.sequence;
-        current_input->script_bytes = current_socket_input.script_bytes;
-        current_input->signature_script = (char *)malloc(65);
-        memcpy(current_input->signature_script, current_socket_input.signature_script, 64);
-        current_input->signature_script[64] = '\0';
-        current_input->previous_outpoint.index = current_socket_input.previous_outpoint.index;
-        memcpy(current_input->previous_outpoint.hash, current_socket_input.previous_outpoint.hash, 64);
-        current_input->previous_outpoint.hash[64] = '\0';
+        current_input->sequence = input.sequence;
+        current_input->script_bytes = input.script_bytes;
+        // What follows the script in its 64 bytes is not kept, as for a deserialized transaction.
+        current_input->signature_script = copy_script_into_arena(memory_arena, input.signature_script, input.script_bytes);
+        current_input->previous_outpoint.index = input.previous_index;
+        memcpy(current_input->previous_outpoint.hash.data, input.previous_txid, SHA256_DIGEST_LENGTH);
     }
 
     // Initialize outputs.
-    socket_transaction_output *socket_outputs =
-        (socket_transaction_output *)(socket_transaction->transaction_input + tx->tx_in_count * sizeof(socket_transaction_input));
-    for (int i = 0; i < tx->tx_out_count; i++) {
-        socket_transaction_output current_socket_output = socket_outputs[i];
+    for (unsigned int i = 0; i < tx->tx_out_count; i++) {
+        transaction_output_view output;
+        get_socket_transaction_view_output(view, i, &output);
         transaction_output *current_output = &tx->tx_outs[i];
-        current_output->value = current_socket_output.value;
-        current_output->pk_script_bytes = current_socket_output.pk_script_bytes;
-        current_output->pk_script = (char *)malloc(65);
-        memcpy(current_output->pk_script, current_socket_output.pk_script, 64);
-        current_output->pk_script[64] = '\0';
+        current_output->value = output.value;
+        current_output->pk_script_bytes = output.pk_script_bytes;
+        current_output->pk_script = copy_script_into_arena(memory_arena, output.pk_script, output.pk_script_bytes);
     }
 
+    memoize_transaction_txid(tx);
     return tx;
 }
 
 /**
- * Get the data length of a socket transaction.
- * @param socket_tx A socket transaction.
- * @return The data length.
- * @author Junjian Chen
+ * Serialize a transaction in the raw transaction format:
+ * little endian fields, CompactSize counts, binary hashes
+ * and scripts prefixed by their length. Unlike a socket
+ * transaction, nothing is padded.
+ * @param t A transaction.
+ * @param dest Where get_transaction_size() bytes are written into.
+ * @return The number of bytes written.
  */
-int get_socket_transaction_length(socket_transaction *socket_tx) {
-    return sizeof(socket_transaction) + socket_tx->tx_in_count * sizeof(socket_transaction_input) +
-           socket_tx->tx_out_count * sizeof(socket_transaction_output);
+unsigned int serialize_transaction(transaction *t, unsigned char *dest) {
+    unsigned char *p = write_le32(dest, (unsigned int)t->version);
+    p = write_compact_size(p, t->tx_in_count);
+    for (int i = 0; i < t->tx_in_count; i++) {
+        transaction_input *input = &t->tx_ins[i];
+        memcpy(p, input->previous_outpoint.hash.data, SHA256_DIGEST_LENGTH);
+        p = write_le32(p + SHA256_DIGEST_LENGTH, input->previous_outpoint.index);
+        p = write_compact_size(p, input->script_bytes);
+        memcpy(p, input->signature_script, input->script_bytes);
+        p = write_le32(p + input->script_bytes, input->sequence);
+    }
+    p = write_compact_size(p, t->tx_out_count);
+    for (int i = 0; i < t->tx_out_count; i++) {
+        transaction_output *output = &t->tx_outs[i];
+        p = write_le64(p, (unsigned long long)output->value);
+        p = write_compact_size(p, output->pk_script_bytes);
+        memcpy(p, output->pk_script, output->pk_script_bytes);
+        p += output->pk_script_bytes;
+    }
+    p = write_le32(p, t->lock_time);
+    return p - dest;
+}
+
+/**
+ * Check a serialized transaction and step over it.
+ * @param reader A reader at the start of the transaction, left after its end.
+ * @param arena_size Where the bytes of arena deserialize_transaction() takes for it are added to.
+ * @return True for success, false if it is malformed.
+ */
+bool measure_serialized_transaction(byte_reader *reader, size_t *arena_size) { return parse_serialized_transaction(reader, NULL, NULL, arena_size); }
+
+/**
+ * Read a transaction written by serialize_transaction().
+ * Everything it consists of is allocated from one arena.
+ * @param reader A reader at the start of the transaction, left after its end.
+ * @param memory_arena The arena to allocate from, which then frees the transaction, and whatever
+ * was allocated for it if it is malformed; NULL to give it an arena of its own, as in cast_to_transaction().
+ * @return A transaction, or NULL if it is malformed.
+ */
+transaction *deserialize_transaction(byte_reader *reader, arena *memory_arena) {
+    bool owns_arena = memory_arena == NULL;
+    if (owns_arena) {
+        // Checked up front, so that a malformed transaction costs no arena.
+        byte_reader measuring_reader = *reader;
+        size_t arena_size = 0;
+        if (!measure_serialized_transaction(&measuring_reader, &arena_size)) return NULL;
+        memory_arena = create_arena(arena_size);
+    }
+
+    size_t arena_size = 0;
+    transaction *tx = (transaction *)arena_alloc(memory_arena, sizeof(transaction));
+    if (!parse_serialized_transaction(reader, tx, memory_arena, &arena_size)) return NULL;
+    memoize_transaction_txid(tx);
+    tx->arena = memory_arena;
+    tx->owns_arena = owns_arena;
+    return tx;
 }
\ No newline at end of file
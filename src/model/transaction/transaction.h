@@ -4,7 +4,14 @@
 #include <glib.h>
 #include <stdbool.h>
 
+#include "model/transaction/utxo_table.h"
+#include "utils/arena.h"
 #include "utils/cryptography.h"
+#include "utils/serialize.h"
+#include "utils/signature_verifier.h"
+
+#define TRANSACTION_MAX_SCRIPT_BYTES 10000    // The most bytes a script may take.
+#define SERIALIZED_TRANSACTION_MIN_LENGTH 10  // Version, two zero counts and lock time, in the raw transaction format.
 
 /*
  * The following field is for defining transactions.
@@ -19,7 +26,7 @@
  */
 
 typedef struct TransactionOutpoint {
-    char hash[65];       // The transaction ID (TXID) of the transaction holding the output to spend.
+    sha256_digest hash;  // The transaction ID (TXID) of the transaction holding the output to spend.
     unsigned int index;  // The output index of the specific output to spend from the transaction. Starts from 0.
 } transaction_outpoint;
 
@@ -36,17 +43,31 @@ typedef struct TransactionOutput {
     char *pk_script;               // Defines the conditions which must be met to spend this output.
 } transaction_output;
 
+typedef struct TransactionTxidCache {
+    bool valid;   // False until memoize_transaction_txid() fills it in.
+    int version;  // The fields the TXID was computed from; it is stale once any of them changes.
+    unsigned int tx_in_count;
+    transaction_input *tx_ins;
+    unsigned int tx_out_count;
+    transaction_output *tx_outs;
+    unsigned int lock_time;
+    sha256_digest txid;
+} transaction_txid_cache;
+
 typedef struct Transaction {
-    int version;                  // Transaction version number. Default is 1.
-    unsigned int tx_in_count;     // Number of transaction inputs.
-    transaction_input *tx_ins;    // Array of transaction inputs.
-    unsigned int tx_out_count;    // Number of transaction outputs.
-    transaction_output *tx_outs;  // Array of transaction outputs.
-    unsigned int lock_time;       // A time number.
+    int version;                        // Transaction version number. Default is 1.
+    unsigned int tx_in_count;           // Number of transaction inputs.
+    transaction_input *tx_ins;          // Array of transaction inputs.
+    unsigned int tx_out_count;          // Number of transaction outputs.
+    transaction_output *tx_outs;        // Array of transaction outputs.
+    unsigned int lock_time;             // A time number.
+    transaction_txid_cache txid_cache;  // The memoized TXID.
+    arena *arena;                       // The arena holding all of it, which frees it; NULL if it is on the heap.
+    bool owns_arena;                    // Whether it is alone in its arena, which then goes with it.
 } transaction;
 
 typedef struct TransactionCreateShortcutInput {
-    char *previous_txid;
+    sha256_digest previous_txid;
     unsigned int previous_output_idx;
     char *private_key;
 } transaction_create_shortcut_input;
@@ -70,7 +91,7 @@ typedef struct TransactionCreateShortcut {
  */
 
 typedef struct SocketTransactionOutpoint {
-    char hash[65];       // The transaction ID (TXID) of the transaction holding the output to spend.
+    sha256_digest hash;  // The transaction ID (TXID) of the transaction holding the output to spend.
     unsigned int index;  // The output index of the specific output to spend from the transaction. Starts from 0.
 } socket_transaction_outpoint;
 
@@ -97,6 +118,35 @@ typedef struct SocketTransaction {
 
 } socket_transaction;
 
+/*
+ * Read only views over socket transactions where they were
+ * received. Once view_socket_transaction() has checked the
+ * bounds, inputs and outputs are read straight from the
+ * buffer, which need not be aligned, and nothing is copied
+ * or allocated; scripts point into it.
+ */
+typedef struct SocketTransactionView {
+    const unsigned char *data;  // The socket transaction.
+    int version;                // Transaction version number.
+    unsigned int tx_in_count;   // Number of transaction inputs.
+    unsigned int tx_out_count;  // Number of transaction outputs.
+    unsigned int lock_time;     // A time number.
+} socket_transaction_view;
+
+typedef struct TransactionInputView {
+    const unsigned char *previous_txid;     // The TXID of the outpoint spent, SHA256_DIGEST_LENGTH bytes.
+    unsigned int previous_index;            // The output index of the outpoint spent.
+    unsigned int script_bytes;              // The number of bytes in the signature script, at most 64.
+    const unsigned char *signature_script;  // The 64 bytes of the script the socket transaction holds.
+    unsigned int sequence;                  // Sequence number.
+} transaction_input_view;
+
+typedef struct TransactionOutputView {
+    long int value;                  // Number of crypto to spend.
+    unsigned int pk_script_bytes;    // Number of bytes in the pubkey script, at most 64.
+    const unsigned char *pk_script;  // The 64 bytes of the script the socket transaction holds.
+} transaction_output_view;
+
 /*
  * -----------------------------------------------------------
  * Methods
@@ -106,16 +156,33 @@ typedef struct SocketTransaction {
 transaction *initialize_transaction_system(bool skip_genesis);
 void destroy_transaction_system();
 void destroy_transaction(transaction *);
-char *get_transaction_txid(transaction *);
+sha256_digest get_transaction_txid(transaction *);
+void memoize_transaction_txid(transaction *);
 char *get_genesis_transaction_private_key();
 secp256k1_pubkey *get_genesis_transaction_public_key();
-transaction *get_transaction_by_txid(char *);
+transaction *get_transaction_by_txid(sha256_digest *);
 bool create_new_transaction_shortcut(transaction_create_shortcut *, transaction *);
 bool finalize_transaction(transaction *);
 socket_transaction *cast_to_socket_transaction(transaction *);
-transaction *cast_to_transaction(socket_transaction *);
+void write_socket_transaction(transaction *, socket_transaction *);
+int get_transaction_socket_length(transaction *);
+transaction *cast_to_transaction(socket_transaction *, arena *);
 int get_socket_transaction_length(socket_transaction *);
+size_t get_socket_transaction_arena_size(socket_transaction_view *);
+bool view_socket_transaction(const unsigned char *, size_t, socket_transaction_view *);
+size_t get_socket_transaction_view_length(socket_transaction_view *);
+sha256_digest get_socket_transaction_view_txid(socket_transaction_view *);
+void get_socket_transaction_view_input(socket_transaction_view *, unsigned int, transaction_input_view *);
+void get_socket_transaction_view_output(socket_transaction_view *, unsigned int, transaction_output_view *);
+transaction *materialize_socket_transaction(socket_transaction_view *, arena *);
 bool verify_transaction(transaction *);
+bool prepare_transaction_checks(transaction *, signature_check *);
 void print_target_utxo(GHashTable *target_utxo);
-char *hash_transaction_outpoint(transaction_outpoint *);
+sha256_digest hash_transaction_outpoint(transaction_outpoint *);
+void get_outpoint_utxo_key(transaction_outpoint *, utxo_key *);
+void get_transaction_input_signature_check(transaction_input *, transaction_output *, signature_check *);
+unsigned int get_transaction_size(transaction *);
+unsigned int serialize_transaction(transaction *, unsigned char *);
+bool measure_serialized_transaction(byte_reader *, size_t *);
+transaction *deserialize_transaction(byte_reader *, arena *);
 #endif
@@ -2,18 +2,38 @@
 
 #include <glib.h>
 #include <mysql.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "model/transaction/utxo_cache.h"
+#include "model/transaction/utxo_set.h"
 #include "utils/constants.h"
+#include "utils/hex.h"
 #include "utils/log_utils.h"
 #include "utils/mysql_util.h"
 
 #define LOG_SCOPE "transaction_persistence"
+#define UTXO_FLUSH_BATCH_ROWS 1000  // Rows per statement when the UTXO cache is written back.
 
-static GHashTable *g_global_transaction_table;     // The global transaction table, mapping TXID to transaction.
-static GHashTable *g_utxo;                         // Unspent Transaction Output. mapping each transaction output to its value left.
+static GHashTable *g_global_transaction_table;     // The global transaction table, mapping binary TXID to transaction.
+static pthread_rwlock_t g_global_transaction_table_lock = PTHREAD_RWLOCK_INITIALIZER;
+static utxo_set *g_utxo;                           // Unspent Transaction Output, mapping each binary outpoint to its value left. Thread safe.
+static utxo_cache *g_utxo_cache;                   // In MySQL mode, the write-back cache in front of table utxo.
+static pthread_mutex_t g_utxo_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 static transaction *g_genesis_transaction = NULL;  // The genesis transaction.
 
+/*
+ * Statements being built to write the UTXO cache back.
+ */
+typedef struct UtxoFlushBatch {
+    GString *upserts;
+    unsigned int upsert_rows;
+    GString *deletes;
+    unsigned int delete_rows;
+    bool ok;
+} utxo_flush_batch;
+
 /*
  * -----------------------------------------------------------
  * Helper methods.
@@ -23,14 +43,144 @@ void free_transaction_table_key(void *key) { free(key); }
 
 void free_transaction_table_val(void *val) { destroy_transaction(val); }
 
-void free_utxo_table_key(void *key) { free(key); }
+void print_utxo_entry(const utxo_key *key, long int value, void *user_data) {
+    char hash[SHA256_HEX_LENGTH];
+    encode_hex(key->txid, SHA256_DIGEST_LENGTH, hash);
+    printf("ID: %s:%u VAL: %ld\n", hash, key->index, value);
+}
+
+/**
+ * Read the value of an outpoint from table utxo.
+ * @param key An outpoint.
+ * @param value Where the value is written into.
+ * @return True if the outpoint is there, false otherwise.
+ */
+static bool read_utxo_entry_from_database(const utxo_key *key, long int *value) {
+    char key_hex[SHA256_HEX_LENGTH];
+    encode_hex(key->txid, SHA256_DIGEST_LENGTH, key_hex);
+    char sql_query[1000];
+    memset(sql_query, '\0', 1000);
+    sprintf(sql_query, "select value from utxo where hash='%s' and idx=%u;\n", key_hex, key->index);
+    MYSQL_RES *res = mysql_read(sql_query);
+    if (res == NULL) return false;
+    MYSQL_ROW row = mysql_fetch_row(res);
+    bool found = row != NULL;
+    if (found) *value = atol(row[0]);
+    mysql_free_result(res);
+    return found;
+}
+
+/**
+ * Look an outpoint up in the UTXO cache, reading it
+ * from table utxo on a miss. The cache must be locked.
+ * @param key An outpoint.
+ * @return True if it is unspent, false otherwise.
+ */
+static bool fetch_utxo_cache_entry(const utxo_key *key) {
+    switch (lookup_utxo_cache_entry(g_utxo_cache, key, NULL)) {
+        case UTXO_CACHE_HIT:
+            return true;
+        case UTXO_CACHE_HIT_SPENT:
+            return false;
+        case UTXO_CACHE_MISS:
+        default: {
+            long int value;
+            if (!read_utxo_entry_from_database(key, &value)) return false;
+            load_utxo_cache_entry(g_utxo_cache, key, value);
+            return true;
+        }
+    }
+}
+
+/**
+ * Run the statements of a batch built so far.
+ * @param batch The batch.
+ */
+static void execute_utxo_flush_batch(utxo_flush_batch *batch) {
+    if (batch->upsert_rows > 0) {
+        g_string_append(batch->upserts, " on duplicate key update value = values(value);");
+        batch->ok = batch->ok && mysql_insert(batch->upserts->str);
+        g_string_truncate(batch->upserts, 0);
+        batch->upsert_rows = 0;
+    }
+    if (batch->delete_rows > 0) {
+        g_string_append(batch->deletes, ");");
+        batch->ok = batch->ok && mysql_delete(batch->deletes->str);
+        g_string_truncate(batch->deletes, 0);
+        batch->delete_rows = 0;
+    }
+}
+
+/**
+ * Add a dirty UTXO cache entry to a batch.
+ * @param key The outpoint.
+ * @param value Its value.
+ * @param spent Whether it is to be deleted.
+ * @param user_data The batch.
+ */
+static void add_utxo_flush_row(const utxo_key *key, long int value, bool spent, void *user_data) {
+    utxo_flush_batch *batch = (utxo_flush_batch *)user_data;
+    char key_hex[SHA256_HEX_LENGTH];
+    encode_hex(key->txid, SHA256_DIGEST_LENGTH, key_hex);
+
+    if (spent) {
+        g_string_append(batch->deletes, batch->delete_rows++ == 0 ? "delete from utxo where (hash, idx) in (" : ",");
+        g_string_append_printf(batch->deletes, "('%s',%u)", key_hex, key->index);
+    } else {
+        g_string_append(batch->upserts, batch->upsert_rows++ == 0 ? "insert into utxo (hash, idx, value) values " : ",");
+        g_string_append_printf(batch->upserts, "('%s',%u,%ld)", key_hex, key->index, value);
+    }
+
+    if (batch->upsert_rows >= UTXO_FLUSH_BATCH_ROWS || batch->delete_rows >= UTXO_FLUSH_BATCH_ROWS) execute_utxo_flush_batch(batch);
+}
 
-void free_utxo_table_val(void *val) { free(val); }
+/**
+ * Write every dirty entry of the UTXO cache back into
+ * table utxo, in one transaction of a few large
+ * statements. The cache must be locked.
+ * @return True for success and false otherwise.
+ */
+static bool write_back_utxo_cache() {
+    if (get_utxo_cache_dirty_count(g_utxo_cache) == 0) return true;
+
+    utxo_flush_batch batch = {.upserts = g_string_new(NULL), .deletes = g_string_new(NULL), .ok = mysql_update("start transaction;")};
+    foreach_dirty_utxo_cache_entry(g_utxo_cache, add_utxo_flush_row, &batch);
+    execute_utxo_flush_batch(&batch);
+    batch.ok = batch.ok && mysql_update("commit;");
+    g_string_free(batch.upserts, TRUE);
+    g_string_free(batch.deletes, TRUE);
+
+    if (!batch.ok) {
+        mysql_update("rollback;");
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to write %zu UTXO entries back.", get_utxo_cache_dirty_count(g_utxo_cache));
+        return false;
+    }
+    mark_utxo_cache_clean(g_utxo_cache);
+    return true;
+}
+
+/**
+ * Write the UTXO cache back and evict clean entries
+ * if it has outgrown its budget. The cache must be locked.
+ * @return True for success and false otherwise.
+ */
+static bool enforce_utxo_cache_budget() {
+    if (!is_utxo_cache_over_budget(g_utxo_cache)) return true;
+    bool result = write_back_utxo_cache();
+    evict_utxo_cache_entries(g_utxo_cache);
+    return result;
+}
 
-void print_utxo_entry(void *h, void *v, void *user_data) {
-    char *hash = (char *)h;
-    long int *value = (long int *)v;
-    printf("ID: %s VAL: %ld\n", hash, *value);
+/**
+ * Copy a digest onto the heap so that it can
+ * be owned by a hash table as its key.
+ * @param digest A digest.
+ * @return A heap copy of the digest.
+ */
+sha256_digest *copy_digest_as_table_key(sha256_digest *digest) {
+    sha256_digest *key = (sha256_digest *)malloc(sizeof(sha256_digest));
+    *key = *digest;
+    return key;
 }
 
 /*
@@ -94,16 +244,19 @@ bool initialize_transaction_persistence() {
             "create table if not exists utxo\n"
             "(\n"
             "    id    int auto_increment,\n"
-            "    hash  char(64) not null,\n"
-            "    value bigint   not null,\n"
-            "    primary key (id)\n"
+            "    hash  char(64)     not null,\n"
+            "    idx   int unsigned not null,\n"
+            "    value bigint       not null,\n"
+            "    primary key (id),\n"
+            "    unique key outpoint (hash, idx)\n"
             ") ENGINE = %s;";
         char filtered_query[10000];
         sprintf(filtered_query, sql_query, PERSISTENCE_ENGINE, PERSISTENCE_ENGINE, PERSISTENCE_ENGINE, PERSISTENCE_ENGINE, PERSISTENCE_ENGINE);
+        g_utxo_cache = create_utxo_cache(UTXO_CACHE_MEMORY_BUDGET);
         return mysql_create_table(filtered_query);
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        g_global_transaction_table = g_hash_table_new_full(g_str_hash, g_str_equal, free_transaction_table_key, free_transaction_table_val);
-        g_utxo = g_hash_table_new_full(g_str_hash, g_str_equal, free_utxo_table_key, free_utxo_table_val);
+        g_global_transaction_table = g_hash_table_new_full(hash_digest_key, are_digest_keys_equal, free_transaction_table_key, free_transaction_table_val);
+        g_utxo = create_utxo_set();
     }
 
     return false;
@@ -122,7 +275,9 @@ bool save_transaction(transaction *tx) {
     }
 
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
-        char *txid = get_transaction_txid(tx);
+        sha256_digest txid_digest = get_transaction_txid(tx);
+        char txid[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(&txid_digest, txid);
         int temp_sql_query_size = 10000;
 
         // Save the transaction in table transaction.
@@ -146,13 +301,13 @@ bool save_transaction(transaction *tx) {
             general_log(LOG_SCOPE, LOG_ERROR, "Failed to insert transaction.");
             return false;
         };
-        free(txid);
         memset(sql_query, '\0', temp_sql_query_size);
 
         // Insert transaction outputs.
         for (int i = 0; i < tx->tx_out_count; i++) {
             transaction_output current_output = tx->tx_outs[i];
-            char *pk_script_hex = convert_char_hexadecimal(current_output.pk_script, current_output.pk_script_bytes);
+            char pk_script_hex[2 * current_output.pk_script_bytes + 1];
+            encode_hex(current_output.pk_script, current_output.pk_script_bytes, pk_script_hex);
             sprintf(sql_query,
                     "set @value = %ld;\n"
                     "set @pk_script_bytes = %d;\n"
@@ -167,14 +322,16 @@ bool save_transaction(transaction *tx) {
                 return false;
             }
             memset(sql_query, '\0', temp_sql_query_size);
-            free(pk_script_hex);
         }
 
         // Insert transaction inputs.
         for (int i = 0; i < tx->tx_in_count; i++) {
             transaction_input current_input = tx->tx_ins[i];
-            char *signature_script_hex = convert_char_hexadecimal(current_input.signature_script, current_input.script_bytes);
+            char signature_script_hex[2 * current_input.script_bytes + 1];
+            encode_hex(current_input.signature_script, current_input.script_bytes, signature_script_hex);
             transaction_outpoint current_outpoint = current_input.previous_outpoint;
+            char outpoint_hash_hex[SHA256_HEX_LENGTH];
+            convert_digest_to_hex(&current_outpoint.hash, outpoint_hash_hex);
             sprintf(sql_query,
                     "set @script_bytes = %u;\n"
                     "set @signature_script = 0x%s;\n"
@@ -189,19 +346,20 @@ bool save_transaction(transaction *tx) {
                     current_input.script_bytes,
                     signature_script_hex,
                     current_input.sequence,
-                    current_outpoint.hash,
+                    outpoint_hash_hex,
                     current_outpoint.index);
             if (!mysql_insert(sql_query)) {
                 general_log(LOG_SCOPE, LOG_ERROR, "Failed to insert input.");
                 return false;
             }
-            free(signature_script_hex);
         }
 
         return true;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        char *txid = get_transaction_txid(tx);
-        g_hash_table_insert(g_global_transaction_table, txid, tx);
+        sha256_digest txid = get_transaction_txid(tx);
+        pthread_rwlock_wrlock(&g_global_transaction_table_lock);
+        g_hash_table_insert(g_global_transaction_table, copy_digest_as_table_key(&txid), tx);
+        pthread_rwlock_unlock(&g_global_transaction_table_lock);
         return true;
     }
 
@@ -210,31 +368,21 @@ bool save_transaction(transaction *tx) {
 
 /**
  * Save a utxo entry.
- * @param key The key.
+ * @param key The outpoint.
  * @param value The value.
  * @return True for success and false otherwise.
  * @author Ing Tian
  */
-bool save_utxo_entry(char *key, long int *value) {
+bool save_utxo_entry(const utxo_key *key, long int value) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
-        int temp_sql_query_size = 10000;
-        char sql_query[temp_sql_query_size];
-        memset(sql_query, '\0', temp_sql_query_size);
-        sprintf(sql_query,
-                "set @hash := '%s';\n"
-                "set @value := %ld;\n"
-                "insert into utxo (id, hash, value)\n"
-                "values (NULL, @hash, @value);\n",
-                key,
-                *value);
-        if (!mysql_insert(sql_query)) {
-            general_log(LOG_SCOPE, LOG_ERROR, "Failed to insert UTXO entry.");
-            return false;
-        } else {
-            return true;
-        };
+        pthread_mutex_lock(&g_utxo_cache_lock);
+        // Table utxo is not asked, so the entry cannot be fresh.
+        put_utxo_cache_entry(g_utxo_cache, key, value, false);
+        bool result = enforce_utxo_cache_budget();
+        pthread_mutex_unlock(&g_utxo_cache_lock);
+        return result;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        g_hash_table_insert(g_utxo, key, value);
+        put_utxo_set_entry(g_utxo, key, value);
         return true;
     }
 
@@ -243,30 +391,106 @@ bool save_utxo_entry(char *key, long int *value) {
 
 /**
  * Remove a UTXO entry.
- * @param key A key.
+ * @param key An outpoint.
  * @return True for success and false otherwise.
  * @author Ing Tian
  */
-bool remove_utxo_entry(char *key) {
+bool remove_utxo_entry(const utxo_key *key) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
-        int temp_sql_query_size = 10000;
-        char sql_query[temp_sql_query_size];
-        memset(sql_query, '\0', temp_sql_query_size);
-        sprintf(sql_query, "delete from utxo where hash='%s';\n", key);
-        if (!mysql_delete(sql_query)) {
-            general_log(LOG_SCOPE, LOG_ERROR, "Failed to delete UTXO entry.");
-            return false;
-        } else {
-            return true;
-        };
+        spend_utxo_entry(key, NULL);
+        return true;
+    } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
+        spend_utxo_set_entry(g_utxo, key, NULL);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Remove a UTXO entry if it is still there, atomically.
+ * When several threads spend the same outpoint at once,
+ * exactly one of them succeeds.
+ * @param key An outpoint.
+ * @param value Where the value of the spent entry is written into; may be NULL.
+ * @return True if this call spent the entry, false if it was already gone.
+ */
+bool spend_utxo_entry(const utxo_key *key, long int *value) {
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        pthread_mutex_lock(&g_utxo_cache_lock);
+        bool result = fetch_utxo_cache_entry(key) && spend_utxo_cache_entry(g_utxo_cache, key, value);
+        enforce_utxo_cache_budget();
+        pthread_mutex_unlock(&g_utxo_cache_lock);
+        return result;
+    } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
+        return spend_utxo_set_entry(g_utxo, key, value);
+    }
+
+    return false;
+}
+
+/**
+ * Make every UTXO change so far durable. In MySQL mode
+ * the cached changes are written back in one batch;
+ * this is done at every block boundary.
+ * @return True for success and false otherwise.
+ */
+bool flush_utxo_entries() {
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        pthread_mutex_lock(&g_utxo_cache_lock);
+        bool result = write_back_utxo_cache();
+        pthread_mutex_unlock(&g_utxo_cache_lock);
+        return result;
+    }
+    return true;
+}
+
+/**
+ * Remove every UTXO entry, e.g., before loading
+ * a snapshot of another UTXO.
+ * @param expected_size Number of entries about to be saved, to make room for.
+ * @return True for success and false otherwise.
+ */
+bool clear_utxo_entries(size_t expected_size) {
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        pthread_mutex_lock(&g_utxo_cache_lock);
+        destroy_utxo_cache(g_utxo_cache);
+        g_utxo_cache = create_utxo_cache(UTXO_CACHE_MEMORY_BUDGET);
+        bool result = mysql_delete("delete from utxo;");
+        pthread_mutex_unlock(&g_utxo_cache_lock);
+        return result;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        g_hash_table_remove(g_utxo, key);
+        clear_utxo_set(g_utxo, expected_size);
         return true;
     }
 
     return false;
 }
 
+/**
+ * Call a function on every UTXO entry, in no particular
+ * order. The UTXO must not be modified meanwhile.
+ * @param callback The function.
+ * @param user_data Passed along to the function.
+ */
+void foreach_utxo_entry(utxo_table_callback callback, void *user_data) {
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        if (!flush_utxo_entries()) return;
+        MYSQL_RES *res = mysql_read("select hash, idx, value from utxo;");
+        if (res == NULL) return;
+        MYSQL_ROW row;
+        while ((row = mysql_fetch_row(res)) != NULL) {
+            utxo_key key;
+            if (!decode_hex(row[0], SHA256_DIGEST_LENGTH, key.txid)) continue;
+            key.index = strtoul(row[1], NULL, 10);
+            callback(&key, atol(row[2]), user_data);
+        }
+        mysql_free_result(res);
+    } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
+        foreach_utxo_set_entry(g_utxo, callback, user_data);
+    }
+}
+
 /**
  * Print UTXO inside the system.
  * @author Ing Tian
@@ -276,7 +500,7 @@ void print_utxo() {
         return;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
         printf("**************************** UTXO *****************************\n");
-        g_hash_table_foreach(g_utxo, print_utxo_entry, NULL);
+        foreach_utxo_set_entry(g_utxo, print_utxo_entry, NULL);
         printf("\n");
     }
 }
@@ -288,12 +512,14 @@ void print_utxo() {
  * @return True for success and false otherwise.
  * @author Ing Tian
  */
-bool update_transaction_block_id(unsigned long block_id, char *txid) {
+bool update_transaction_block_id(unsigned long block_id, sha256_digest *txid) {
+    char txid_hex[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(txid, txid_hex);
     char sql_query[1000];
     memset(sql_query, '\0', 1000);
-    sprintf(sql_query, "update transaction set block_id=%lu where txid='%s';", block_id, txid);
+    sprintf(sql_query, "update transaction set block_id=%lu where txid='%s';", block_id, txid_hex);
     if (!mysql_update(sql_query)) {
-        general_log(LOG_SCOPE, LOG_ERROR, "Failed to update block ID (%d) for a transaction (%s).", block_id, txid);
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to update block ID (%d) for a transaction (%s).", block_id, txid_hex);
         return false;
     }
     return true;
@@ -302,23 +528,27 @@ bool update_transaction_block_id(unsigned long block_id, char *txid) {
 /**
  * Get a transaction from the database by its txid.
  * @param txid The transaction ID.
- * @return A transaction.
+ * @return A transaction, or NULL if there is none.
  * @author Ing Tian
  */
-transaction *get_transaction(char *txid) {
+transaction *get_transaction(sha256_digest *txid) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
         transaction *tx = (transaction *)malloc(sizeof(transaction));
+        tx->txid_cache.valid = false;
+        tx->arena = NULL;
+        char txid_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(txid, txid_hex);
 
         int temp_sql_query_size = 10000;
         char sql_query[temp_sql_query_size];
         memset(sql_query, '\0', temp_sql_query_size);
 
-        sprintf(sql_query, "select * from transaction where txid='%s';", txid);
+        sprintf(sql_query, "select * from transaction where txid='%s';", txid_hex);
         MYSQL_RES *res = mysql_read(sql_query);
 
         // Read transaction.
         MYSQL_ROW row;
-        int transaction_auto_id;
+        int transaction_auto_id = -1;
         while ((row = mysql_fetch_row(res))) {
             transaction_auto_id = atoi(row[0]);
             tx->version = atoi(row[2]);
@@ -326,6 +556,11 @@ transaction *get_transaction(char *txid) {
             tx->tx_out_count = atoi(row[4]);
             tx->lock_time = atoi(row[5]);
         }
+        if (transaction_auto_id < 0) {
+            mysql_free_result(res);
+            free(tx);
+            return NULL;
+        }
         tx->tx_ins = (transaction_input *)malloc(tx->tx_in_count * sizeof(transaction_input));
         memset(tx->tx_ins, 0, tx->tx_in_count * sizeof(transaction_input));
         tx->tx_outs = (transaction_output *)malloc(tx->tx_out_count * sizeof(transaction_output));
@@ -374,21 +609,34 @@ transaction *get_transaction(char *txid) {
             row = mysql_fetch_row(res);
             transaction_outpoint *current_outpoint = &tx->tx_ins[outpoint_idx].previous_outpoint;
             current_outpoint->index = atoi(row[2]);
-            memset(current_outpoint->hash, '\0', 65);
-            memcpy(current_outpoint->hash, row[1], 64);
+            convert_hex_to_digest(row[1], &current_outpoint->hash);
 
             mysql_free_result(res);
             memset(sql_query, '\0', temp_sql_query_size);
         }
 
+        memoize_transaction_txid(tx);
         return tx;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        return g_hash_table_lookup(g_global_transaction_table, txid);
+        pthread_rwlock_rdlock(&g_global_transaction_table_lock);
+        transaction *tx = g_hash_table_lookup(g_global_transaction_table, txid);
+        pthread_rwlock_unlock(&g_global_transaction_table_lock);
+        return tx;
     }
 
     return NULL;
 }
 
+/**
+ * Release a transaction got from get_transaction once done with it.
+ * Only the database hands out copies, which are freed here; those
+ * in the RAM table stay registered.
+ * @param tx The transaction; may be NULL.
+ */
+void release_transaction(transaction *tx) {
+    if (PERSISTENCE_MODE == PERSISTENCE_MYSQL && tx != NULL) destroy_transaction(tx);
+}
+
 /**
  * Get the genesis transaction.
  * @return The genesis transaction.
@@ -404,14 +652,13 @@ transaction *get_genesis_transaction() {
         MYSQL_RES *res = mysql_read(sql_query);
 
         MYSQL_ROW row;
-        char genesis_txid[65];
-        genesis_txid[64] = '\0';
+        sha256_digest genesis_txid;
         while ((row = mysql_fetch_row(res))) {
-            strcpy(genesis_txid, row[0]);
+            convert_hex_to_digest(row[0], &genesis_txid);
         }
 
         mysql_free_result(res);
-        transaction *genesis_transaction = get_transaction(genesis_txid);
+        transaction *genesis_transaction = get_transaction(&genesis_txid);
         g_genesis_transaction = genesis_transaction;
         return genesis_transaction;
     }
@@ -425,17 +672,22 @@ transaction *get_genesis_transaction() {
  * @return True if the transaction exists and false otherwise.
  * @author Ing Tian
  */
-bool does_transaction_exist(char *txid) {
+bool does_transaction_exist(sha256_digest *txid) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        char txid_hex[SHA256_HEX_LENGTH];
+        convert_digest_to_hex(txid, txid_hex);
         char sql_query[1000];
         memset(sql_query, '\0', 1000);
-        sprintf(sql_query, "select * from transaction where txid='%s';", txid);
+        sprintf(sql_query, "select * from transaction where txid='%s';", txid_hex);
         MYSQL_RES *res = mysql_read(sql_query);
         bool result = res->row_count > 0;
         mysql_free_result(res);
         return result;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        return g_hash_table_contains(g_global_transaction_table, txid);
+        pthread_rwlock_rdlock(&g_global_transaction_table_lock);
+        bool result = g_hash_table_contains(g_global_transaction_table, txid);
+        pthread_rwlock_unlock(&g_global_transaction_table_lock);
+        return result;
     }
 
     return false;
@@ -443,21 +695,19 @@ bool does_transaction_exist(char *txid) {
 
 /**
  * Check if a key exists in UTXO.
- * @param key A UTXO key.
+ * @param key An outpoint.
  * @return True for exists and false otherwise.
  * @author Ing Tian
  */
-bool does_utxo_entry_exist(char *key) {
+bool does_utxo_entry_exist(const utxo_key *key) {
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
-        char sql_query[1000];
-        memset(sql_query, '\0', 1000);
-        sprintf(sql_query, "select * from utxo where hash='%s';\n", key);
-        MYSQL_RES *res = mysql_read(sql_query);
-        bool result = res->row_count > 0;
-        mysql_free_result(res);
+        pthread_mutex_lock(&g_utxo_cache_lock);
+        bool result = fetch_utxo_cache_entry(key);
+        enforce_utxo_cache_budget();
+        pthread_mutex_unlock(&g_utxo_cache_lock);
         return result;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        return g_hash_table_contains(g_utxo, key);
+        return get_utxo_set_entry(g_utxo, key, NULL);
     }
 
     return false;
@@ -472,6 +722,10 @@ bool does_utxo_entry_exist(char *key) {
 bool destroy_transaction_persistence() {
     bool res = false;
     if (PERSISTENCE_MODE == PERSISTENCE_MYSQL) {
+        flush_utxo_entries();
+        destroy_utxo_cache(g_utxo_cache);
+        g_utxo_cache = NULL;
+
         char *sql_query =
             "drop table if exists transaction_outpoint;\n"
             "drop table if exists transaction_input;\n"
@@ -482,8 +736,8 @@ bool destroy_transaction_persistence() {
             general_log(LOG_SCOPE, LOG_ERROR, "Failed to delete tables.");
         }
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        g_hash_table_remove_all(g_utxo);
-        g_hash_table_destroy(g_utxo);
+        destroy_utxo_set(g_utxo);
+        g_utxo = NULL;
         g_hash_table_remove_all(g_global_transaction_table);
         g_hash_table_destroy(g_global_transaction_table);
         res = true;
@@ -513,7 +767,10 @@ unsigned int get_total_number_of_transactions() {
 
         return answer;
     } else if (PERSISTENCE_MODE == PERSISTENCE_RAM) {
-        return g_hash_table_size(g_global_transaction_table);
+        pthread_rwlock_rdlock(&g_global_transaction_table_lock);
+        unsigned int size = g_hash_table_size(g_global_transaction_table);
+        pthread_rwlock_unlock(&g_global_transaction_table_lock);
+        return size;
     }
     return -1;
 }
@@ -531,13 +788,12 @@ transaction *get_last_inserted_transaction() {
     MYSQL_RES *res = mysql_read(sql_query);
 
     MYSQL_ROW row;
-    char temp_txid[65];
-    temp_txid[64] = '\0';
+    sha256_digest temp_txid;
     while ((row = mysql_fetch_row(res))) {
-        strcpy(temp_txid, row[0]);
+        convert_hex_to_digest(row[0], &temp_txid);
     }
 
     mysql_free_result(res);
-    transaction *tx = get_transaction(temp_txid);
+    transaction *tx = get_transaction(&temp_txid);
     return tx;
 }
@@ -6,15 +6,20 @@
 
 bool initialize_transaction_persistence();
 bool save_transaction(transaction *);
-bool save_utxo_entry(char *, long int *);
+bool save_utxo_entry(const utxo_key *, long int);
 void print_utxo();
-bool remove_utxo_entry(char *);
-bool update_transaction_block_id(unsigned long, char *);
-transaction *get_transaction(char *);
+bool remove_utxo_entry(const utxo_key *);
+bool spend_utxo_entry(const utxo_key *, long int *);
+bool flush_utxo_entries();
+bool clear_utxo_entries(size_t);
+void foreach_utxo_entry(utxo_table_callback, void *);
+bool update_transaction_block_id(unsigned long, sha256_digest *);
+transaction *get_transaction(sha256_digest *);
+void release_transaction(transaction *);
 transaction *get_genesis_transaction();
 transaction *get_last_inserted_transaction();
-bool does_transaction_exist(char *);
-bool does_utxo_entry_exist(char *);
+bool does_transaction_exist(sha256_digest *);
+bool does_utxo_entry_exist(const utxo_key *);
 bool destroy_transaction_persistence();
 unsigned int get_total_number_of_transactions();
 
@@ -0,0 +1,258 @@
+#include "utxo_cache.h"
+
+#include <stdlib.h>
+
+#define UTXO_CACHE_INITIAL_CAPACITY 64
+
+// Memory an entry costs: itself plus about two index slots, as the index is kept between 7/16 and 7/8 full.
+#define UTXO_CACHE_ENTRY_COST (sizeof(utxo_cache_entry) + 2 * (sizeof(unsigned char) + sizeof(utxo_key) + sizeof(long int)))
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Grow the entries of a cache, chaining the new ones into the free list.
+ * @param cache The cache.
+ * @param capacity The new number of entries.
+ */
+static void grow_utxo_cache_entries(utxo_cache *cache, size_t capacity) {
+    cache->entries = (utxo_cache_entry *)realloc(cache->entries, capacity * sizeof(utxo_cache_entry));
+    for (size_t i = cache->capacity; i < capacity; i++) {
+        cache->entries[i].flags = 0;
+        cache->entries[i].value = i + 1 < capacity ? (long int)(i + 1) : cache->free_list;
+    }
+    cache->free_list = (long int)cache->capacity;
+    cache->capacity = capacity;
+}
+
+/**
+ * Add an entry to a cache. The outpoint must not be cached yet.
+ * @param cache The cache.
+ * @param key The outpoint.
+ * @param value The value.
+ * @param flags The flags of the entry.
+ */
+static void add_utxo_cache_entry(utxo_cache *cache, const utxo_key *key, long int value, unsigned char flags) {
+    if (cache->free_list < 0) grow_utxo_cache_entries(cache, cache->capacity * 2);
+
+    long int slot = cache->free_list;
+    utxo_cache_entry *entry = &cache->entries[slot];
+    cache->free_list = entry->value;
+    entry->key = *key;
+    entry->value = value;
+    entry->flags = flags;
+    put_utxo_table_entry(cache->index, key, slot);
+
+    cache->count++;
+    if (flags & UTXO_CACHE_DIRTY) cache->dirty++;
+}
+
+/**
+ * Drop an entry from a cache.
+ * @param cache The cache.
+ * @param slot The position of the entry.
+ */
+static void release_utxo_cache_entry(utxo_cache *cache, size_t slot) {
+    utxo_cache_entry *entry = &cache->entries[slot];
+    remove_utxo_table_entry(cache->index, &entry->key);
+    if (entry->flags & UTXO_CACHE_DIRTY) cache->dirty--;
+    entry->flags = 0;
+    entry->value = cache->free_list;
+    cache->free_list = (long int)slot;
+    cache->count--;
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Create an empty UTXO cache.
+ * @param memory_budget Bytes the cache may occupy before it should be flushed and evicted.
+ * @return The cache.
+ */
+utxo_cache *create_utxo_cache(size_t memory_budget) {
+    utxo_cache *cache = (utxo_cache *)malloc(sizeof(utxo_cache));
+    cache->index = create_utxo_table(0);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+    cache->dirty = 0;
+    cache->max_count = memory_budget / UTXO_CACHE_ENTRY_COST;
+    if (cache->max_count < UTXO_CACHE_INITIAL_CAPACITY) cache->max_count = UTXO_CACHE_INITIAL_CAPACITY;
+    cache->hand = 0;
+    cache->free_list = -1;
+    grow_utxo_cache_entries(cache, UTXO_CACHE_INITIAL_CAPACITY);
+    return cache;
+}
+
+/**
+ * Destroy a UTXO cache, dropping whatever was not written back.
+ * @param cache The cache.
+ */
+void destroy_utxo_cache(utxo_cache *cache) {
+    if (cache == NULL) return;
+    destroy_utxo_table(cache->index);
+    free(cache->entries);
+    free(cache);
+}
+
+/**
+ * Look up an outpoint.
+ * @param cache The cache.
+ * @param key The outpoint.
+ * @param value Where the value is written into on a hit; may be NULL.
+ * @return UTXO_CACHE_HIT if it is unspent, UTXO_CACHE_HIT_SPENT if it
+ * is known to be spent, and UTXO_CACHE_MISS if the backing store has to be asked.
+ */
+utxo_cache_lookup lookup_utxo_cache_entry(utxo_cache *cache, const utxo_key *key, long int *value) {
+    long int slot;
+    if (!get_utxo_table_entry(cache->index, key, &slot)) return UTXO_CACHE_MISS;
+
+    utxo_cache_entry *entry = &cache->entries[slot];
+    if (entry->flags & UTXO_CACHE_SPENT) return UTXO_CACHE_HIT_SPENT;
+    entry->flags |= UTXO_CACHE_REFERENCED;
+    if (value != NULL) *value = entry->value;
+    return UTXO_CACHE_HIT;
+}
+
+/**
+ * Cache an outpoint read from the backing store. It must not be cached yet.
+ * @param cache The cache.
+ * @param key The outpoint.
+ * @param value Its value.
+ */
+void load_utxo_cache_entry(utxo_cache *cache, const utxo_key *key, long int value) {
+    add_utxo_cache_entry(cache, key, value, UTXO_CACHE_USED | UTXO_CACHE_REFERENCED);
+}
+
+/**
+ * Create an outpoint, or overwrite the value of an existing one.
+ * @param cache The cache.
+ * @param key The outpoint.
+ * @param value The value.
+ * @param absent_from_store Whether the backing store was asked and does not have the outpoint.
+ */
+void put_utxo_cache_entry(utxo_cache *cache, const utxo_key *key, long int value, bool absent_from_store) {
+    long int slot;
+    if (get_utxo_table_entry(cache->index, key, &slot)) {
+        // Spent or not, the backing store has the outpoint unless it was fresh.
+        utxo_cache_entry *entry = &cache->entries[slot];
+        if (!(entry->flags & UTXO_CACHE_DIRTY)) cache->dirty++;
+        entry->flags = (entry->flags & ~UTXO_CACHE_SPENT) | UTXO_CACHE_DIRTY | UTXO_CACHE_REFERENCED;
+        entry->value = value;
+        return;
+    }
+
+    // Only an outpoint the backing store is known not to have may be
+    // forgotten once spent; any other one may be there already.
+    unsigned char flags = UTXO_CACHE_USED | UTXO_CACHE_DIRTY | UTXO_CACHE_REFERENCED;
+    if (absent_from_store) flags |= UTXO_CACHE_FRESH;
+    add_utxo_cache_entry(cache, key, value, flags);
+}
+
+/**
+ * Spend a cached outpoint. An outpoint the backing store
+ * has never seen is simply forgotten; any other one is
+ * kept, marked spent, until the cache is written back.
+ * @param cache The cache.
+ * @param key The outpoint.
+ * @param value Where the value of the spent outpoint is written into; may be NULL.
+ * @return True if it was cached and unspent, false otherwise.
+ */
+bool spend_utxo_cache_entry(utxo_cache *cache, const utxo_key *key, long int *value) {
+    long int slot;
+    if (!get_utxo_table_entry(cache->index, key, &slot)) return false;
+
+    utxo_cache_entry *entry = &cache->entries[slot];
+    if (entry->flags & UTXO_CACHE_SPENT) return false;
+    if (value != NULL) *value = entry->value;
+
+    if (entry->flags & UTXO_CACHE_FRESH) {
+        release_utxo_cache_entry(cache, slot);
+    } else {
+        if (!(entry->flags & UTXO_CACHE_DIRTY)) cache->dirty++;
+        entry->flags = UTXO_CACHE_USED | UTXO_CACHE_DIRTY | UTXO_CACHE_SPENT;
+    }
+    return true;
+}
+
+/**
+ * Call a function on every dirty entry, i.e., every
+ * change that has to be written back.
+ * @param cache The cache.
+ * @param callback The function; spent outpoints are to be deleted, others inserted or updated.
+ * @param user_data Passed along to the function.
+ */
+void foreach_dirty_utxo_cache_entry(utxo_cache *cache, utxo_cache_callback callback, void *user_data) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        utxo_cache_entry *entry = &cache->entries[i];
+        if (entry->flags & UTXO_CACHE_DIRTY) callback(&entry->key, entry->value, entry->flags & UTXO_CACHE_SPENT, user_data);
+    }
+}
+
+/**
+ * Mark every entry as written back: spent entries are
+ * dropped and the rest become clean.
+ * @param cache The cache.
+ */
+void mark_utxo_cache_clean(utxo_cache *cache) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        utxo_cache_entry *entry = &cache->entries[i];
+        if (entry->flags & UTXO_CACHE_SPENT) {
+            release_utxo_cache_entry(cache, i);
+        } else {
+            entry->flags &= ~(UTXO_CACHE_DIRTY | UTXO_CACHE_FRESH);
+        }
+    }
+    cache->dirty = 0;
+}
+
+/**
+ * Evict clean entries until the cache is a quarter below
+ * its budget. The hand sweeps the entries like a clock;
+ * an entry used since the hand last passed is spared once.
+ * Dirty entries are never evicted.
+ * @param cache The cache.
+ */
+void evict_utxo_cache_entries(utxo_cache *cache) {
+    size_t target = cache->max_count / 4 * 3;
+    for (size_t visited = 0; cache->count > target && visited < 2 * cache->capacity; visited++) {
+        size_t slot = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+
+        utxo_cache_entry *entry = &cache->entries[slot];
+        if (!(entry->flags & UTXO_CACHE_USED) || (entry->flags & UTXO_CACHE_DIRTY)) continue;
+        if (entry->flags & UTXO_CACHE_REFERENCED) {
+            entry->flags &= ~UTXO_CACHE_REFERENCED;
+        } else {
+            release_utxo_cache_entry(cache, slot);
+        }
+    }
+}
+
+/**
+ * Check if a cache holds more entries than its memory budget allows.
+ * @param cache The cache.
+ * @return True if it should be written back and evicted.
+ */
+bool is_utxo_cache_over_budget(utxo_cache *cache) { return cache->count > cache->max_count; }
+
+/**
+ * Get the number of entries in a UTXO cache, spent ones included.
+ * @param cache The cache.
+ * @return The number of entries.
+ */
+size_t get_utxo_cache_size(utxo_cache *cache) { return cache->count; }
+
+/**
+ * Get the number of entries that have to be written back.
+ * @param cache The cache.
+ * @return The number of dirty entries.
+ */
+size_t get_utxo_cache_dirty_count(utxo_cache *cache) { return cache->dirty; }
@@ -0,0 +1,61 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_CACHE_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utxo_table.h"
+
+#define UTXO_CACHE_USED 0x01        // The entry holds an outpoint.
+#define UTXO_CACHE_DIRTY 0x02       // The entry differs from the backing store.
+#define UTXO_CACHE_FRESH 0x04       // The backing store does not have the outpoint.
+#define UTXO_CACHE_SPENT 0x08       // The outpoint is spent; the backing store still has it.
+#define UTXO_CACHE_REFERENCED 0x10  // Used since the eviction hand last passed by.
+
+/*
+ * A cached outpoint.
+ */
+typedef struct UtxoCacheEntry {
+    utxo_key key;
+    long int value;  // The value left, or the next free entry if unused.
+    unsigned char flags;
+} utxo_cache_entry;
+
+/*
+ * A write-back cache of UTXO entries in front of a slower
+ * backing store. Changes stay in memory, marked dirty,
+ * until they are written back in one batch; outpoints
+ * the store is known not to have, created and spent in
+ * between, never reach it.
+ * Clean entries are evicted with the CLOCK policy once
+ * the cache outgrows its memory budget.
+ */
+typedef struct UtxoCache {
+    utxo_table *index;          // Maps each outpoint to its entry.
+    utxo_cache_entry *entries;  // The entries.
+    size_t capacity;            // Number of entries allocated.
+    size_t count;               // Number of entries in use.
+    size_t dirty;               // Number of dirty entries.
+    size_t max_count;           // Number of entries the memory budget allows.
+    size_t hand;                // Where the eviction hand points to.
+    long int free_list;         // The first unused entry, or -1.
+} utxo_cache;
+
+typedef enum UtxoCacheLookup { UTXO_CACHE_MISS, UTXO_CACHE_HIT, UTXO_CACHE_HIT_SPENT } utxo_cache_lookup;
+
+typedef void (*utxo_cache_callback)(const utxo_key *key, long int value, bool spent, void *user_data);
+
+utxo_cache *create_utxo_cache(size_t);
+void destroy_utxo_cache(utxo_cache *);
+utxo_cache_lookup lookup_utxo_cache_entry(utxo_cache *, const utxo_key *, long int *);
+void load_utxo_cache_entry(utxo_cache *, const utxo_key *, long int);
+void put_utxo_cache_entry(utxo_cache *, const utxo_key *, long int, bool);
+bool spend_utxo_cache_entry(utxo_cache *, const utxo_key *, long int *);
+void foreach_dirty_utxo_cache_entry(utxo_cache *, utxo_cache_callback, void *);
+void mark_utxo_cache_clean(utxo_cache *);
+void evict_utxo_cache_entries(utxo_cache *);
+bool is_utxo_cache_over_budget(utxo_cache *);
+size_t get_utxo_cache_size(utxo_cache *);
+size_t get_utxo_cache_dirty_count(utxo_cache *);
+
+#endif
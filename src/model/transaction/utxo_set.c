@@ -0,0 +1,150 @@
+#include "utxo_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Find the shard of a key. The shard is picked from TXID
+ * bytes the tables do not hash on, so that the keys of
+ * one shard still spread over its whole table.
+ * @param set The UTXO set.
+ * @param key The key.
+ * @return The shard.
+ */
+static inline utxo_set_shard *get_utxo_set_shard(utxo_set *set, const utxo_key *key) {
+    unsigned int selector;
+    memcpy(&selector, key->txid + 8, sizeof(selector));
+    selector ^= key->index * 0x9E3779B9u;
+    return &set->shards[(selector ^ selector >> 16) & (UTXO_SET_SHARDS - 1)];
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Create an empty UTXO set.
+ * @return The set.
+ */
+utxo_set *create_utxo_set() {
+    utxo_set *set = (utxo_set *)aligned_alloc(_Alignof(utxo_set), sizeof(utxo_set));
+    for (int i = 0; i < UTXO_SET_SHARDS; i++) {
+        pthread_mutex_init(&set->shards[i].lock, NULL);
+        set->shards[i].table = create_utxo_table(0);
+    }
+    return set;
+}
+
+/**
+ * Destroy a UTXO set, free all of its memory space.
+ * No other thread may be using it.
+ * @param set The set.
+ */
+void destroy_utxo_set(utxo_set *set) {
+    if (set == NULL) return;
+    for (int i = 0; i < UTXO_SET_SHARDS; i++) {
+        destroy_utxo_table(set->shards[i].table);
+        pthread_mutex_destroy(&set->shards[i].lock);
+    }
+    free(set);
+}
+
+/**
+ * Insert an entry, or overwrite the value of an existing one.
+ * @param set The set.
+ * @param key The key.
+ * @param value The value.
+ */
+void put_utxo_set_entry(utxo_set *set, const utxo_key *key, long int value) {
+    utxo_set_shard *shard = get_utxo_set_shard(set, key);
+    pthread_mutex_lock(&shard->lock);
+    put_utxo_table_entry(shard->table, key, value);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/**
+ * Look up an entry.
+ * @param set The set.
+ * @param key The key.
+ * @param value Where the value is written into; may be NULL.
+ * @return True if the entry exists, false otherwise.
+ */
+bool get_utxo_set_entry(utxo_set *set, const utxo_key *key, long int *value) {
+    utxo_set_shard *shard = get_utxo_set_shard(set, key);
+    pthread_mutex_lock(&shard->lock);
+    bool found = get_utxo_table_entry(shard->table, key, value);
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+/**
+ * Remove an entry if it is present, atomically. Of several
+ * threads spending the same outpoint, exactly one succeeds.
+ * @param set The set.
+ * @param key The key.
+ * @param value Where the value of the removed entry is written into; may be NULL.
+ * @return True if this call removed the entry, false if it was absent.
+ */
+bool spend_utxo_set_entry(utxo_set *set, const utxo_key *key, long int *value) {
+    utxo_set_shard *shard = get_utxo_set_shard(set, key);
+    pthread_mutex_lock(&shard->lock);
+    bool found = get_utxo_table_entry(shard->table, key, value) && remove_utxo_table_entry(shard->table, key);
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+/**
+ * Remove every entry, then make room for a number of
+ * new ones spread evenly over the shards.
+ * @param set The set.
+ * @param expected_size Number of entries to make room for.
+ */
+void clear_utxo_set(utxo_set *set, size_t expected_size) {
+    // Leave some slack, as keys never spread perfectly evenly.
+    size_t shard_size = expected_size / UTXO_SET_SHARDS * 9 / 8;
+    for (int i = 0; i < UTXO_SET_SHARDS; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        clear_utxo_table(set->shards[i].table);
+        reserve_utxo_table(set->shards[i].table, shard_size);
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+}
+
+/**
+ * Get the number of entries in a UTXO set. Only a
+ * snapshot while other threads are modifying it.
+ * @param set The set.
+ * @return The number of entries.
+ */
+size_t get_utxo_set_size(utxo_set *set) {
+    size_t size = 0;
+    for (int i = 0; i < UTXO_SET_SHARDS; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        size += get_utxo_table_size(set->shards[i].table);
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+    return size;
+}
+
+/**
+ * Call a function on every entry, one shard at a time,
+ * with that shard locked. The function must not use the set.
+ * @param set The set.
+ * @param callback The function.
+ * @param user_data Passed along to the function.
+ */
+void foreach_utxo_set_entry(utxo_set *set, utxo_table_callback callback, void *user_data) {
+    for (int i = 0; i < UTXO_SET_SHARDS; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        foreach_utxo_table_entry(set->shards[i].table, callback, user_data);
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+}
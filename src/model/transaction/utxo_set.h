@@ -0,0 +1,41 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_SET_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_SET_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utxo_table.h"
+
+#define UTXO_SET_SHARDS 64  // A power of two.
+
+/*
+ * One shard of a UTXO set: a table and the lock guarding
+ * it, on a cache line of its own so that threads working
+ * on different shards do not contend.
+ */
+typedef struct UtxoSetShard {
+    pthread_mutex_t lock;
+    utxo_table *table;
+} __attribute__((aligned(64))) utxo_set_shard;
+
+/*
+ * A UTXO set safe to use from many threads at once. Keys
+ * are spread over independently locked shards, so
+ * operations on different outpoints rarely wait on each
+ * other and throughput grows with the number of cores.
+ */
+typedef struct UtxoSet {
+    utxo_set_shard shards[UTXO_SET_SHARDS];
+} utxo_set;
+
+utxo_set *create_utxo_set();
+void destroy_utxo_set(utxo_set *);
+void put_utxo_set_entry(utxo_set *, const utxo_key *, long int);
+bool get_utxo_set_entry(utxo_set *, const utxo_key *, long int *);
+bool spend_utxo_set_entry(utxo_set *, const utxo_key *, long int *);
+void clear_utxo_set(utxo_set *, size_t);
+size_t get_utxo_set_size(utxo_set *);
+void foreach_utxo_set_entry(utxo_set *, utxo_table_callback, void *);
+
+#endif
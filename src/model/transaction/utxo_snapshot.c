@@ -0,0 +1,286 @@
+#include "utxo_snapshot.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "model/transaction/transaction_persistence.h"
+#include "utils/log_utils.h"
+#include "utils/serialize.h"
+#include "utils/sha256.h"
+#include "utils/sys_utils.h"
+
+#define LOG_SCOPE "utxo_snapshot"
+#define UTXO_SNAPSHOT_MIN_RECORDS_PER_THREAD 16384  // Fewer are not worth a thread of their own.
+
+typedef struct UtxoSnapshotEntry {
+    utxo_key key;
+    long int value;
+} utxo_snapshot_entry;
+
+/*
+ * The entries of a UTXO being collected for a dump.
+ */
+typedef struct UtxoSnapshotEntries {
+    utxo_snapshot_entry *entries;
+    size_t count;
+    size_t capacity;
+} utxo_snapshot_entries;
+
+/*
+ * A loader thread and the range of records it saves.
+ */
+typedef struct UtxoSnapshotLoader {
+    pthread_t thread;
+    const unsigned char *records;
+    size_t begin;
+    size_t end;
+} utxo_snapshot_loader;
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Order two outpoints by TXID, then by output index.
+ * @param a An outpoint.
+ * @param b Another outpoint.
+ * @return Negative, zero, or positive as a sorts before, with, or after b.
+ */
+static int compare_utxo_keys(const utxo_key *a, const utxo_key *b) {
+    int result = memcmp(a->txid, b->txid, SHA256_DIGEST_LENGTH);
+    if (result != 0) return result;
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static int compare_utxo_snapshot_entries(const void *a, const void *b) {
+    return compare_utxo_keys(&((const utxo_snapshot_entry *)a)->key, &((const utxo_snapshot_entry *)b)->key);
+}
+
+static void collect_utxo_snapshot_entry(const utxo_key *key, long int value, void *user_data) {
+    utxo_snapshot_entries *collected = (utxo_snapshot_entries *)user_data;
+    if (collected->count == collected->capacity) {
+        collected->capacity = collected->capacity > 0 ? collected->capacity * 2 : 1024;
+        collected->entries = (utxo_snapshot_entry *)realloc(collected->entries, collected->capacity * sizeof(utxo_snapshot_entry));
+    }
+    collected->entries[collected->count].key = *key;
+    collected->entries[collected->count].value = value;
+    collected->count++;
+}
+
+static void decode_utxo_snapshot_record(const unsigned char *record, utxo_key *key, long int *value) {
+    memcpy(key->txid, record, SHA256_DIGEST_LENGTH);
+    key->index = load_le32(record + SHA256_DIGEST_LENGTH);
+    *value = (long int)load_le64(record + SHA256_DIGEST_LENGTH + 4);
+}
+
+/**
+ * Check the checksum of the snapshot records and that
+ * they are strictly ascending, in a single pass.
+ * @param records The records.
+ * @param count The number of records.
+ * @param checksum The checksum from the header.
+ * @return True if both hold and false otherwise.
+ */
+static bool check_utxo_snapshot_records(const unsigned char *records, size_t count, const unsigned char *checksum) {
+    sha256_context ctx;
+    sha256_digest digest;
+    utxo_key previous, key;
+    long int value;
+    sha256_init(&ctx);
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *record = records + i * UTXO_SNAPSHOT_RECORD_LENGTH;
+        decode_utxo_snapshot_record(record, &key, &value);
+        // Strictly ascending also means no outpoint appears twice.
+        if (i > 0 && compare_utxo_keys(&previous, &key) >= 0) return false;
+        sha256_update(&ctx, record, UTXO_SNAPSHOT_RECORD_LENGTH);
+        previous = key;
+    }
+    sha256_final(&ctx, &digest);
+    return memcmp(digest.data, checksum, SHA256_DIGEST_LENGTH) == 0;
+}
+
+/**
+ * Save a range of snapshot records into the UTXO.
+ * @param arg The loader.
+ * @return NULL.
+ */
+static void *load_utxo_snapshot_range(void *arg) {
+    utxo_snapshot_loader *loader = (utxo_snapshot_loader *)arg;
+    utxo_key key;
+    long int value;
+    for (size_t i = loader->begin; i < loader->end; i++) {
+        decode_utxo_snapshot_record(loader->records + i * UTXO_SNAPSHOT_RECORD_LENGTH, &key, &value);
+        save_utxo_entry(&key, value);
+    }
+    return NULL;
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Dump the UTXO into a snapshot file. The file is written
+ * aside and renamed into place, so an existing snapshot
+ * is only ever replaced by a complete one.
+ * @param path The path of the file.
+ * @param tip_hash The header hash of the block the UTXO is up to date with.
+ * @return True for success and false otherwise.
+ */
+bool dump_utxo_snapshot(const char *path, const sha256_digest *tip_hash) {
+    utxo_snapshot_entries collected = {.entries = NULL, .count = 0, .capacity = 0};
+    foreach_utxo_entry(collect_utxo_snapshot_entry, &collected);
+    qsort(collected.entries, collected.count, sizeof(utxo_snapshot_entry), compare_utxo_snapshot_entries);
+
+    char temp_path[strlen(path) + 5];
+    sprintf(temp_path, "%s.tmp", path);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot open %s for writing.", temp_path);
+        free(collected.entries);
+        return false;
+    }
+
+    // The checksum goes into the header, which is written again once the records are.
+    unsigned char header[UTXO_SNAPSHOT_HEADER_LENGTH];
+    memset(header, 0, UTXO_SNAPSHOT_HEADER_LENGTH);
+    bool ok = fwrite(header, UTXO_SNAPSHOT_HEADER_LENGTH, 1, file) == 1;
+
+    sha256_context ctx;
+    sha256_init(&ctx);
+    unsigned char record[UTXO_SNAPSHOT_RECORD_LENGTH];
+    for (size_t i = 0; ok && i < collected.count; i++) {
+        memcpy(record, collected.entries[i].key.txid, SHA256_DIGEST_LENGTH);
+        write_le32(record + SHA256_DIGEST_LENGTH, collected.entries[i].key.index);
+        write_le64(record + SHA256_DIGEST_LENGTH + 4, (unsigned long long)collected.entries[i].value);
+        sha256_update(&ctx, record, UTXO_SNAPSHOT_RECORD_LENGTH);
+        ok = fwrite(record, UTXO_SNAPSHOT_RECORD_LENGTH, 1, file) == 1;
+    }
+    sha256_digest checksum;
+    sha256_final(&ctx, &checksum);
+
+    memcpy(header, UTXO_SNAPSHOT_MAGIC, 8);
+    write_le32(header + 8, UTXO_SNAPSHOT_VERSION);
+    write_le32(header + 12, UTXO_SNAPSHOT_RECORD_LENGTH);
+    write_le64(header + 16, collected.count);
+    memcpy(header + 24, checksum.data, SHA256_DIGEST_LENGTH);
+    memcpy(header + 56, tip_hash->data, SHA256_DIGEST_LENGTH);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, UTXO_SNAPSHOT_HEADER_LENGTH, 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temp_path, path) == 0;
+
+    if (ok) {
+        general_log(LOG_SCOPE, LOG_INFO, "Dumped %zu UTXO entries into %s.", collected.count, path);
+    } else {
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to write the UTXO snapshot %s.", path);
+        remove(temp_path);
+    }
+    free(collected.entries);
+    return ok;
+}
+
+/**
+ * Replace the UTXO with the content of a snapshot file.
+ * The file is mapped into memory and its records saved
+ * by several threads at once. A file that fails its checksum,
+ * has records out of order, is of another format or was
+ * dumped at another tip leaves the UTXO untouched.
+ * @param path The path of the file.
+ * @param tip_hash The header hash of the tip block of the chain stored.
+ * @param num_of_threads Number of threads to load with; 0 uses one per online CPU.
+ * @return True for success and false otherwise.
+ */
+bool load_utxo_snapshot(const char *path, const sha256_digest *tip_hash, unsigned int num_of_threads) {
+    unsigned long start = get_timestamp();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot open the UTXO snapshot %s.", path);
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < UTXO_SNAPSHOT_HEADER_LENGTH) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The UTXO snapshot %s is truncated.", path);
+        close(fd);
+        return false;
+    }
+    size_t file_size = file_stat.st_size;
+    const unsigned char *data = (const unsigned char *)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot map the UTXO snapshot %s.", path);
+        return false;
+    }
+
+    // Check the header, the checksum and the order of the records before touching the UTXO.
+    size_t count = load_le64(data + 16);
+    const unsigned char *records = data + UTXO_SNAPSHOT_HEADER_LENGTH;
+    if (memcmp(data, UTXO_SNAPSHOT_MAGIC, 8) != 0 || load_le32(data + 8) != UTXO_SNAPSHOT_VERSION ||
+        load_le32(data + 12) != UTXO_SNAPSHOT_RECORD_LENGTH || count != (file_size - UTXO_SNAPSHOT_HEADER_LENGTH) / UTXO_SNAPSHOT_RECORD_LENGTH ||
+        (file_size - UTXO_SNAPSHOT_HEADER_LENGTH) % UTXO_SNAPSHOT_RECORD_LENGTH != 0) {
+        general_log(LOG_SCOPE, LOG_ERROR, "%s is not a UTXO snapshot of this version.", path);
+        munmap((void *)data, file_size);
+        return false;
+    }
+    if (memcmp(data + 56, tip_hash->data, SHA256_DIGEST_LENGTH) != 0) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The UTXO snapshot %s was dumped at another tip than the chain stored.", path);
+        munmap((void *)data, file_size);
+        return false;
+    }
+    madvise((void *)data, file_size, MADV_SEQUENTIAL);
+    if (!check_utxo_snapshot_records(records, count, data + 24)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "The UTXO snapshot %s fails its checksum or is out of order.", path);
+        munmap((void *)data, file_size);
+        return false;
+    }
+
+    if (num_of_threads == 0) {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_of_threads = online_cpus > 0 ? (unsigned int)online_cpus : 1;
+    }
+    if (num_of_threads > count / UTXO_SNAPSHOT_MIN_RECORDS_PER_THREAD) num_of_threads = count / UTXO_SNAPSHOT_MIN_RECORDS_PER_THREAD;
+    if (num_of_threads == 0) num_of_threads = 1;
+
+    if (!clear_utxo_entries(count)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Cannot clear the UTXO to load %s into.", path);
+        munmap((void *)data, file_size);
+        return false;
+    }
+
+    utxo_snapshot_loader *loaders = (utxo_snapshot_loader *)malloc(num_of_threads * sizeof(utxo_snapshot_loader));
+    bool *started = (bool *)malloc(num_of_threads * sizeof(bool));
+    for (unsigned int i = 0; i < num_of_threads; i++) {
+        loaders[i].records = records;
+        loaders[i].begin = count * i / num_of_threads;
+        loaders[i].end = count * (i + 1) / num_of_threads;
+        started[i] = pthread_create(&loaders[i].thread, NULL, load_utxo_snapshot_range, &loaders[i]) == 0;
+    }
+    for (unsigned int i = 0; i < num_of_threads; i++) {
+        // A range whose thread failed to start is loaded here instead.
+        if (started[i])
+            pthread_join(loaders[i].thread, NULL);
+        else
+            load_utxo_snapshot_range(&loaders[i]);
+    }
+    free(started);
+    free(loaders);
+    munmap((void *)data, file_size);
+
+    general_log(LOG_SCOPE,
+                LOG_INFO,
+                "Loaded %zu UTXO entries from %s with %u threads in %lu ms.",
+                count,
+                path,
+                num_of_threads,
+                (get_timestamp() - start) / 1000000);
+    return true;
+}
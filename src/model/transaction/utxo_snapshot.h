@@ -0,0 +1,30 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_SNAPSHOT_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include "utils/sha256.h"
+
+/*
+ * A UTXO snapshot file is a header followed by one fixed
+ * size record per entry, sorted by outpoint, all little endian:
+ *
+ *   header  magic "UTXOSNAP" (8) | version (4) | record length (4) | entry count (8) | SHA256 of the records (32) |
+ *           header hash of the tip block (32)
+ *   record  TXID (32) | output index (4) | value (8)
+ *
+ * Fixed size records let the loader split the file into
+ * ranges for its threads without parsing it first. A record
+ * only holds the value left; the output itself is still read
+ * from the transaction store, so a snapshot is only loaded
+ * on top of the chain it was dumped at.
+ */
+#define UTXO_SNAPSHOT_MAGIC "UTXOSNAP"
+#define UTXO_SNAPSHOT_VERSION 2
+#define UTXO_SNAPSHOT_HEADER_LENGTH 88
+#define UTXO_SNAPSHOT_RECORD_LENGTH 44
+
+bool dump_utxo_snapshot(const char *, const sha256_digest *);
+bool load_utxo_snapshot(const char *, const sha256_digest *, unsigned int);
+
+#endif
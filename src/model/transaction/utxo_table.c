@@ -0,0 +1,296 @@
+#include "utxo_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define UTXO_TABLE_MIN_CAPACITY UTXO_TABLE_GROUP_SIZE
+#define UTXO_TAG_EMPTY 0x80
+#define UTXO_TAG_DELETED 0xFE  // Every other tag is 7 bits of the hash, i.e., below 0x80.
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Hash an outpoint. The TXID is already a SHA256 hash,
+ * so a few of its bytes mixed with the index suffice.
+ * @param key The key.
+ * @return The hash.
+ */
+static inline unsigned long long hash_utxo_key(const utxo_key *key) {
+    unsigned long long hash;
+    memcpy(&hash, key->txid, sizeof(hash));
+    hash ^= (unsigned long long)key->index * 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * Check if two keys are equal.
+ * @param a A key.
+ * @param b Another key.
+ * @return True if equal, false otherwise.
+ */
+static inline bool are_utxo_keys_equal(const utxo_key *a, const utxo_key *b) {
+    return a->index == b->index && memcmp(a->txid, b->txid, SHA256_DIGEST_LENGTH) == 0;
+}
+
+/**
+ * Compare every tag of a group against a value.
+ * @param tags The first tag of the group.
+ * @param tag The value.
+ * @return Bit i is set if the i-th tag equals the value.
+ */
+static inline unsigned int match_utxo_tags(const unsigned char *tags, unsigned char tag) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)tags);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < UTXO_TABLE_GROUP_SIZE; i++) mask |= (unsigned int)(tags[i] == tag) << i;
+    return mask;
+#endif
+}
+
+/**
+ * Find a key.
+ * @param table The table.
+ * @param key The key.
+ * @param hash The hash of the key.
+ * @return The slot of the key, or capacity if absent.
+ */
+static size_t find_utxo_slot(utxo_table *table, const utxo_key *key, unsigned long long hash) {
+    unsigned char tag = hash & 0x7F;
+    size_t group_mask = table->capacity / UTXO_TABLE_GROUP_SIZE - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    // Triangular probing over whole groups visits every group once.
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        const unsigned char *tags = table->tags + group * UTXO_TABLE_GROUP_SIZE;
+        for (unsigned int matches = match_utxo_tags(tags, tag); matches != 0; matches &= matches - 1) {
+            size_t slot = group * UTXO_TABLE_GROUP_SIZE + __builtin_ctz(matches);
+            if (are_utxo_keys_equal(&table->keys[slot], key)) return slot;
+        }
+        // A key is never placed past a group with an empty slot.
+        if (match_utxo_tags(tags, UTXO_TAG_EMPTY) != 0) break;
+        group = (group + step) & group_mask;
+    }
+    return table->capacity;
+}
+
+/**
+ * Find the first free (empty or deleted) slot for a hash.
+ * The table must have one.
+ * @param table The table.
+ * @param hash The hash of the key.
+ * @return The slot.
+ */
+static size_t find_free_utxo_slot(utxo_table *table, unsigned long long hash) {
+    size_t group_mask = table->capacity / UTXO_TABLE_GROUP_SIZE - 1;
+    size_t group = (hash >> 7) & group_mask;
+    for (size_t step = 1;; step++) {
+        const unsigned char *tags = table->tags + group * UTXO_TABLE_GROUP_SIZE;
+        // Tags of live entries are below 0x80; empty and deleted ones are not.
+        for (int i = 0; i < UTXO_TABLE_GROUP_SIZE; i++)
+            if (tags[i] & 0x80) return group * UTXO_TABLE_GROUP_SIZE + i;
+        group = (group + step) & group_mask;
+    }
+}
+
+/**
+ * Allocate the slots of a table.
+ * @param table The table.
+ * @param capacity Number of slots.
+ */
+static void allocate_utxo_slots(utxo_table *table, size_t capacity) {
+    table->tags = (unsigned char *)malloc(capacity);
+    memset(table->tags, UTXO_TAG_EMPTY, capacity);
+    table->keys = (utxo_key *)malloc(capacity * sizeof(utxo_key));
+    table->values = (long int *)malloc(capacity * sizeof(long int));
+    table->capacity = capacity;
+    table->size = 0;
+    table->deleted = 0;
+}
+
+/**
+ * Move every entry into a new set of slots, dropping
+ * the tombstones along the way.
+ * @param table The table.
+ * @param capacity The new number of slots.
+ */
+static void rehash_utxo_table(utxo_table *table, size_t capacity) {
+    unsigned char *tags = table->tags;
+    utxo_key *keys = table->keys;
+    long int *values = table->values;
+    size_t old_capacity = table->capacity;
+
+    allocate_utxo_slots(table, capacity);
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (tags[i] & 0x80) continue;
+        size_t slot = find_free_utxo_slot(table, hash_utxo_key(&keys[i]));
+        table->tags[slot] = tags[i];
+        table->keys[slot] = keys[i];
+        table->values[slot] = values[i];
+        table->size++;
+    }
+
+    free(values);
+    free(keys);
+    free(tags);
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Create an empty UTXO table.
+ * @param expected_size Number of entries to make room for up front.
+ * @return The table.
+ */
+utxo_table *create_utxo_table(size_t expected_size) {
+    size_t capacity = UTXO_TABLE_MIN_CAPACITY;
+    while (capacity * 7 / 8 < expected_size) capacity *= 2;
+    utxo_table *table = (utxo_table *)malloc(sizeof(utxo_table));
+    allocate_utxo_slots(table, capacity);
+    return table;
+}
+
+/**
+ * Destroy a UTXO table, free all of its memory space.
+ * @param table The table.
+ */
+void destroy_utxo_table(utxo_table *table) {
+    if (table == NULL) return;
+    free(table->values);
+    free(table->keys);
+    free(table->tags);
+    free(table);
+}
+
+/**
+ * Insert an entry, or overwrite the value of an existing one.
+ * @param table The table.
+ * @param key The key.
+ * @param value The value.
+ */
+void put_utxo_table_entry(utxo_table *table, const utxo_key *key, long int value) {
+    unsigned long long hash = hash_utxo_key(key);
+    size_t slot = find_utxo_slot(table, key, hash);
+    if (slot != table->capacity) {
+        table->values[slot] = value;
+        return;
+    }
+
+    // Keep at least one slot in eight empty so that lookups stay short.
+    if ((table->size + table->deleted + 1) > table->capacity * 7 / 8) {
+        size_t capacity = table->capacity;
+        if (table->size + 1 > capacity * 7 / 16) capacity *= 2;
+        rehash_utxo_table(table, capacity);
+    }
+
+    slot = find_free_utxo_slot(table, hash);
+    if (table->tags[slot] == UTXO_TAG_DELETED) table->deleted--;
+    table->tags[slot] = hash & 0x7F;
+    table->keys[slot] = *key;
+    table->values[slot] = value;
+    table->size++;
+}
+
+/**
+ * Look up an entry.
+ * @param table The table.
+ * @param key The key.
+ * @param value Where the value is written into; may be NULL.
+ * @return True if the entry exists, false otherwise.
+ */
+bool get_utxo_table_entry(utxo_table *table, const utxo_key *key, long int *value) {
+    size_t slot = find_utxo_slot(table, key, hash_utxo_key(key));
+    if (slot == table->capacity) return false;
+    if (value != NULL) *value = table->values[slot];
+    return true;
+}
+
+/**
+ * Remove an entry.
+ * @param table The table.
+ * @param key The key.
+ * @return True if the entry existed, false otherwise.
+ */
+bool remove_utxo_table_entry(utxo_table *table, const utxo_key *key) {
+    size_t slot = find_utxo_slot(table, key, hash_utxo_key(key));
+    if (slot == table->capacity) return false;
+
+    // A group that still has an empty slot ends every probe
+    // reaching it, so no tombstone is needed there.
+    const unsigned char *group_tags = table->tags + slot / UTXO_TABLE_GROUP_SIZE * UTXO_TABLE_GROUP_SIZE;
+    if (match_utxo_tags(group_tags, UTXO_TAG_EMPTY) != 0) {
+        table->tags[slot] = UTXO_TAG_EMPTY;
+    } else {
+        table->tags[slot] = UTXO_TAG_DELETED;
+        table->deleted++;
+    }
+    table->size--;
+    return true;
+}
+
+/**
+ * Remove every entry, keeping the slots.
+ * @param table The table.
+ */
+void clear_utxo_table(utxo_table *table) {
+    memset(table->tags, UTXO_TAG_EMPTY, table->capacity);
+    table->size = 0;
+    table->deleted = 0;
+}
+
+/**
+ * Make room for a number of entries up front, so that
+ * inserting them does not rehash the table again and again.
+ * @param table The table.
+ * @param expected_size Number of entries to make room for.
+ */
+void reserve_utxo_table(utxo_table *table, size_t expected_size) {
+    size_t capacity = table->capacity;
+    while (capacity * 7 / 8 < expected_size) capacity *= 2;
+    if (capacity != table->capacity) rehash_utxo_table(table, capacity);
+}
+
+/**
+ * Get the number of entries in a UTXO table.
+ * @param table The table.
+ * @return The number of entries.
+ */
+size_t get_utxo_table_size(utxo_table *table) { return table->size; }
+
+/**
+ * Get the memory a UTXO table occupies.
+ * @param table The table.
+ * @return Bytes allocated for the table and its slots.
+ */
+size_t get_utxo_table_memory_usage(utxo_table *table) {
+    return sizeof(utxo_table) + table->capacity * (sizeof(unsigned char) + sizeof(utxo_key) + sizeof(long int));
+}
+
+/**
+ * Call a function on every entry, in no particular order.
+ * The table must not be modified meanwhile.
+ * @param table The table.
+ * @param callback The function.
+ * @param user_data Passed along to the function.
+ */
+void foreach_utxo_table_entry(utxo_table *table, utxo_table_callback callback, void *user_data) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (!(table->tags[i] & 0x80)) callback(&table->keys[i], table->values[i], user_data);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_TABLE_H
+#define MINIMALIST_BLOCKCHAIN_SYSTEM_SRC_MODEL_TRANSACTION_UTXO_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils/sha256.h"
+
+#define UTXO_TABLE_GROUP_SIZE 16  // Slots whose tags are compared at once.
+
+/*
+ * The key of a UTXO entry: the binary outpoint itself,
+ * so no hashing is needed to look an entry up.
+ */
+typedef struct UtxoKey {
+    unsigned char txid[SHA256_DIGEST_LENGTH];  // The TXID of the transaction holding the output.
+    unsigned int index;                        // The output index within that transaction.
+} utxo_key;
+
+/*
+ * An open-addressing hash table from outpoints to values.
+ * Every slot has a one-byte tag (empty, deleted, or 7 bits
+ * of the hash); a lookup compares a whole group of tags at
+ * once and only touches the keys whose tags match. Keys
+ * and values are stored inline, so entries cost no
+ * allocation of their own.
+ */
+typedef struct UtxoTable {
+    unsigned char *tags;  // One per slot.
+    utxo_key *keys;       // One per slot.
+    long int *values;     // One per slot.
+    size_t capacity;      // Number of slots, a power of two and a multiple of UTXO_TABLE_GROUP_SIZE.
+    size_t size;          // Live entries.
+    size_t deleted;       // Slots holding a tombstone.
+} utxo_table;
+
+typedef void (*utxo_table_callback)(const utxo_key *key, long int value, void *user_data);
+
+utxo_table *create_utxo_table(size_t);
+void destroy_utxo_table(utxo_table *);
+void put_utxo_table_entry(utxo_table *, const utxo_key *, long int);
+bool get_utxo_table_entry(utxo_table *, const utxo_key *, long int *);
+bool remove_utxo_table_entry(utxo_table *, const utxo_key *);
+void clear_utxo_table(utxo_table *);
+void reserve_utxo_table(utxo_table *, size_t);
+size_t get_utxo_table_size(utxo_table *);
+size_t get_utxo_table_memory_usage(utxo_table *);
+void foreach_utxo_table_entry(utxo_table *, utxo_table_callback, void *);
+
+#endif
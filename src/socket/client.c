@@ -4,6 +4,10 @@
 #include <unistd.h>
 
 #include "model/block//block.h"
+#include "model/block/block_assembler.h"
+#include "model/block/block_miner.h"
+#include "model/block/block_persistence.h"
+#include "model/transaction/mempool.h"
 #include "model/transaction/transaction.h"
 #include "model/transaction/transaction_persistence.h"
 #include "utils/constants.h"
@@ -15,14 +19,16 @@
 
 #define LOG_SCOPE "miner"
 
-transaction *create_a_new_single_in_single_out_transaction(char *previous_transaction_id,
+transaction *create_a_new_single_in_single_out_transaction(sha256_digest *previous_transaction_id,
                                                            char *previous_output_private_key,
                                                            int previous_tx_output_idx,
                                                            int previous_value,
-                                                           char **res_txid,
+                                                           sha256_digest *res_txid,
                                                            char **res_private_key);
 
-block *create_a_new_block(char *previous_block_header_hash, transaction *transaction, char **result_header_hash);
+block *create_a_new_block(mempool *pool, sha256_digest *previous_block_header_hash, sha256_digest *result_header_hash);
+char *create_block_message(const char *command, block *b, int *size);
+char *create_transaction_message(const char *command, transaction *tx, int *size);
 
 int main(int argc, char const *argv[]) {
     // listener's address and port configuration
@@ -42,13 +48,8 @@ int main(int argc, char const *argv[]) {
     }
 
     // send socket data configuration
-    char sendCommand[32];  // the command to tell listener to accept a block or transaction
-    memset(sendCommand, '\0', 32);
-    const char *send_model;
     int send_size;
-    char *send_data;
-    socket_block *socket_blk = NULL;
-    socket_transaction *socket_tx = NULL;
+    char *send_data;  // the command to tell listener to accept a block or transaction, and the model
 
     // initialize system
     initialize_mysql_system(MYSQL_DB_MINER);
@@ -65,15 +66,12 @@ int main(int argc, char const *argv[]) {
         printf("Block txns count: %d\n", genesis_block->txn_count);
         printf("Block header version: %d\n", genesis_block->header->version);
         printf("Block header hash: \n");
-        print_hex(genesis_block->header->prev_block_header_hash, 64);
+        print_hex(genesis_block->header->prev_block_header_hash.data, SHA256_DIGEST_LENGTH);
         printf("Block txns[0] in[0] signature script: \n");
         print_hex(genesis_block->txns[0]->tx_ins[0].signature_script, 64);
 
         // send genesis block to listener
-        memcpy(sendCommand, "genesis block", strlen("genesis block"));
-        socket_blk = cast_to_socket_block(genesis_block);
-        send_model = (const char *)socket_blk;
-        send_size = get_socket_block_length(genesis_block) + COMMAND_LENGTH;
+        send_data = create_block_message("genesis block", genesis_block, &send_size);
     } else {
         printf("%d\n", previous_transaction->tx_out_count);
         printf("%d\n", previous_transaction->tx_in_count);
@@ -81,64 +79,63 @@ int main(int argc, char const *argv[]) {
         print_hex(previous_transaction->tx_ins[0].signature_script, 64);
 
         // send genesis transaction to listener
-        memcpy(sendCommand, "genesis transaction", strlen("genesis transaction"));
-        socket_tx = cast_to_socket_transaction(previous_transaction);
-        send_model = (const char *)socket_tx;
-        send_size = get_socket_transaction_length(socket_tx) + COMMAND_LENGTH;
+        send_data = create_transaction_message("genesis transaction", previous_transaction, &send_size);
     }
-    send_data = combine_data_with_command(sendCommand, COMMAND_LENGTH, send_model, send_size);
     send_model_by_socket(server_address_str, server_port, send_data, send_size);
     usleep(1000);  // sleep for 1ms
 
     // send multiple transaction/block
     int n = 10;
-    char *previous_transaction_id = get_transaction_txid(previous_transaction);
+    sha256_digest previous_transaction_id = get_transaction_txid(previous_transaction);
     char *previous_output_private_key = get_genesis_transaction_private_key();
-    char *res_txid;
+    sha256_digest res_txid;
     char *res_private_key;
-    char *previous_block_header_hash = get_genesis_block_hash();
-    char *result_block_hash;
+    sha256_digest previous_block_header_hash = *get_genesis_block_hash();
+    sha256_digest result_block_hash;
+    mempool *pool = create_mempool(MEMPOOL_MEMORY_LIMIT);
     for (int i = 0; i < n; i++) {
         // create the transaction
         transaction *transaction = create_a_new_single_in_single_out_transaction(
-            previous_transaction_id, previous_output_private_key, 0, TOTAL_NUMBER_OF_COINS, &res_txid, &res_private_key);
-        memcpy(previous_transaction_id, res_txid, 64);
+            &previous_transaction_id, previous_output_private_key, 0, TOTAL_NUMBER_OF_COINS, &res_txid, &res_private_key);
+        previous_transaction_id = res_txid;
         memcpy(previous_output_private_key, res_private_key, 64);
 
         if (TEST_CREATE_BLOCK) {
-            // create the block
-            block *block1 = create_a_new_block(previous_block_header_hash, transaction, &result_block_hash);
-            memcpy(previous_block_header_hash, result_block_hash, 64);
+            // stage the transaction, then assemble and mine a block from the mempool
+            mempool_result result = add_mempool_transaction(pool, transaction);
+            if (result != MEMPOOL_ACCEPTED) general_log(LOG_SCOPE, LOG_ERROR, "Transaction %s.", get_mempool_result_name(result));
+            block *block1 = create_a_new_block(pool, &previous_block_header_hash, &result_block_hash);
+            if (block1 == NULL) {
+                general_log(LOG_SCOPE, LOG_ERROR, "No transaction to put into a block.");
+                continue;
+            }
+            previous_block_header_hash = result_block_hash;
 
             //    print block info
             printf("Block txns count: %d\n", block1->txn_count);
             printf("Block header version: %d\n", block1->header->version);
             printf("Block header hash: \n");
-            print_hex(block1->header->prev_block_header_hash, 64);
+            print_hex(block1->header->prev_block_header_hash.data, SHA256_DIGEST_LENGTH);
             printf("Block txns[0] in[0] signature script: \n");
             print_hex(block1->txns[0]->tx_ins[0].signature_script, 64);
 
-            memcpy(sendCommand, "create block", strlen("create block"));
-            socket_blk = cast_to_socket_block(block1);
-            send_model = (const char *)socket_blk;
-            send_size = get_socket_block_length(block1) + COMMAND_LENGTH;
+            send_data = create_block_message("create block", block1, &send_size);
         } else {
+            if (!finalize_transaction(transaction)) {
+                general_log(LOG_SCOPE, LOG_ERROR, "Failed to finalize a transaction.");
+            }
+
             // print transaction info
             printf("%d\n", transaction->tx_out_count);
             printf("%d\n", transaction->tx_in_count);
             printf("%u\n", transaction->lock_time);
             print_hex(transaction->tx_ins[0].signature_script, 64);
-            printf("previous txid: %s\n", transaction->tx_ins[0].previous_outpoint.hash);
+            printf("previous txid: ");
+            print_hex(transaction->tx_ins[0].previous_outpoint.hash.data, SHA256_DIGEST_LENGTH);
 
-            memcpy(sendCommand, "create transaction", strlen("create transaction"));
-            socket_tx = cast_to_socket_transaction(transaction);
-            printf("socket tx previous hash: %s \n", ((socket_transaction_input *)&socket_tx->transaction_input[0])->previous_outpoint.hash);
-            send_model = (const char *)socket_tx;
-            send_size = get_socket_transaction_length(socket_tx) + COMMAND_LENGTH;
+            send_data = create_transaction_message("create transaction", transaction, &send_size);
         }
 
-        // combine with command
-        send_data = combine_data_with_command(sendCommand, COMMAND_LENGTH, send_model, send_size);
         // create and send the socket
         send_model_by_socket(server_address_str, server_port, send_data, send_size);
         usleep(1000);
@@ -147,14 +144,14 @@ int main(int argc, char const *argv[]) {
     return 0;
 }
 
-transaction *create_a_new_single_in_single_out_transaction(char *previous_transaction_id,
+transaction *create_a_new_single_in_single_out_transaction(sha256_digest *previous_transaction_id,
                                                            char *previous_output_private_key,
                                                            int previous_tx_output_idx,
                                                            int previous_value,
-                                                           char **res_txid,
+                                                           sha256_digest *res_txid,
                                                            char **res_private_key) {
     transaction_create_shortcut_input input = {
-        .previous_output_idx = previous_tx_output_idx, .previous_txid = previous_transaction_id, .private_key = previous_output_private_key};
+        .previous_output_idx = previous_tx_output_idx, .previous_txid = *previous_transaction_id, .private_key = previous_output_private_key};
 
     unsigned char *new_private_key = get_a_new_private_key();
     secp256k1_pubkey *new_public_key = get_a_new_public_key((char *)new_private_key);
@@ -166,34 +163,78 @@ transaction *create_a_new_single_in_single_out_transaction(char *previous_transa
         general_log(LOG_SCOPE, LOG_ERROR, "Failed to create a transaction.");
     }
 
-    if (!finalize_transaction(t)) {
-        general_log(LOG_SCOPE, LOG_ERROR, "Failed to finalize a transaction.");
-    }
-
     *res_txid = get_transaction_txid(t);
     *res_private_key = new_private_key;
 
     return t;
 }
 
-block *create_a_new_block(char *previous_block_header_hash, transaction *transaction, char **result_header_hash) {
-    block_header_shortcut block_header = {
-        .prev_block_header_hash = "", .version = 0, .nonce = 0, .nBits = 0, .merkle_root_hash = "", .time = get_current_unix_time()};
-    memcpy(block_header.prev_block_header_hash, previous_block_header_hash, 65);
-    struct transaction **txns = malloc(sizeof(txns));
-    txns[0] = transaction;
-    transactions_shortcut txns_shortcut = {.txns = txns, .txn_count = 1};
-    block_create_shortcut block_data = {.header = &block_header, .transaction_list = &txns_shortcut};
-
-    block *block1 = (block *)malloc(sizeof(block));
-    if (!create_new_block_shortcut(&block_data, block1)) {
-        general_log(LOG_SCOPE, LOG_ERROR, "Failed to create a block.");
+block *create_a_new_block(mempool *pool, sha256_digest *previous_block_header_hash, sha256_digest *result_header_hash) {
+    block *block1 = assemble_block(pool, previous_block_header_hash, BLOCK_MAX_SIZE, BLOCK_MAX_TRANSACTIONS);
+    if (block1->txn_count == 0) {
+        // Nothing is worth mining; the template goes without touching the pool.
+        free(block1->txns);
+        destroy_block(block1);
+        return NULL;
+    }
+
+    if (!mine_block_header(block1->header, MINING_THREADS).found) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to mine a block.");
     }
 
     if (!finalize_block(block1)) {
         general_log(LOG_SCOPE, LOG_ERROR, "Failed to finalize a block.");
     }
 
+    // The transactions are confirmed now; the block takes them over from the mempool.
+    for (unsigned int i = 0; i < block1->txn_count; i++) {
+        if (!finalize_transaction(block1->txns[i])) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Failed to finalize a transaction.");
+        }
+    }
+    remove_mempool_block_transactions(pool, block1->txns, block1->txn_count);
+
     *result_header_hash = hash_block_header(block1->header);
     return block1;
+}
+
+/**
+ * Build the message sending a block to the listener, in
+ * WIRE_FORMAT. The size is worked out first, then the block
+ * is written once, right after the command header.
+ * @param command The command.
+ * @param b A block.
+ * @param size Where the number of bytes is written into.
+ * @return The message, on the heap.
+ */
+char *create_block_message(const char *command, block *b, int *size) {
+    int data_length = WIRE_FORMAT == WIRE_FORMAT_COMPACT ? get_serialized_block_size(b) : get_socket_block_length(b);
+    char *message = create_message(command, data_length);
+    if (WIRE_FORMAT == WIRE_FORMAT_COMPACT) {
+        serialize_block(b, (unsigned char *)message + COMMAND_LENGTH);
+    } else {
+        write_socket_block(b, (socket_block *)(message + COMMAND_LENGTH));
+    }
+    *size = COMMAND_LENGTH + data_length;
+    return message;
+}
+
+/**
+ * Build the message sending a transaction to the listener,
+ * in WIRE_FORMAT, as create_block_message() does.
+ * @param command The command.
+ * @param tx A transaction.
+ * @param size Where the number of bytes is written into.
+ * @return The message, on the heap.
+ */
+char *create_transaction_message(const char *command, transaction *tx, int *size) {
+    int data_length = WIRE_FORMAT == WIRE_FORMAT_COMPACT ? get_transaction_size(tx) : get_transaction_socket_length(tx);
+    char *message = create_message(command, data_length);
+    if (WIRE_FORMAT == WIRE_FORMAT_COMPACT) {
+        serialize_transaction(tx, (unsigned char *)message + COMMAND_LENGTH);
+    } else {
+        write_socket_transaction(tx, (socket_transaction *)(message + COMMAND_LENGTH));
+    }
+    *size = COMMAND_LENGTH + data_length;
+    return message;
 }
\ No newline at end of file
@@ -7,13 +7,17 @@
 #include <unistd.h>
 
 #include "../model/block/block.h"
+#include "../model/block/block_miner.h"
 #include "../model/block/block_persistence.h"
+#include "../model/transaction/mempool.h"
 #include "../model/transaction/transaction_persistence.h"
+#include "../model/transaction/utxo_snapshot.h"
 #include "pthread.h"
 #include "signal.h"
 #include "utils/constants.h"
 #include "utils/log_utils.h"
 #include "utils/mysql_util.h"
+#include "utils/socket_util.h"
 #include "utils/sys_utils.h"
 
 #define LOG_SCOPE "Listener"
@@ -21,6 +25,8 @@
 void DieWithError(char *errorMessage);
 void *HandleTCPClient(void *arg);
 
+static mempool *g_mempool = NULL;  // Transactions received but not yet in a block.
+
 int main(int argc, char const *argv[]) {
     int serverSock, clientSock;
     int server_fd;
@@ -79,11 +85,23 @@ int main(int argc, char const *argv[]) {
     // link to the database
     initialize_mysql_system(MYSQL_DB_LISTENER);
     initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
-    destroy_transaction_system();
-    destroy_block_system();
+    // The outputs a UTXO snapshot leaves unspent are read from the
+    // stored transactions, so the chain is only dropped without one.
+    bool has_utxo_snapshot = access(UTXO_SNAPSHOT_PATH, R_OK) == 0;
+    if (!has_utxo_snapshot) {
+        destroy_transaction_system();
+        destroy_block_system();
+    }
     initialize_transaction_system(true);
     initialize_block_system(true);
 
+    // Rebuild the UTXO from the last snapshot instead of replaying the chain.
+    if (has_utxo_snapshot) {
+        sha256_digest tip_hash = get_last_inserted_block_hash();
+        load_utxo_snapshot(UTXO_SNAPSHOT_PATH, &tip_hash, UTXO_SNAPSHOT_LOAD_THREADS);
+    }
+    g_mempool = create_mempool(MEMPOOL_MEMORY_LIMIT);
+
     // keep running for listening
     while (true) {
         cli_addr_len = sizeof(echo_server_address);
@@ -117,43 +135,100 @@ void DieWithError(char *errorMessage) { general_log(LOG_SCOPE, LOG_ERROR, "%s",
 
 void *HandleTCPClient(void *arg) {
     int clientSock = ((int *)arg)[0];
-    char echoBuffer[8092];
-
-    recv(clientSock, echoBuffer, sizeof(echoBuffer), 0);
+    free(arg);
+    // The sender closes the connection once the whole message is sent; no message holds more than a block.
+    size_t capacity = COMMAND_LENGTH + BLOCK_MAX_SIZE;
+    char *echoBuffer = (char *)malloc(capacity);
+
+    ssize_t received = receive_message_by_socket(clientSock, echoBuffer, capacity);
+    if (received < COMMAND_LENGTH) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Received %zd bytes, not a message.", received);
+        free(echoBuffer);
+        close(clientSock);
+        return NULL;
+    }
     char *receiveCommand = echoBuffer;
-    char *data = receiveCommand + 32;
+    char *data = receiveCommand + COMMAND_LENGTH;
+    size_t data_length = received - COMMAND_LENGTH;
+
+    // The sender picks the format in the last byte of the command, which older ones leave zero.
+    unsigned char wire_format = receiveCommand[COMMAND_LENGTH - 1];
+    receiveCommand[COMMAND_LENGTH - 1] = '\0';
     general_log(LOG_SCOPE, LOG_INFO, "Server: model received, Timestamp: %ul", get_timestamp());
     general_log(LOG_SCOPE, LOG_INFO, "Receive the command: %s: ", receiveCommand);
 
     if (TEST_CREATE_BLOCK) {
-        // receive the block
-        socket_block *recv_socket_blk = (socket_block *)malloc(sizeof(socket_block) + ((socket_block *)data)->txns_size);
-        memcpy(recv_socket_blk, data, sizeof(socket_block) + ((socket_block *)data)->txns_size);
-        block *block1 = cast_to_block(recv_socket_blk);
+        receiveCommand = str_trim(receiveCommand);
+        bool is_genesis = strcmp(receiveCommand, "genesis block") == 0;
+        free(receiveCommand);
+
+        // receive the block; a socket block is verified where it was received, and only copied out once accepted
+        block *block1 = NULL;
+        socket_block_view view;
+        bool well_formed;
+        if (wire_format == WIRE_FORMAT_COMPACT) {
+            block1 = deserialize_block((unsigned char *)data, data_length);
+            well_formed = block1 != NULL;
+        } else {
+            well_formed = view_socket_block((unsigned char *)data, data_length, &view);
+        }
+        if (!well_formed) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Received a malformed block.");
+            free(echoBuffer);
+            close(clientSock);
+            return NULL;
+        }
+
+        if (!is_genesis) {
+            // verification
+            bool valid = block1 != NULL ? verify_block(block1) : verify_socket_block_view(&view);
+            general_log(LOG_SCOPE, LOG_INFO, "Block verification done. Timestamp: %ul", get_timestamp());
+            if (!valid) {
+                general_log(LOG_SCOPE, LOG_ERROR, "Rejected an invalid block.");
+                if (block1 != NULL) destroy_block(block1);
+                free(echoBuffer);
+                close(clientSock);
+                return NULL;
+            }
+        }
+        if (block1 == NULL) block1 = materialize_socket_block(&view);
 
         // print block info
         printf("Block txns count: %d\n", block1->txn_count);
         printf("Block header version: %d\n", block1->header->version);
         printf("Block header hash: ");
-        print_hex(block1->header->prev_block_header_hash, 64);
+        print_hex(block1->header->prev_block_header_hash.data, SHA256_DIGEST_LENGTH);
         printf("Block txns[0] in[0] signature script: ");
         print_hex(block1->txns[0]->tx_ins[0].signature_script, 64);
 
-        receiveCommand = str_trim(receiveCommand);
-        if (strcmp(receiveCommand, "genesis block") != 0) {
-            // verification
-            verify_block(block1);
-            general_log(LOG_SCOPE, LOG_INFO, "Block verification done. Timestamp: %ul", get_timestamp());
-        }
-        free(receiveCommand);
-
         // save to database
         save_block(block1);
+        remove_mempool_block_transactions(g_mempool, block1->txns, block1->txn_count);
+
+        // A new tip; whatever is being mined on top of the old one is stale.
+        cancel_mining();
     } else {
         // receive the transaction
-        socket_transaction *recv_socket_tx = (socket_transaction *)malloc(get_socket_transaction_length((socket_transaction *)data));
-        memcpy(recv_socket_tx, data, get_socket_transaction_length((socket_transaction *)data));
-        transaction *tx = cast_to_transaction(recv_socket_tx);
+        transaction *tx;
+        if (wire_format == WIRE_FORMAT_COMPACT) {
+            byte_reader reader = {.data = (unsigned char *)data, .length = data_length, .offset = 0};
+            tx = deserialize_transaction(&reader, NULL);
+            if (tx != NULL && get_remaining_bytes(&reader) != 0) {
+                destroy_transaction(tx);
+                tx = NULL;
+            }
+        } else {
+            socket_transaction_view view;
+            bool well_formed = view_socket_transaction((unsigned char *)data, data_length, &view) &&
+                               get_socket_transaction_view_length(&view) == data_length;
+            tx = well_formed ? materialize_socket_transaction(&view, NULL) : NULL;
+        }
+        if (tx == NULL) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Received a malformed transaction.");
+            free(echoBuffer);
+            close(clientSock);
+            return NULL;
+        }
 
         // print receive socket tx info
         printf("%d\n", tx->tx_out_count);
@@ -163,15 +238,17 @@ void *HandleTCPClient(void *arg) {
 
         receiveCommand = str_trim(receiveCommand);
         if (strcmp(receiveCommand, "genesis transaction") != 0) {
-            // verification
-            verify_transaction(tx);
-            general_log(LOG_SCOPE, LOG_INFO, "Transaction verification done. Timestamp: %ul", get_timestamp());
+            // Verify and stage it until a block confirms it.
+            mempool_result result = add_mempool_transaction(g_mempool, tx);
+            general_log(LOG_SCOPE, LOG_INFO, "Transaction %s. Timestamp: %ul", get_mempool_result_name(result), get_timestamp());
+            if (result != MEMPOOL_ACCEPTED) destroy_transaction(tx);
+        } else {
+            // save to database
+            save_transaction(tx);
         }
         free(receiveCommand);
-
-        // save to database
-        save_transaction(tx);
     }
 
+    free(echoBuffer);
     close(clientSock);
 }
@@ -0,0 +1,98 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Add a chunk in front of the others.
+ * @param a The arena.
+ * @param size Bytes of data the chunk must at least hold.
+ * @return The chunk.
+ */
+static arena_chunk *add_arena_chunk(arena *a, size_t size) {
+    if (size < a->chunk_size) size = a->chunk_size;
+    arena_chunk *chunk = (arena_chunk *)malloc(sizeof(arena_chunk) + size);
+    chunk->next = a->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    a->chunks = chunk;
+
+    // Chunks grow with the arena, so that many small allocations need few of them.
+    a->chunk_size *= 2;
+    return chunk;
+}
+
+/**
+ * Find where an aligned allocation would start in a chunk.
+ * @param chunk The chunk.
+ * @return The offset into its data.
+ */
+static size_t get_aligned_offset(arena_chunk *chunk) {
+    uintptr_t next = (uintptr_t)(chunk->data + chunk->used);
+    return chunk->used + (ARENA_ALIGNMENT - next % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Create an arena.
+ * @param size The bytes expected to be allocated, which
+ * then fit in a single chunk; more may be allocated.
+ * @return The arena.
+ */
+arena *create_arena(size_t size) {
+    arena *a = (arena *)malloc(sizeof(arena));
+    a->chunks = NULL;
+    a->chunk_size = size > ARENA_MIN_CHUNK_SIZE ? size : ARENA_MIN_CHUNK_SIZE;
+    return a;
+}
+
+/**
+ * Destroy an arena, freeing everything allocated from it.
+ * @param a The arena.
+ */
+void destroy_arena(arena *a) {
+    if (a == NULL) return;
+    while (a->chunks != NULL) {
+        arena_chunk *next = a->chunks->next;
+        free(a->chunks);
+        a->chunks = next;
+    }
+    free(a);
+}
+
+/**
+ * Allocate memory from an arena.
+ * @param a The arena.
+ * @param size Bytes to allocate.
+ * @return Memory aligned to ARENA_ALIGNMENT, valid until the arena is destroyed.
+ */
+void *arena_alloc(arena *a, size_t size) {
+    arena_chunk *chunk = a->chunks;
+    size_t offset = chunk != NULL ? get_aligned_offset(chunk) : 0;
+    if (chunk == NULL || offset + size > chunk->size) {
+        chunk = add_arena_chunk(a, get_arena_allocation_size(size));
+        offset = get_aligned_offset(chunk);
+    }
+    chunk->used = offset + size;
+    return chunk->data + offset;
+}
+
+/**
+ * Get the bytes of an arena an allocation may take up
+ * at most, alignment included. Summing these gives a
+ * size for create_arena() that needs a single chunk.
+ * @param size Bytes to allocate.
+ * @return Bytes of the arena.
+ */
+size_t get_arena_allocation_size(size_t size) { return size + ARENA_ALIGNMENT - 1; }
@@ -0,0 +1,31 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_ARENA_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT 16         // Every allocation is aligned for any type.
+#define ARENA_MIN_CHUNK_SIZE 4096  // Chunks are never smaller than this.
+
+/*
+ * A region allocator. Allocations are carved out of large
+ * chunks one after another and cannot be freed one by one;
+ * everything goes at once with the arena. Not thread safe.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;  // The chunk filled before this one.
+    size_t size;              // Bytes of data.
+    size_t used;              // Bytes of data handed out, alignment included.
+    unsigned char data[];
+} arena_chunk;
+
+typedef struct Arena {
+    arena_chunk *chunks;  // The newest chunk, which allocations come from.
+    size_t chunk_size;    // Bytes of data of the next chunk.
+} arena;
+
+arena *create_arena(size_t);
+void destroy_arena(arena *);
+void *arena_alloc(arena *, size_t);
+size_t get_arena_allocation_size(size_t);
+
+#endif
@@ -22,6 +22,10 @@
 #define MYSQL_DB_MINER "miner"
 #define MYSQL_DB_LISTENER "listener"
 #define MYSQL_PORT_NUMBER 3306
+#define UTXO_CACHE_MEMORY_BUDGET (64 * 1024 * 1024)  // Bytes of UTXO entries cached in front of MySQL.
+#define UTXO_SNAPSHOT_PATH "utxo.snapshot"           // Loaded by the listener on startup, if present.
+#define UTXO_SNAPSHOT_LOAD_THREADS 0                 // 0 uses one thread per online CPU.
+#define MEMPOOL_MEMORY_LIMIT (32 * 1024 * 1024)      // Bytes of unconfirmed transactions the listener holds.
 
 // Logging
 #define VERBOSE true
@@ -31,8 +35,20 @@
 
 // Cryptography
 #define GENESIS_PRIVATE_KEY "FEB634D1D31157FF39BAA3551406BC8D15373AA3D54A6670CDBD28018161969C"
+#define SIGNATURE_VERIFICATION_THREADS 0  // 0 uses one thread per online CPU.
+#define SIGNATURE_CACHE_ENTRIES 65536     // Valid signatures remembered across transaction and block verification.
+#define BLOCK_VALIDATION_THREADS 0        // 0 uses one thread per online CPU.
+
+// Mining
+#define MINING_THREADS 0              // 0 uses one thread per online CPU.
+#define MINING_NBITS 0x1f00ffff       // A target of 0x0000ffff00...; about 65536 hashes per block.
+#define BLOCK_MAX_SIZE 1000000        // Bytes of a block, header included, in the raw format.
+#define BLOCK_MAX_TRANSACTIONS 10000  // Transactions a block may hold.
 
 // Socket
 #define COMMAND_LENGTH 32
+#define WIRE_FORMAT_SOCKET 0             // Socket structs, with fixed-size scripts.
+#define WIRE_FORMAT_COMPACT 1            // The raw format: CompactSize counts and scripts prefixed by their length.
+#define WIRE_FORMAT WIRE_FORMAT_COMPACT  // What the miner sends, in the last byte of the command; the listener reads both.
 
 #endif
@@ -0,0 +1,72 @@
+#include "cpu_features.h"
+
+#if CPU_FEATURES_X86
+#include <cpuid.h>
+#endif
+
+static cpu_features g_cpu_features;
+static bool g_cpu_features_detected = false;
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+#if CPU_FEATURES_X86
+/**
+ * Read an extended control register, used to check
+ * whether the OS saves the AVX/AVX-512 register state.
+ * @param index The register index.
+ * @return The value of the register.
+ */
+static unsigned long long read_xcr(unsigned int index) {
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((unsigned long long)edx << 32) | eax;
+}
+
+/**
+ * Query CPUID and fill in the global feature table.
+ */
+static void detect_cpu_features() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return;
+
+    g_cpu_features.ssse3 = (ecx & bit_SSSE3) != 0;
+    g_cpu_features.sse41 = (ecx & bit_SSE4_1) != 0;
+    bool os_saves_ymm = false, os_saves_zmm = false;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+        unsigned long long xcr0 = read_xcr(0);
+        os_saves_ymm = (xcr0 & 0x6) == 0x6;
+        os_saves_zmm = (xcr0 & 0xe6) == 0xe6;
+    }
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return;
+    g_cpu_features.avx2 = os_saves_ymm && (ebx & bit_AVX2) != 0;
+    g_cpu_features.bmi2 = (ebx & bit_BMI2) != 0;
+    g_cpu_features.avx512f = os_saves_zmm && (ebx & bit_AVX512F) != 0;
+    g_cpu_features.sha_ni = g_cpu_features.sse41 && (ebx & bit_SHA) != 0;
+}
+#endif
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Get the instruction set extensions supported by
+ * this machine. Non-x86 machines report none.
+ * @return The detected features.
+ */
+const cpu_features *get_cpu_features() {
+    if (!g_cpu_features_detected) {
+#if CPU_FEATURES_X86
+        detect_cpu_features();
+#endif
+        g_cpu_features_detected = true;
+    }
+    return &g_cpu_features;
+}
@@ -0,0 +1,27 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_CPU_FEATURES_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_CPU_FEATURES_H
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#else
+#define CPU_FEATURES_X86 0
+#endif
+
+/*
+ * Instruction set extensions the current processor (and OS)
+ * supports. Detected once through CPUID on first use.
+ */
+typedef struct CpuFeatures {
+    bool ssse3;    // Supplemental SSE3, for byte shuffles.
+    bool sse41;    // SSE4.1, for blends.
+    bool avx2;     // 256-bit integer vectors (requires OS YMM support).
+    bool bmi2;     // RORX and friends.
+    bool avx512f;  // 512-bit vectors (requires OS ZMM support).
+    bool sha_ni;   // Intel SHA extensions.
+} cpu_features;
+
+const cpu_features *get_cpu_features();
+
+#endif
@@ -4,10 +4,21 @@
 #include <secp256k1.h>
 #include <stdbool.h>
 
+#include "utils/sha256.h"
+
+#define SHA256_HEX_LENGTH 65  // 64 hexadecimal characters and the terminating NUL.
+
 /*
  * SHA256
  */
+sha256_digest hash_struct(void *, unsigned int);
 char *hash_struct_in_hex(void *, unsigned int);
+void convert_digest_to_hex(const sha256_digest *, char *);
+bool convert_hex_to_digest(const char *, sha256_digest *);
+bool is_digest_equal(const sha256_digest *, const sha256_digest *);
+bool is_digest_zero(const sha256_digest *);
+unsigned int hash_digest_key(const void *);
+int are_digest_keys_equal(const void *, const void *);
 
 /**
  * secp256k1
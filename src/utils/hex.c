@@ -0,0 +1,290 @@
+#include "hex.h"
+
+#include "utils/cpu_features.h"
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*hex_encode_function)(const unsigned char *src, size_t length, char *dest);
+typedef bool (*hex_decode_function)(const char *src, size_t length, unsigned char *dest);
+
+static const char g_hex_digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+// The value of each hexadecimal character plus one; 0 marks any other character.
+static const unsigned char g_hex_values[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,  ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10, ['A'] = 11,
+    ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16};
+
+static const char *g_hex_backend_names[HEX_BACKEND_COUNT] = {"generic", "ssse3", "avx2"};
+
+static void encode_hex_generic(const unsigned char *src, size_t length, char *dest);
+static bool decode_hex_generic(const char *src, size_t length, unsigned char *dest);
+#if CPU_FEATURES_X86
+static void encode_hex_ssse3(const unsigned char *src, size_t length, char *dest);
+static bool decode_hex_ssse3(const char *src, size_t length, unsigned char *dest);
+static void encode_hex_avx2(const unsigned char *src, size_t length, char *dest);
+static bool decode_hex_avx2(const char *src, size_t length, unsigned char *dest);
+#endif
+
+static hex_encode_function g_hex_encoders[HEX_BACKEND_COUNT] = {
+#if CPU_FEATURES_X86
+    encode_hex_generic, encode_hex_ssse3, encode_hex_avx2
+#else
+    encode_hex_generic, encode_hex_generic, encode_hex_generic
+#endif
+};
+static hex_decode_function g_hex_decoders[HEX_BACKEND_COUNT] = {
+#if CPU_FEATURES_X86
+    decode_hex_generic, decode_hex_ssse3, decode_hex_avx2
+#else
+    decode_hex_generic, decode_hex_generic, decode_hex_generic
+#endif
+};
+static hex_backend g_hex_backend = HEX_BACKEND_GENERIC;
+static hex_encode_function g_hex_encode = encode_hex_generic;
+static hex_decode_function g_hex_decode = decode_hex_generic;
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Portable encoder, one nibble at a time.
+ * @param src The bytes.
+ * @param length Number of bytes.
+ * @param dest Where 2 * length characters are written into.
+ */
+static void encode_hex_generic(const unsigned char *src, size_t length, char *dest) {
+    for (size_t i = 0; i < length; i++) {
+        dest[2 * i] = g_hex_digits[src[i] >> 4];
+        dest[2 * i + 1] = g_hex_digits[src[i] & 0xF];
+    }
+}
+
+/**
+ * Portable decoder, one character at a time.
+ * @param src 2 * length characters.
+ * @param length Number of bytes to decode.
+ * @param dest Where the bytes are written into.
+ * @return True for success, false if a character is not hexadecimal.
+ */
+static bool decode_hex_generic(const char *src, size_t length, unsigned char *dest) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char high = g_hex_values[(unsigned char)src[2 * i]];
+        unsigned char low = g_hex_values[(unsigned char)src[2 * i + 1]];
+        if (high == 0 || low == 0) return false;
+        dest[i] = (unsigned char)((high - 1) << 4 | (low - 1));
+    }
+    return true;
+}
+
+#if CPU_FEATURES_X86
+/**
+ * Turn every nibble into its character by looking the
+ * nibbles up in a 16-entry table with PSHUFB.
+ * @param bytes 16 bytes.
+ * @param first Characters of the first 8 bytes.
+ * @param second Characters of the last 8 bytes.
+ */
+static inline __attribute__((always_inline, target("ssse3"))) void encode_hex_vector_128(__m128i bytes, __m128i *first, __m128i *second) {
+    const __m128i digits = _mm_loadu_si128((const __m128i *)g_hex_digits);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask));
+    __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble_mask));
+    *first = _mm_unpacklo_epi8(high, low);
+    *second = _mm_unpackhi_epi8(high, low);
+}
+
+/**
+ * Turn 16 characters into nibbles, flagging anything
+ * that is not hexadecimal.
+ * @param chars 16 characters.
+ * @param valid Lanes holding a hexadecimal character are set to 0xFF.
+ * @return The nibbles.
+ */
+static inline __attribute__((always_inline, target("ssse3"))) __m128i decode_hex_nibbles_128(__m128i chars, __m128i *valid) {
+    __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    *valid = _mm_or_si128(is_digit, is_letter);
+    return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+/**
+ * SSSE3 encoder, 16 bytes per iteration.
+ * @param src The bytes.
+ * @param length Number of bytes.
+ * @param dest Where 2 * length characters are written into.
+ */
+__attribute__((target("ssse3"))) static void encode_hex_ssse3(const unsigned char *src, size_t length, char *dest) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i first, second;
+        encode_hex_vector_128(_mm_loadu_si128((const __m128i *)(src + i)), &first, &second);
+        _mm_storeu_si128((__m128i *)(dest + 2 * i), first);
+        _mm_storeu_si128((__m128i *)(dest + 2 * i + 16), second);
+    }
+    encode_hex_generic(src + i, length - i, dest + 2 * i);
+}
+
+/**
+ * SSSE3 decoder, 16 bytes per iteration. Each pair of
+ * nibbles is merged as high * 16 + low with PMADDUBSW.
+ * @param src 2 * length characters.
+ * @param length Number of bytes to decode.
+ * @param dest Where the bytes are written into.
+ * @return True for success, false if a character is not hexadecimal.
+ */
+__attribute__((target("ssse3"))) static bool decode_hex_ssse3(const char *src, size_t length, unsigned char *dest) {
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i first_valid, second_valid;
+        __m128i first = decode_hex_nibbles_128(_mm_loadu_si128((const __m128i *)(src + 2 * i)), &first_valid);
+        __m128i second = decode_hex_nibbles_128(_mm_loadu_si128((const __m128i *)(src + 2 * i + 16)), &second_valid);
+        if (_mm_movemask_epi8(_mm_and_si128(first_valid, second_valid)) != 0xFFFF) return false;
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+        _mm_storeu_si128((__m128i *)(dest + i), bytes);
+    }
+    return decode_hex_generic(src + 2 * i, length - i, dest + i);
+}
+
+/**
+ * AVX2 encoder, 32 bytes per iteration.
+ * @param src The bytes.
+ * @param length Number of bytes.
+ * @param dest Where 2 * length characters are written into.
+ */
+__attribute__((target("avx2"))) static void encode_hex_avx2(const unsigned char *src, size_t length, char *dest) {
+    const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)g_hex_digits));
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble_mask));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, nibble_mask));
+        // Unpacking works within 128-bit lanes; put the halves back in order.
+        __m256i interleaved_low = _mm256_unpacklo_epi8(high, low);
+        __m256i interleaved_high = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i *)(dest + 2 * i), _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest + 2 * i + 32), _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x31));
+    }
+    encode_hex_ssse3(src + i, length - i, dest + 2 * i);
+}
+
+/**
+ * AVX2 decoder, 32 bytes per iteration.
+ * @param src 2 * length characters.
+ * @param length Number of bytes to decode.
+ * @param dest Where the bytes are written into.
+ * @return True for success, false if a character is not hexadecimal.
+ */
+__attribute__((target("avx2"))) static bool decode_hex_avx2(const char *src, size_t length, unsigned char *dest) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i nibbles[2], valid = _mm256_set1_epi8(-1);
+        for (int half = 0; half < 2; half++) {
+            __m256i chars = _mm256_loadu_si256((const __m256i *)(src + 2 * i + 32 * half));
+            __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+            __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+            __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+            __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+            valid = _mm256_and_si256(valid, _mm256_or_si256(is_digit, is_letter));
+            nibbles[half] =
+                _mm256_or_si256(_mm256_and_si256(is_digit, digit), _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+        }
+        if ((unsigned int)_mm256_movemask_epi8(valid) != 0xFFFFFFFFu) return false;
+        // Packing works within 128-bit lanes; put the quarters back in order.
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(nibbles[0], weights), _mm256_maddubs_epi16(nibbles[1], weights));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_permute4x64_epi64(bytes, 0xD8));
+    }
+    return decode_hex_ssse3(src + 2 * i, length - i, dest + i);
+}
+#endif
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Check if a backend can run on this machine.
+ * @param backend The backend.
+ * @return True if supported, false otherwise.
+ */
+bool hex_is_backend_supported(hex_backend backend) {
+    const cpu_features *features = get_cpu_features();
+    switch (backend) {
+        case HEX_BACKEND_GENERIC:
+            return true;
+        case HEX_BACKEND_SSSE3:
+            return CPU_FEATURES_X86 && features->ssse3;
+        case HEX_BACKEND_AVX2:
+            return CPU_FEATURES_X86 && features->ssse3 && features->avx2;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Route all hexadecimal conversion through a specific backend.
+ * @param backend The backend.
+ * @return True for success, false if the CPU does not support it.
+ */
+bool hex_use_backend(hex_backend backend) {
+    if (!hex_is_backend_supported(backend)) return false;
+    g_hex_backend = backend;
+    g_hex_encode = g_hex_encoders[backend];
+    g_hex_decode = g_hex_decoders[backend];
+    return true;
+}
+
+/**
+ * Pick the fastest backend the CPU supports.
+ */
+void hex_select_backend() {
+    for (int backend = HEX_BACKEND_COUNT - 1; backend >= HEX_BACKEND_GENERIC; backend--) {
+        if (hex_use_backend(backend)) break;
+    }
+}
+
+/**
+ * Get the backend currently in use.
+ * @return The backend.
+ */
+hex_backend hex_get_backend() { return g_hex_backend; }
+
+/**
+ * Get the printable name of a backend.
+ * @param backend The backend.
+ * @return The name.
+ */
+const char *hex_get_backend_name(hex_backend backend) { return backend < HEX_BACKEND_COUNT ? g_hex_backend_names[backend] : "unknown"; }
+
+/**
+ * Write bytes as uppercase hexadecimal characters.
+ * Nothing is allocated.
+ * @param src The bytes.
+ * @param length Number of bytes.
+ * @param dest At least 2 * length + 1 bytes; NUL-terminated on return.
+ */
+void encode_hex(const void *src, size_t length, char *dest) {
+    g_hex_encode((const unsigned char *)src, length, dest);
+    dest[2 * length] = '\0';
+}
+
+/**
+ * Parse hexadecimal characters, in either case, into bytes.
+ * Nothing is allocated.
+ * @param src At least 2 * length characters; all of them may be read.
+ * @param length Number of bytes to decode.
+ * @param dest Where the bytes are written into; partially written on failure.
+ * @return True for success, false if a character is not hexadecimal.
+ */
+bool decode_hex(const char *src, size_t length, void *dest) { return g_hex_decode(src, length, (unsigned char *)dest); }
@@ -0,0 +1,27 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_HEX_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_HEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Implementations of the hexadecimal codec. The fastest
+ * one supported by the CPU is picked by hex_select_backend();
+ * the generic one always works.
+ */
+typedef enum HexBackend {
+    HEX_BACKEND_GENERIC,  // Portable table lookups.
+    HEX_BACKEND_SSSE3,    // 16 bytes at a time with byte shuffles.
+    HEX_BACKEND_AVX2,     // 32 bytes at a time.
+    HEX_BACKEND_COUNT
+} hex_backend;
+
+void hex_select_backend();
+bool hex_use_backend(hex_backend);
+bool hex_is_backend_supported(hex_backend);
+hex_backend hex_get_backend();
+const char *hex_get_backend_name(hex_backend);
+void encode_hex(const void *, size_t, char *);
+bool decode_hex(const char *, size_t, void *);
+
+#endif
@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "utils/constants.h"
+#include "utils/hex.h"
 #include "utils/sys_utils.h"
 
 // Regular text
@@ -90,12 +91,7 @@
  */
 char *convert_char_hexadecimal(char *ptr, unsigned int byte_length) {
     char *ret_val = (char *)malloc(2 * byte_length + 1);
-    char *ret_val_counter = ret_val;
-    for (int i = 0; i < byte_length; i++) {
-        sprintf(ret_val_counter, "%02hhX", *ptr++);
-        ret_val_counter += 2;
-    }
-    *ret_val_counter = '\0';
+    encode_hex(ptr, byte_length, ret_val);
     return ret_val;
 }
 
@@ -157,12 +153,13 @@ void generate_dot_representation(block **block_list, int list_len, char *filenam
 
     // Create sub-graphs(blocks&transactions)
     for (int i = 0; i < list_len; i++) {
-        char *txid_dot;
+        char txid_dot[SHA256_HEX_LENGTH];
         fprintf(fp, "subgraph cluster_%d{\n ", i);
         fprintf(fp, "label = \"Block%d\";\n", i);
         fprintf(fp, "DUMMY_%d [shape=point style=invis];\n", i);
         for (int j = 0; j < block_list[i]->txn_count; j++) {
-            txid_dot = get_transaction_txid(block_list[i]->txns[j]);
+            sha256_digest txid = get_transaction_txid(block_list[i]->txns[j]);
+            convert_digest_to_hex(&txid, txid_dot);
             fprintf(fp, "txid%s;\n", txid_dot);
         }
         fprintf(fp, "}\n");
@@ -176,13 +173,15 @@ void generate_dot_representation(block **block_list, int list_len, char *filenam
 
     // Connect all transactions
     for (int m = 0; m < list_len; m++) {
-        char *txid_trans;
-        char *txid_previous;
+        char txid_trans[SHA256_HEX_LENGTH];
+        char txid_previous[SHA256_HEX_LENGTH];
         for (int n = 0; n < block_list[m]->txn_count; n++) {
-            txid_trans = get_transaction_txid(block_list[m]->txns[n]);
+            sha256_digest txid = get_transaction_txid(block_list[m]->txns[n]);
+            convert_digest_to_hex(&txid, txid_trans);
             for (int o = 0; o < block_list[m]->txns[n]->tx_in_count; o++) {
-                txid_previous = block_list[m]->txns[n]->tx_ins[o].previous_outpoint.hash;
-                if (strlen(txid_previous) > 0) {
+                sha256_digest *previous_txid = &block_list[m]->txns[n]->tx_ins[o].previous_outpoint.hash;
+                if (!is_digest_zero(previous_txid)) {
+                    convert_digest_to_hex(previous_txid, txid_previous);
                     fprintf(fp, "txid%s -> txid%s;\n", txid_previous, txid_trans);
                 }
             }
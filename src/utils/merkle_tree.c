@@ -0,0 +1,202 @@
+#include "merkle_tree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Hash two nodes into their parent.
+ * @param left The left child.
+ * @param right The right child.
+ * @param dest Where the parent is written into.
+ */
+static void hash_merkle_node(const sha256_digest *left, const sha256_digest *right, sha256_digest *dest) {
+    sha256_digest first;
+    sha256_context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, left->data, SHA256_DIGEST_LENGTH);
+    sha256_update(&ctx, right->data, SHA256_DIGEST_LENGTH);
+    sha256_final(&ctx, &first);
+    sha256_init(&ctx);
+    sha256_update(&ctx, first.data, SHA256_DIGEST_LENGTH);
+    sha256_final(&ctx, dest);
+}
+
+/**
+ * Make room for a node in a level of the tree.
+ * @param tree The tree.
+ * @param level The level.
+ * @param index The index of the node.
+ */
+static void reserve_merkle_tree_node(merkle_tree *tree, unsigned int level, unsigned int index) {
+    if (index < tree->capacities[level]) return;
+    unsigned int capacity = tree->capacities[level] == 0 ? 16 : tree->capacities[level];
+    while (capacity <= index) capacity *= 2;
+    tree->levels[level] = (sha256_digest *)realloc(tree->levels[level], capacity * sizeof(sha256_digest));
+    tree->capacities[level] = capacity;
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Compute a Merkle root in one go. Every level is hashed
+ * as a batch, many pairs at a time in SIMD lanes.
+ * @param leaves The leaves.
+ * @param count Number of leaves.
+ * @return The root; all zeros when there are no leaves.
+ */
+sha256_digest compute_merkle_root(const sha256_digest *leaves, unsigned int count) {
+    sha256_digest root = {{0}};
+    if (count == 0) return root;
+    if (count == 1) return leaves[0];
+
+    // One spare slot so that an odd last node can sit next to its copy.
+    sha256_digest *level = (sha256_digest *)malloc((count + 1) * sizeof(sha256_digest));
+    sha256_digest *first = (sha256_digest *)malloc((count / 2 + 1) * sizeof(sha256_digest));
+    const unsigned char **messages = (const unsigned char **)malloc((count / 2 + 1) * sizeof(unsigned char *));
+    memcpy(level, leaves, count * sizeof(sha256_digest));
+
+    while (count > 1) {
+        if (count % 2 == 1) {
+            level[count] = level[count - 1];
+            count++;
+        }
+        unsigned int parents = count / 2;
+
+        // Each pair is already contiguous: 64 bytes starting at its left child.
+        for (unsigned int i = 0; i < parents; i++) messages[i] = level[2 * i].data;
+        sha256_batch(messages, 2 * SHA256_DIGEST_LENGTH, parents, first);
+        for (unsigned int i = 0; i < parents; i++) messages[i] = first[i].data;
+        sha256_batch(messages, SHA256_DIGEST_LENGTH, parents, level);
+        count = parents;
+    }
+
+    root = level[0];
+    free(messages);
+    free(first);
+    free(level);
+    return root;
+}
+
+/**
+ * Create an empty Merkle tree.
+ * @return The tree.
+ */
+merkle_tree *create_merkle_tree() {
+    merkle_tree *tree = (merkle_tree *)malloc(sizeof(merkle_tree));
+    memset(tree, 0, sizeof(merkle_tree));
+    return tree;
+}
+
+/**
+ * Destroy a Merkle tree, free all of its memory space.
+ * @param tree The tree.
+ */
+void destroy_merkle_tree(merkle_tree *tree) {
+    if (tree == NULL) return;
+    for (unsigned int i = 0; i < MERKLE_TREE_MAX_LEVELS; i++) free(tree->levels[i]);
+    free(tree);
+}
+
+/**
+ * Set a leaf and rehash its path to the root, O(log n).
+ * Setting a leaf past the end appends it, with any gap
+ * filled by zero leaves.
+ * @param tree The tree.
+ * @param index The index of the leaf.
+ * @param leaf The new leaf.
+ */
+void set_merkle_tree_leaf(merkle_tree *tree, unsigned int index, const sha256_digest *leaf) {
+    static const sha256_digest zero_leaf;
+    while (tree->sizes[0] < index) set_merkle_tree_leaf(tree, tree->sizes[0], &zero_leaf);
+
+    reserve_merkle_tree_node(tree, 0, index);
+    tree->levels[0][index] = *leaf;
+    if (index == tree->sizes[0]) tree->sizes[0]++;
+
+    unsigned int level = 0;
+    while (tree->sizes[level] > 1) {
+        unsigned int parent = index / 2;
+        sha256_digest *left = &tree->levels[level][2 * parent];
+        sha256_digest *right = 2 * parent + 1 < tree->sizes[level] ? left + 1 : left;
+
+        reserve_merkle_tree_node(tree, level + 1, parent);
+        hash_merkle_node(left, right, &tree->levels[level + 1][parent]);
+        if (parent >= tree->sizes[level + 1]) tree->sizes[level + 1] = parent + 1;
+
+        index = parent;
+        level++;
+    }
+    tree->height = level + 1;
+}
+
+/**
+ * Get the number of leaves of a Merkle tree.
+ * @param tree The tree.
+ * @return The number of leaves.
+ */
+unsigned int get_merkle_tree_size(merkle_tree *tree) { return tree->sizes[0]; }
+
+/**
+ * Get the root of a Merkle tree.
+ * @param tree The tree.
+ * @return The root; all zeros when the tree is empty.
+ */
+sha256_digest get_merkle_tree_root(merkle_tree *tree) {
+    sha256_digest root = {{0}};
+    if (tree->sizes[0] == 0) return root;
+    return tree->levels[tree->height - 1][0];
+}
+
+/**
+ * Add the next leaf, hashing every pair it completes.
+ * @param builder The builder.
+ * @param leaf The leaf.
+ */
+void add_merkle_root_builder_leaf(merkle_root_builder *builder, const sha256_digest *leaf) {
+    sha256_digest node = *leaf;
+    unsigned int level = 0;
+    while (builder->count & (1u << level)) {
+        hash_merkle_node(&builder->pending[level], &node, &node);
+        level++;
+    }
+    builder->pending[level] = node;
+    builder->count++;
+}
+
+/**
+ * Get the root over the leaves added so far, the same as
+ * compute_merkle_root() over them: a node left alone at
+ * the end of a level is paired with itself.
+ * @param builder The builder.
+ * @return The root; all zeros when there are no leaves.
+ */
+sha256_digest get_merkle_root_builder_root(merkle_root_builder *builder) {
+    sha256_digest root = {{0}};
+    unsigned int count = builder->count;
+    if (count == 0) return root;
+
+    // The lowest pending node is the last one of its level.
+    unsigned int level = 0;
+    while (!(count & (1u << level))) level++;
+    root = builder->pending[level];
+    while (count != 1u << level) {
+        hash_merkle_node(&root, &root, &root);
+        count += 1u << level;
+        level++;
+        while (!(count & (1u << level))) {
+            hash_merkle_node(&builder->pending[level], &root, &root);
+            level++;
+        }
+    }
+    return root;
+}
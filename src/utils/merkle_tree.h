@@ -0,0 +1,40 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_MERKLE_TREE_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_MERKLE_TREE_H
+
+#include "utils/sha256.h"
+
+#define MERKLE_TREE_MAX_LEVELS 33  // Enough for 2^32 leaves.
+
+/*
+ * A Merkle tree that keeps every level, so that changing
+ * or appending a leaf only rehashes its path to the root.
+ * Parents are SHA256(SHA256(left || right)); a level of
+ * odd size pairs its last node with itself.
+ */
+typedef struct MerkleTree {
+    sha256_digest *levels[MERKLE_TREE_MAX_LEVELS];  // levels[0] holds the leaves.
+    unsigned int sizes[MERKLE_TREE_MAX_LEVELS];
+    unsigned int capacities[MERKLE_TREE_MAX_LEVELS];
+    unsigned int height;  // Number of levels in use; the top one holds the root.
+} merkle_tree;
+
+/*
+ * The root of a Merkle tree over leaves added one after
+ * another, keeping only the left node waiting at each level,
+ * so that nothing is allocated. Starts zeroed.
+ */
+typedef struct MerkleRootBuilder {
+    sha256_digest pending[MERKLE_TREE_MAX_LEVELS];  // pending[i] waits for its right sibling while bit i of count is set.
+    unsigned int count;                              // Leaves added so far.
+} merkle_root_builder;
+
+sha256_digest compute_merkle_root(const sha256_digest *, unsigned int);
+merkle_tree *create_merkle_tree();
+void destroy_merkle_tree(merkle_tree *);
+void set_merkle_tree_leaf(merkle_tree *, unsigned int, const sha256_digest *);
+unsigned int get_merkle_tree_size(merkle_tree *);
+sha256_digest get_merkle_tree_root(merkle_tree *);
+void add_merkle_root_builder_leaf(merkle_root_builder *, const sha256_digest *);
+sha256_digest get_merkle_root_builder_root(merkle_root_builder *);
+
+#endif
@@ -0,0 +1,158 @@
+#include "serialize.h"
+
+/**
+ * Write a word in little endian.
+ * @param dest Four bytes.
+ * @param word The word.
+ * @return The byte after it.
+ */
+unsigned char *write_le32(unsigned char *dest, unsigned int word) {
+    dest[0] = word;
+    dest[1] = word >> 8;
+    dest[2] = word >> 16;
+    dest[3] = word >> 24;
+    return dest + 4;
+}
+
+/**
+ * Write a double word in little endian.
+ * @param dest Eight bytes.
+ * @param word The double word.
+ * @return The byte after it.
+ */
+unsigned char *write_le64(unsigned char *dest, unsigned long long word) {
+    write_le32(dest, (unsigned int)word);
+    return write_le32(dest + 4, (unsigned int)(word >> 32));
+}
+
+/**
+ * Write a CompactSize unsigned integer: one byte below
+ * 0xFD, otherwise a marker byte and 2, 4 or 8 bytes.
+ * @param dest get_compact_size_length() bytes.
+ * @param value The value.
+ * @return The byte after it.
+ */
+unsigned char *write_compact_size(unsigned char *dest, unsigned long long value) {
+    if (value < 0xFD) {
+        *dest = value;
+        return dest + 1;
+    }
+    if (value <= 0xFFFF) {
+        dest[0] = 0xFD;
+        dest[1] = value;
+        dest[2] = value >> 8;
+        return dest + 3;
+    }
+    if (value <= 0xFFFFFFFF) {
+        *dest = 0xFE;
+        return write_le32(dest + 1, (unsigned int)value);
+    }
+    *dest = 0xFF;
+    return write_le64(dest + 1, value);
+}
+
+/**
+ * Read a little endian word.
+ * @param src Four bytes.
+ * @return The word.
+ */
+unsigned int load_le32(const unsigned char *src) {
+    return (unsigned int)src[0] | ((unsigned int)src[1] << 8) | ((unsigned int)src[2] << 16) | ((unsigned int)src[3] << 24);
+}
+
+/**
+ * Read a little endian double word.
+ * @param src Eight bytes.
+ * @return The double word.
+ */
+unsigned long long load_le64(const unsigned char *src) { return (unsigned long long)load_le32(src) | ((unsigned long long)load_le32(src + 4) << 32); }
+
+/**
+ * Get the number of bytes a value takes as a CompactSize
+ * unsigned integer.
+ * @param value The value.
+ * @return Its length.
+ */
+unsigned int get_compact_size_length(unsigned long long value) {
+    if (value < 0xFD) return 1;
+    if (value <= 0xFFFF) return 3;
+    if (value <= 0xFFFFFFFF) return 5;
+    return 9;
+}
+
+/**
+ * Get the number of bytes a reader has not read yet.
+ * @param reader A reader.
+ * @return The bytes left.
+ */
+size_t get_remaining_bytes(byte_reader *reader) { return reader->length - reader->offset; }
+
+/**
+ * Step over some bytes.
+ * @param reader A reader.
+ * @param length Number of bytes.
+ * @return The first of them, or NULL if fewer are left.
+ */
+const unsigned char *read_bytes(byte_reader *reader, size_t length) {
+    if (length > get_remaining_bytes(reader)) return NULL;
+    const unsigned char *bytes = reader->data + reader->offset;
+    reader->offset += length;
+    return bytes;
+}
+
+/**
+ * Read a little endian word.
+ * @param reader A reader.
+ * @param dest Where the word is written into.
+ * @return True for success, false if fewer than four bytes are left.
+ */
+bool read_le32(byte_reader *reader, unsigned int *dest) {
+    const unsigned char *bytes = read_bytes(reader, 4);
+    if (bytes == NULL) return false;
+    *dest = load_le32(bytes);
+    return true;
+}
+
+/**
+ * Read a little endian double word.
+ * @param reader A reader.
+ * @param dest Where the double word is written into.
+ * @return True for success, false if fewer than eight bytes are left.
+ */
+bool read_le64(byte_reader *reader, unsigned long long *dest) {
+    const unsigned char *bytes = read_bytes(reader, 8);
+    if (bytes == NULL) return false;
+    *dest = load_le64(bytes);
+    return true;
+}
+
+/**
+ * Read a CompactSize unsigned integer. Only the shortest
+ * encoding of a value is accepted, so that every value
+ * has exactly one.
+ * @param reader A reader.
+ * @param dest Where the value is written into.
+ * @return True for success, false if it is cut off or not the shortest.
+ */
+bool read_compact_size(byte_reader *reader, unsigned long long *dest) {
+    const unsigned char *marker = read_bytes(reader, 1);
+    if (marker == NULL) return false;
+
+    unsigned int length = *marker < 0xFD ? 0 : *marker == 0xFD ? 2 : *marker == 0xFE ? 4 : 8;
+    const unsigned char *bytes = read_bytes(reader, length);
+    if (bytes == NULL) return false;
+    switch (length) {
+        case 0:
+            *dest = *marker;
+            break;
+        case 2:
+            *dest = (unsigned long long)bytes[0] | ((unsigned long long)bytes[1] << 8);
+            break;
+        case 4:
+            *dest = load_le32(bytes);
+            break;
+        default:
+            *dest = load_le64(bytes);
+    }
+    return get_compact_size_length(*dest) == 1 + length;
+}
@@ -0,0 +1,31 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SERIALIZE_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SERIALIZE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Little endian words and CompactSize unsigned integers,
+ * as in the raw transaction format. Writers return where
+ * the next field goes; readers fail instead of reading
+ * past the end of their bytes.
+ */
+typedef struct ByteReader {
+    const unsigned char *data;  // The bytes being read.
+    size_t length;              // Bytes in total.
+    size_t offset;              // Bytes read so far.
+} byte_reader;
+
+unsigned char *write_le32(unsigned char *, unsigned int);
+unsigned char *write_le64(unsigned char *, unsigned long long);
+unsigned char *write_compact_size(unsigned char *, unsigned long long);
+unsigned int load_le32(const unsigned char *);
+unsigned long long load_le64(const unsigned char *);
+unsigned int get_compact_size_length(unsigned long long);
+size_t get_remaining_bytes(byte_reader *);
+const unsigned char *read_bytes(byte_reader *, size_t);
+bool read_le32(byte_reader *, unsigned int *);
+bool read_le64(byte_reader *, unsigned long long *);
+bool read_compact_size(byte_reader *, unsigned long long *);
+
+#endif
@@ -0,0 +1,636 @@
+#include "sha256.h"
+
+#include <string.h>
+
+#include "utils/cpu_features.h"
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*sha256_transform_function)(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+typedef void (*sha256_batch_function)(const unsigned char *const *messages, size_t length, sha256_digest *digests);
+
+// SHA256 macro
+#define ROT_LEFT(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
+#define ROT_RIGHT(a, b) (((a) >> (b)) | ((a) << (32 - (b))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define EP0(x) (ROT_RIGHT(x, 2) ^ ROT_RIGHT(x, 13) ^ ROT_RIGHT(x, 22))
+#define EP1(x) (ROT_RIGHT(x, 6) ^ ROT_RIGHT(x, 11) ^ ROT_RIGHT(x, 25))
+#define SIG0(x) (ROT_RIGHT(x, 7) ^ ROT_RIGHT(x, 18) ^ ((x) >> 3))
+#define SIG1(x) (ROT_RIGHT(x, 17) ^ ROT_RIGHT(x, 19) ^ ((x) >> 10))
+
+// SHA256 global variable
+static const unsigned int g_sha256_initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+static const unsigned int g_sha256_k[64] __attribute__((aligned(16))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+    0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+    0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const char *g_sha256_backend_names[SHA256_BACKEND_COUNT] = {"generic", "ssse3", "avx2", "sha-ni"};
+
+static void sha256_transform_generic(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+#if CPU_FEATURES_X86
+static void sha256_transform_ssse3(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+static void sha256_transform_avx2(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+static void sha256_transform_sha_ni(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+#endif
+
+static sha256_transform_function g_sha256_transforms[SHA256_BACKEND_COUNT] = {
+#if CPU_FEATURES_X86
+    sha256_transform_generic, sha256_transform_ssse3, sha256_transform_avx2, sha256_transform_sha_ni
+#else
+    sha256_transform_generic, NULL, NULL, NULL
+#endif
+};
+
+static sha256_backend g_sha256_backend = SHA256_BACKEND_GENERIC;
+static sha256_transform_function g_sha256_transform = sha256_transform_generic;
+
+static void sha256_batch_lanes4(const unsigned char *const *messages, size_t length, sha256_digest *digests);
+#if CPU_FEATURES_X86
+static void sha256_batch_lanes8(const unsigned char *const *messages, size_t length, sha256_digest *digests);
+static void sha256_batch_lanes16(const unsigned char *const *messages, size_t length, sha256_digest *digests);
+#endif
+
+static unsigned int g_sha256_batch_lanes = 4;
+static sha256_batch_function g_sha256_batch = sha256_batch_lanes4;
+
+/*
+ * -----------------------------------------------------------
+ * Generic Backend
+ * -----------------------------------------------------------
+ */
+
+/**
+ * The portable reference compression function.
+ * @param state The chaining state.
+ * @param blocks Consecutive 64-byte blocks.
+ * @param block_count Number of blocks.
+ */
+static void sha256_transform_generic(unsigned int state[8], const unsigned char *blocks, size_t block_count) {
+    unsigned int a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
+
+    for (; block_count > 0; block_count--, blocks += SHA256_BLOCK_LENGTH) {
+        const unsigned char *data = blocks;
+        for (i = 0, j = 0; i < 16; ++i, j += 4) m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+        for (; i < 64; ++i) m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (i = 0; i < 64; ++i) {
+            t1 = h + EP1(e) + CH(e, f, g) + g_sha256_k[i] + m[i];
+            t2 = EP0(a) + MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if CPU_FEATURES_X86
+/*
+ * -----------------------------------------------------------
+ * SSSE3 / AVX2 Backends
+ * -----------------------------------------------------------
+ */
+
+#define VEC_ROT_RIGHT(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define VEC_SIG0(x) _mm_xor_si128(_mm_xor_si128(VEC_ROT_RIGHT(x, 7), VEC_ROT_RIGHT(x, 18)), _mm_srli_epi32(x, 3))
+#define VEC_SIG1(x) _mm_xor_si128(_mm_xor_si128(VEC_ROT_RIGHT(x, 17), VEC_ROT_RIGHT(x, 19)), _mm_srli_epi32(x, 10))
+
+/**
+ * Compression function with the message schedule computed
+ * four words at a time in XMM registers and pre-added to the
+ * round constants, leaving only the rounds in scalar code.
+ * Inlined into each ISA-specific wrapper so that the wrapper's
+ * target (legacy SSE or VEX + RORX) decides the encoding.
+ * @param state The chaining state.
+ * @param blocks Consecutive 64-byte blocks.
+ * @param block_count Number of blocks.
+ */
+static inline __attribute__((always_inline, target("ssse3"))) void sha256_transform_vector_schedule(unsigned int state[8],
+                                                                                                     const unsigned char *blocks,
+                                                                                                     size_t block_count) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const __m128i low_lanes = _mm_set_epi32(0, 0, -1, -1);
+    unsigned int wk[64] __attribute__((aligned(16)));
+    unsigned int a, b, c, d, e, f, g, h, t1, t2;
+
+    for (; block_count > 0; block_count--, blocks += SHA256_BLOCK_LENGTH) {
+        // groups[0..3] hold W[i-16..i-1], four words per register.
+        __m128i groups[4];
+        for (int i = 0; i < 4; i++) {
+            groups[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16 * i)), byte_swap);
+            _mm_store_si128((__m128i *)&wk[4 * i], _mm_add_epi32(groups[i], _mm_load_si128((const __m128i *)&g_sha256_k[4 * i])));
+        }
+
+        for (int i = 16; i < 64; i += 4) {
+            // Everything but SIG1 only depends on words of earlier groups.
+            __m128i w_15 = _mm_alignr_epi8(groups[1], groups[0], 4);
+            __m128i w_7 = _mm_alignr_epi8(groups[3], groups[2], 4);
+            __m128i partial = _mm_add_epi32(_mm_add_epi32(groups[0], VEC_SIG0(w_15)), w_7);
+
+            // SIG1 of W[i-2], W[i-1] gives the two low lanes, which then feed the two high lanes.
+            __m128i w_2 = _mm_srli_si128(groups[3], 8);
+            __m128i words = _mm_add_epi32(partial, _mm_and_si128(VEC_SIG1(w_2), low_lanes));
+            w_2 = _mm_slli_si128(words, 8);
+            words = _mm_add_epi32(words, _mm_andnot_si128(low_lanes, VEC_SIG1(w_2)));
+
+            _mm_store_si128((__m128i *)&wk[i], _mm_add_epi32(words, _mm_load_si128((const __m128i *)&g_sha256_k[i])));
+            groups[0] = groups[1];
+            groups[1] = groups[2];
+            groups[2] = groups[3];
+            groups[3] = words;
+        }
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (int i = 0; i < 64; ++i) {
+            t1 = h + EP1(e) + CH(e, f, g) + wk[i];
+            t2 = EP0(a) + MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+__attribute__((target("ssse3"))) static void sha256_transform_ssse3(unsigned int state[8], const unsigned char *blocks, size_t block_count) {
+    sha256_transform_vector_schedule(state, blocks, block_count);
+}
+
+__attribute__((target("avx2,bmi2"))) static void sha256_transform_avx2(unsigned int state[8], const unsigned char *blocks, size_t block_count) {
+    sha256_transform_vector_schedule(state, blocks, block_count);
+}
+
+/*
+ * -----------------------------------------------------------
+ * SHA-NI Backend
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Compression function on the Intel SHA extensions. Each
+ * sha256rnds2 performs two rounds; the message schedule is
+ * produced by sha256msg1/sha256msg2 four words at a time.
+ * @param state The chaining state.
+ * @param blocks Consecutive 64-byte blocks.
+ * @param block_count Number of blocks.
+ */
+__attribute__((target("sha,sse4.1"))) static void sha256_transform_sha_ni(unsigned int state[8],
+                                                                          const unsigned char *blocks,
+                                                                          size_t block_count) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, msg, tmp, abef_save, cdgh_save;
+    __m128i msgs[4];
+
+    // The instructions want the state as ABEF / CDGH.
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; block_count > 0; block_count--, blocks += SHA256_BLOCK_LENGTH) {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        for (int group = 0; group < 16; group++) {
+            __m128i *current = &msgs[group & 3];
+            if (group < 4) *current = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16 * group)), byte_swap);
+
+            msg = _mm_add_epi32(*current, _mm_load_si128((const __m128i *)&g_sha256_k[4 * group]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (group >= 3 && group <= 14) {
+                __m128i *next = &msgs[(group + 1) & 3];
+                tmp = _mm_alignr_epi8(*current, msgs[(group + 3) & 3], 4);
+                *next = _mm_sha256msg2_epu32(_mm_add_epi32(*next, tmp), *current);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (group >= 1 && group <= 12) {
+                __m128i *previous = &msgs[(group + 3) & 3];
+                *previous = _mm_sha256msg1_epu32(*previous, *current);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    // Back to ABCD / EFGH.
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif
+
+/*
+ * -----------------------------------------------------------
+ * Multi-buffer Batch Hashing
+ * -----------------------------------------------------------
+ */
+
+typedef unsigned int sha256_lanes4 __attribute__((vector_size(16)));
+#if CPU_FEATURES_X86
+typedef unsigned int sha256_lanes8 __attribute__((vector_size(32)));
+typedef unsigned int sha256_lanes16 __attribute__((vector_size(64)));
+#endif
+
+/**
+ * Read a big endian word.
+ * @param data Four bytes.
+ * @return The word.
+ */
+static inline unsigned int sha256_load_be32(const unsigned char *data) {
+    return ((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) | ((unsigned int)data[2] << 8) | data[3];
+}
+
+/**
+ * Copy one block of a message into a buffer, applying
+ * the SHA256 padding to the final block(s).
+ * @param block Where the block is written into.
+ * @param message The message.
+ * @param length The length of the message, in bytes.
+ * @param index Which block of the padded message to produce.
+ * @param block_count Number of blocks in the padded message.
+ */
+static inline void sha256_batch_load_block(unsigned char *block, const unsigned char *message, size_t length, size_t index, size_t block_count) {
+    size_t offset = index * SHA256_BLOCK_LENGTH;
+    if (offset + SHA256_BLOCK_LENGTH <= length) {
+        memcpy(block, message + offset, SHA256_BLOCK_LENGTH);
+        return;
+    }
+
+    size_t copied = 0;
+    if (length > offset) {
+        copied = length - offset;
+        memcpy(block, message + offset, copied);
+    }
+    memset(block + copied, 0, SHA256_BLOCK_LENGTH - copied);
+    if (length >= offset) block[copied] = 0x80;
+    if (index == block_count - 1) {
+        unsigned long long bit_len = (unsigned long long)length * 8;
+        for (int i = 0; i < 8; i++) block[SHA256_BLOCK_LENGTH - 1 - i] = bit_len >> (8 * i);
+    }
+}
+
+/*
+ * Hash `lanes` messages of the same length at once, one
+ * message per vector lane. The scalar round macros work
+ * on GCC vector types unchanged, so the target attribute
+ * alone decides between SSE2/NEON, AVX2 and AVX-512.
+ */
+#define SHA256_DEFINE_BATCH_FUNCTION(name, vector, lanes, attributes)                                                 \
+    static attributes void name(const unsigned char *const *messages, size_t length, sha256_digest *digests) {         \
+        unsigned char block[lanes][SHA256_BLOCK_LENGTH];                                                              \
+        size_t block_count = (length + 8) / SHA256_BLOCK_LENGTH + 1;                                                  \
+        vector state[8], w[16];                                                                                       \
+        for (int i = 0; i < 8; i++) state[i] = (vector){0} + g_sha256_initial_state[i];                               \
+                                                                                                                      \
+        for (size_t index = 0; index < block_count; index++) {                                                        \
+            for (int lane = 0; lane < lanes; lane++) sha256_batch_load_block(block[lane], messages[lane], length, index, block_count); \
+            for (int t = 0; t < 16; t++)                                                                              \
+                for (int lane = 0; lane < lanes; lane++) w[t][lane] = sha256_load_be32(block[lane] + 4 * t);          \
+                                                                                                                      \
+            vector a = state[0], b = state[1], c = state[2], d = state[3];                                            \
+            vector e = state[4], f = state[5], g = state[6], h = state[7];                                            \
+            for (int t = 0; t < 64; t++) {                                                                            \
+                if (t >= 16) w[t & 15] += SIG1(w[(t - 2) & 15]) + w[(t - 7) & 15] + SIG0(w[(t - 15) & 15]);           \
+                vector t1 = h + EP1(e) + CH(e, f, g) + g_sha256_k[t] + w[t & 15];                                      \
+                vector t2 = EP0(a) + MAJ(a, b, c);                                                                    \
+                h = g;                                                                                                \
+                g = f;                                                                                                \
+                f = e;                                                                                                \
+                e = d + t1;                                                                                           \
+                d = c;                                                                                                \
+                c = b;                                                                                                \
+                b = a;                                                                                                \
+                a = t1 + t2;                                                                                          \
+            }                                                                                                         \
+            state[0] += a;                                                                                            \
+            state[1] += b;                                                                                            \
+            state[2] += c;                                                                                            \
+            state[3] += d;                                                                                            \
+            state[4] += e;                                                                                            \
+            state[5] += f;                                                                                            \
+            state[6] += g;                                                                                            \
+            state[7] += h;                                                                                            \
+        }                                                                                                             \
+                                                                                                                      \
+        for (int lane = 0; lane < lanes; lane++)                                                                      \
+            for (int i = 0; i < 8; i++) {                                                                             \
+                digests[lane].data[4 * i] = state[i][lane] >> 24;                                                     \
+                digests[lane].data[4 * i + 1] = state[i][lane] >> 16;                                                 \
+                digests[lane].data[4 * i + 2] = state[i][lane] >> 8;                                                  \
+                digests[lane].data[4 * i + 3] = state[i][lane];                                                       \
+            }                                                                                                         \
+    }
+
+SHA256_DEFINE_BATCH_FUNCTION(sha256_batch_lanes4, sha256_lanes4, 4, )
+#if CPU_FEATURES_X86
+SHA256_DEFINE_BATCH_FUNCTION(sha256_batch_lanes8, sha256_lanes8, 8, __attribute__((target("avx2"))))
+SHA256_DEFINE_BATCH_FUNCTION(sha256_batch_lanes16, sha256_lanes16, 16, __attribute__((target("avx512f"))))
+#endif
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Check if a backend can run on this machine.
+ * @param backend The backend.
+ * @return True if supported, false otherwise.
+ */
+bool sha256_is_backend_supported(sha256_backend backend) {
+    const cpu_features *features = get_cpu_features();
+    switch (backend) {
+        case SHA256_BACKEND_GENERIC:
+            return true;
+        case SHA256_BACKEND_SSSE3:
+            return CPU_FEATURES_X86 && features->ssse3;
+        case SHA256_BACKEND_AVX2:
+            return CPU_FEATURES_X86 && features->avx2 && features->bmi2;
+        case SHA256_BACKEND_SHA_NI:
+            return CPU_FEATURES_X86 && features->sha_ni;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Route all SHA256 computation through a specific backend.
+ * @param backend The backend.
+ * @return True for success, false if the CPU does not support it.
+ */
+bool sha256_use_backend(sha256_backend backend) {
+    if (!sha256_is_backend_supported(backend)) return false;
+    g_sha256_backend = backend;
+    g_sha256_transform = g_sha256_transforms[backend];
+    return true;
+}
+
+/**
+ * Pick the fastest backend the CPU supports.
+ */
+void sha256_select_backend() {
+    for (int backend = SHA256_BACKEND_COUNT - 1; backend >= SHA256_BACKEND_GENERIC; backend--) {
+        if (sha256_use_backend(backend)) break;
+    }
+    for (unsigned int lanes = SHA256_MAX_BATCH_LANES; lanes >= 4; lanes /= 2) {
+        if (sha256_use_batch_lanes(lanes)) break;
+    }
+}
+
+/**
+ * Get the backend currently in use.
+ * @return The backend.
+ */
+sha256_backend sha256_get_backend() { return g_sha256_backend; }
+
+/**
+ * Get the printable name of a backend.
+ * @param backend The backend.
+ * @return Its name.
+ */
+const char *sha256_get_backend_name(sha256_backend backend) {
+    if (backend < SHA256_BACKEND_GENERIC || backend >= SHA256_BACKEND_COUNT) return "unknown";
+    return g_sha256_backend_names[backend];
+}
+
+/**
+ * Run the SHA256 compression function over consecutive
+ * blocks with the selected backend.
+ * @param state The chaining state, updated in place.
+ * @param blocks Consecutive 64-byte blocks.
+ * @param block_count Number of blocks.
+ */
+void sha256_transform(unsigned int state[8], const unsigned char *blocks, size_t block_count) { g_sha256_transform(state, blocks, block_count); }
+
+/**
+ * Start a new SHA256 computation.
+ * @param ctx A context.
+ */
+void sha256_init(sha256_context *ctx) {
+    ctx->byte_count = 0;
+    ctx->data_len = 0;
+    memcpy(ctx->state, g_sha256_initial_state, sizeof(ctx->state));
+}
+
+/**
+ * Feed more data into a SHA256 computation. Whole blocks
+ * are compressed straight from the input without copying.
+ * @param ctx A context.
+ * @param data The data.
+ * @param len The length of the data, in bytes.
+ */
+void sha256_update(sha256_context *ctx, const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    ctx->byte_count += len;
+
+    // Top up a partial block first.
+    if (ctx->data_len > 0) {
+        size_t missing = SHA256_BLOCK_LENGTH - ctx->data_len;
+        if (len < missing) {
+            memcpy(ctx->data + ctx->data_len, bytes, len);
+            ctx->data_len += len;
+            return;
+        }
+        memcpy(ctx->data + ctx->data_len, bytes, missing);
+        sha256_transform(ctx->state, ctx->data, 1);
+        bytes += missing;
+        len -= missing;
+        ctx->data_len = 0;
+    }
+
+    size_t block_count = len / SHA256_BLOCK_LENGTH;
+    if (block_count > 0) {
+        sha256_transform(ctx->state, bytes, block_count);
+        bytes += block_count * SHA256_BLOCK_LENGTH;
+        len -= block_count * SHA256_BLOCK_LENGTH;
+    }
+
+    memcpy(ctx->data, bytes, len);
+    ctx->data_len = len;
+}
+
+/**
+ * Finish a SHA256 computation. The context has to be
+ * initialized again before it can be reused.
+ * @param ctx A context.
+ * @param digest Where the hash is written into.
+ */
+void sha256_final(sha256_context *ctx, sha256_digest *digest) {
+    unsigned int i = ctx->data_len;
+
+    // Pad whatever data is left in the buffer.
+    ctx->data[i++] = 0x80;
+    if (i > 56) {
+        memset(ctx->data + i, 0, SHA256_BLOCK_LENGTH - i);
+        sha256_transform(ctx->state, ctx->data, 1);
+        i = 0;
+    }
+    memset(ctx->data + i, 0, 56 - i);
+
+    // Append to the padding the total message's length in bits and transform.
+    unsigned long long bit_len = ctx->byte_count * 8;
+    for (i = 0; i < 8; i++) ctx->data[63 - i] = bit_len >> (8 * i);
+    sha256_transform(ctx->state, ctx->data, 1);
+
+    // SHA256 is big endian, so reverse the bytes of each state word.
+    for (i = 0; i < 8; i++) {
+        digest->data[4 * i] = ctx->state[i] >> 24;
+        digest->data[4 * i + 1] = ctx->state[i] >> 16;
+        digest->data[4 * i + 2] = ctx->state[i] >> 8;
+        digest->data[4 * i + 3] = ctx->state[i];
+    }
+}
+
+/**
+ * SHA256(SHA256()) of exactly 80 bytes, the size of a block
+ * header: three compressions, with all padding precomputed.
+ * @param input 80 bytes.
+ * @param digest Where the hash is written into.
+ */
+void sha256_double_80(const unsigned char *input, sha256_digest *digest) {
+    unsigned int state[8];
+    unsigned char block[SHA256_BLOCK_LENGTH] = {0};
+
+    // First pass: a full block, then 16 bytes and the padding of 640 bits.
+    memcpy(state, g_sha256_initial_state, sizeof(state));
+    g_sha256_transform(state, input, 1);
+    memcpy(block, input + SHA256_BLOCK_LENGTH, 80 - SHA256_BLOCK_LENGTH);
+    block[80 - SHA256_BLOCK_LENGTH] = 0x80;
+    block[SHA256_BLOCK_LENGTH - 2] = (80 * 8) >> 8;
+    block[SHA256_BLOCK_LENGTH - 1] = (80 * 8) & 0xff;
+    g_sha256_transform(state, block, 1);
+
+    // Second pass: the 32-byte digest and the padding of 256 bits.
+    memset(block, 0, sizeof(block));
+    for (int i = 0; i < 8; i++) {
+        block[4 * i] = state[i] >> 24;
+        block[4 * i + 1] = state[i] >> 16;
+        block[4 * i + 2] = state[i] >> 8;
+        block[4 * i + 3] = state[i];
+    }
+    block[SHA256_DIGEST_LENGTH] = 0x80;
+    block[SHA256_BLOCK_LENGTH - 2] = (SHA256_DIGEST_LENGTH * 8) >> 8;
+    memcpy(state, g_sha256_initial_state, sizeof(state));
+    g_sha256_transform(state, block, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest->data[4 * i] = state[i] >> 24;
+        digest->data[4 * i + 1] = state[i] >> 16;
+        digest->data[4 * i + 2] = state[i] >> 8;
+        digest->data[4 * i + 3] = state[i];
+    }
+}
+
+/**
+ * Route batch hashing through a specific number of lanes.
+ * @param lanes 4, 8 (AVX2) or 16 (AVX-512F).
+ * @return True for success, false if the CPU does not support it.
+ */
+bool sha256_use_batch_lanes(unsigned int lanes) {
+    switch (lanes) {
+        case 4:
+            g_sha256_batch = sha256_batch_lanes4;
+            break;
+#if CPU_FEATURES_X86
+        case 8:
+            if (!get_cpu_features()->avx2) return false;
+            g_sha256_batch = sha256_batch_lanes8;
+            break;
+        case 16:
+            if (!get_cpu_features()->avx512f) return false;
+            g_sha256_batch = sha256_batch_lanes16;
+            break;
+#endif
+        default:
+            return false;
+    }
+    g_sha256_batch_lanes = lanes;
+    return true;
+}
+
+/**
+ * Get the number of lanes batch hashing currently uses.
+ * @return The number of lanes.
+ */
+unsigned int sha256_get_batch_lanes() { return g_sha256_batch_lanes; }
+
+/**
+ * Hash many independent messages of the same length,
+ * several at a time in SIMD lanes. Meant for large
+ * numbers of small fixed-size inputs such as outpoints.
+ * @param messages The messages.
+ * @param length The length of every message, in bytes.
+ * @param count Number of messages.
+ * @param digests Where the hashes are written into, one per message.
+ */
+void sha256_batch(const unsigned char *const *messages, size_t length, size_t count, sha256_digest *digests) {
+    size_t done = 0;
+    for (; count - done >= g_sha256_batch_lanes; done += g_sha256_batch_lanes) g_sha256_batch(messages + done, length, digests + done);
+    // Four scalar SHA-NI hashes beat four SSE2 lanes.
+    if (g_sha256_backend != SHA256_BACKEND_SHA_NI)
+        for (; count - done >= 4; done += 4) sha256_batch_lanes4(messages + done, length, digests + done);
+
+    // Too few left to fill the lanes.
+    for (; done < count; done++) {
+        sha256_context ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, messages[done], length);
+        sha256_final(&ctx, &digests[done]);
+    }
+}
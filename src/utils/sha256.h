@@ -0,0 +1,58 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SHA256_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SHA256_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SHA256_BLOCK_LENGTH 64
+#define SHA256_DIGEST_LENGTH 32
+#define SHA256_MAX_BATCH_LANES 16
+
+/*
+ * A binary SHA256 hash. Small enough to live on the
+ * stack and be passed around by value.
+ */
+typedef struct Sha256Digest {
+    unsigned char data[SHA256_DIGEST_LENGTH];
+} sha256_digest;
+
+/*
+ * A streaming SHA256 computation. Owned by the caller
+ * and usually placed on the stack, so any number of
+ * threads can hash at the same time.
+ */
+typedef struct Sha256Context {
+    unsigned int state[8];                     // The chaining state.
+    unsigned long long byte_count;             // Total number of bytes fed so far.
+    unsigned int data_len;                     // Number of bytes waiting in data.
+    unsigned char data[SHA256_BLOCK_LENGTH];  // A partial block.
+} sha256_context;
+
+/*
+ * Implementations of the SHA256 compression function.
+ * The fastest one supported by the CPU is picked by
+ * sha256_select_backend(); the generic one always works.
+ */
+typedef enum Sha256Backend {
+    SHA256_BACKEND_GENERIC,  // Portable C reference implementation.
+    SHA256_BACKEND_SSSE3,    // SSSE3 message schedule, scalar rounds.
+    SHA256_BACKEND_AVX2,     // VEX-encoded message schedule, BMI2 (RORX) rounds.
+    SHA256_BACKEND_SHA_NI,   // Intel SHA extensions.
+    SHA256_BACKEND_COUNT
+} sha256_backend;
+
+void sha256_select_backend();
+bool sha256_use_backend(sha256_backend);
+bool sha256_is_backend_supported(sha256_backend);
+sha256_backend sha256_get_backend();
+const char *sha256_get_backend_name(sha256_backend);
+void sha256_transform(unsigned int state[8], const unsigned char *blocks, size_t block_count);
+void sha256_init(sha256_context *);
+void sha256_update(sha256_context *, const void *, size_t);
+void sha256_final(sha256_context *, sha256_digest *);
+void sha256_double_80(const unsigned char *, sha256_digest *);
+bool sha256_use_batch_lanes(unsigned int);
+unsigned int sha256_get_batch_lanes();
+void sha256_batch(const unsigned char *const *, size_t, size_t, sha256_digest *);
+
+#endif
@@ -0,0 +1,128 @@
+#include "signature_cache.h"
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "utils/cryptography.h"
+#include "utils/log_utils.h"
+
+#define LOG_SCOPE "signature cache"
+#define SIGNATURE_CACHE_SALT_LENGTH SHA256_BLOCK_LENGTH
+
+/*
+ * Signatures already found valid, so that a transaction
+ * verified on arrival is not verified again inside its
+ * block. Keys are salted hashes of the whole check, so
+ * the table cannot be flooded with chosen collisions.
+ * When full, a random entry makes room for the new one.
+ */
+static GHashTable *g_signature_cache = NULL;       // Key: an entry of g_signature_cache_entries.
+static sha256_digest *g_signature_cache_entries;  // Slots, for picking a random victim.
+static unsigned int g_signature_cache_capacity = 0;
+static unsigned int g_signature_cache_size = 0;
+static sha256_context g_signature_cache_salt;  // Midstate after absorbing the salt.
+static pthread_rwlock_t g_signature_cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * Set up the signature cache with a fresh random salt.
+ * @param capacity Maximum number of signatures remembered.
+ * @return True for success, false otherwise.
+ */
+bool initialize_signature_cache(unsigned int capacity) {
+    if (g_signature_cache != NULL) destroy_signature_cache();
+
+    unsigned char salt[SIGNATURE_CACHE_SALT_LENGTH];
+    if (capacity == 0 || !fill_random(salt, sizeof(salt))) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to initialize the signature cache.");
+        return false;
+    }
+    sha256_init(&g_signature_cache_salt);
+    sha256_update(&g_signature_cache_salt, salt, sizeof(salt));
+
+    pthread_rwlock_wrlock(&g_signature_cache_lock);
+    g_signature_cache = g_hash_table_new(hash_digest_key, are_digest_keys_equal);
+    g_signature_cache_entries = (sha256_digest *)malloc(capacity * sizeof(sha256_digest));
+    g_signature_cache_capacity = capacity;
+    g_signature_cache_size = 0;
+    pthread_rwlock_unlock(&g_signature_cache_lock);
+
+    general_log(LOG_SCOPE, LOG_INFO, "Initialized the signature cache with %u entries.", capacity);
+    return true;
+}
+
+/**
+ * Forget every cached signature and release the cache.
+ */
+void destroy_signature_cache() {
+    pthread_rwlock_wrlock(&g_signature_cache_lock);
+    if (g_signature_cache != NULL) g_hash_table_destroy(g_signature_cache);
+    free(g_signature_cache_entries);
+    g_signature_cache = NULL;
+    g_signature_cache_entries = NULL;
+    g_signature_cache_capacity = 0;
+    g_signature_cache_size = 0;
+    pthread_rwlock_unlock(&g_signature_cache_lock);
+}
+
+/**
+ * Get the cache key of a signature check.
+ * @param check The signature check.
+ * @return SHA256(salt || public key || message hash || signature).
+ */
+sha256_digest get_signature_cache_key(const signature_check *check) {
+    sha256_digest key;
+    sha256_context ctx = g_signature_cache_salt;
+    sha256_update(&ctx, check->public_key.data, sizeof(check->public_key.data));
+    sha256_update(&ctx, check->msg_hash.data, SHA256_DIGEST_LENGTH);
+    sha256_update(&ctx, check->signature.data, sizeof(check->signature.data));
+    sha256_final(&ctx, &key);
+    return key;
+}
+
+/**
+ * Check whether a signature is known to be valid.
+ * @param key The cache key of the signature check.
+ * @return True if cached, false otherwise.
+ */
+bool is_signature_cached(const sha256_digest *key) {
+    pthread_rwlock_rdlock(&g_signature_cache_lock);
+    bool result = g_signature_cache != NULL && g_hash_table_contains(g_signature_cache, key);
+    pthread_rwlock_unlock(&g_signature_cache_lock);
+    return result;
+}
+
+/**
+ * Remember a signature that was verified as valid.
+ * Evicts a random entry when the cache is full.
+ * @param key The cache key of the signature check.
+ */
+void cache_valid_signature(const sha256_digest *key) {
+    pthread_rwlock_wrlock(&g_signature_cache_lock);
+    if (g_signature_cache == NULL || g_hash_table_contains(g_signature_cache, key)) {
+        pthread_rwlock_unlock(&g_signature_cache_lock);
+        return;
+    }
+
+    unsigned int slot = g_signature_cache_size;
+    if (g_signature_cache_size == g_signature_cache_capacity) {
+        slot = g_random_int_range(0, (int)g_signature_cache_capacity);
+        g_hash_table_remove(g_signature_cache, &g_signature_cache_entries[slot]);
+    } else {
+        g_signature_cache_size++;
+    }
+    g_signature_cache_entries[slot] = *key;
+    g_hash_table_add(g_signature_cache, &g_signature_cache_entries[slot]);
+    pthread_rwlock_unlock(&g_signature_cache_lock);
+}
+
+/**
+ * Get the number of cached signatures.
+ * @return The number of cached signatures.
+ */
+unsigned int get_signature_cache_size() {
+    pthread_rwlock_rdlock(&g_signature_cache_lock);
+    unsigned int size = g_signature_cache_size;
+    pthread_rwlock_unlock(&g_signature_cache_lock);
+    return size;
+}
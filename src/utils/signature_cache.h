@@ -0,0 +1,16 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SIGNATURE_CACHE_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SIGNATURE_CACHE_H
+
+#include <stdbool.h>
+
+#include "utils/sha256.h"
+#include "utils/signature_verifier.h"
+
+bool initialize_signature_cache(unsigned int);
+void destroy_signature_cache();
+sha256_digest get_signature_cache_key(const signature_check *);
+bool is_signature_cached(const sha256_digest *);
+void cache_valid_signature(const sha256_digest *);
+unsigned int get_signature_cache_size();
+
+#endif
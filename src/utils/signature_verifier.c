@@ -0,0 +1,240 @@
+#include "signature_verifier.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "utils/log_utils.h"
+#include "utils/signature_cache.h"
+
+#define LOG_SCOPE "signature verifier"
+#define SIGNATURE_VERIFIER_CHUNK_SIZE 8     // Checks a thread claims at a time.
+#define SIGNATURE_VERIFIER_MIN_PARALLEL 16  // Smaller batches are verified on the calling thread alone.
+#define SIGNATURE_VERIFIER_STACK_CHECKS 16  // Batches up to this size need no heap memory.
+
+typedef struct SignatureVerifierWorker {
+    pthread_t thread;
+    secp256k1_context *context;     // Owned by this worker only.
+    unsigned long seen_generation;  // The last job this worker picked up.
+} signature_verifier_worker;
+
+// Thread pool
+static signature_verifier_worker *g_workers = NULL;
+static unsigned int g_num_of_workers = 0;
+static secp256k1_context *g_caller_context = NULL;
+static bool g_shutting_down = false;
+
+// The job in progress. Only one job runs at a time; the
+// calling thread verifies alongside the workers.
+static pthread_mutex_t g_submit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_job_done = PTHREAD_COND_INITIALIZER;
+static unsigned long g_job_generation = 0;
+static unsigned int g_busy_workers = 0;
+static signature_check *g_job_checks;
+static const unsigned int *g_job_indices;  // Which of g_job_checks to verify, ascending.
+static unsigned int g_job_count;
+static atomic_uint g_job_next;
+static atomic_uint g_job_first_failure;  // Position in g_job_indices; g_job_count while every check so far passed.
+
+/*
+ * -----------------------------------------------------------
+ * Helper Methods
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Remember a failing check, keeping only the lowest position.
+ * @param index The position of the failing check in the job.
+ */
+static void record_failure(unsigned int index) {
+    unsigned int current = atomic_load(&g_job_first_failure);
+    while (index < current && !atomic_compare_exchange_weak(&g_job_first_failure, &current, index)) {
+    }
+}
+
+/**
+ * Claim chunks of the current job until it runs out.
+ * Chunks are handed out in index order, so once a
+ * failure is known every later chunk can be skipped.
+ * @param context The secp256k1 context of this thread.
+ */
+static void run_job(secp256k1_context *context) {
+    while (true) {
+        unsigned int start = atomic_fetch_add(&g_job_next, SIGNATURE_VERIFIER_CHUNK_SIZE);
+        if (start >= g_job_count || start > atomic_load(&g_job_first_failure)) return;
+
+        unsigned int end = start + SIGNATURE_VERIFIER_CHUNK_SIZE < g_job_count ? start + SIGNATURE_VERIFIER_CHUNK_SIZE : g_job_count;
+        for (unsigned int i = start; i < end; i++) {
+            signature_check *check = &g_job_checks[g_job_indices[i]];
+            if (secp256k1_ecdsa_verify(context, &check->signature, check->msg_hash.data, &check->public_key) != 1) {
+                record_failure(i);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * The body of a worker thread: wait for a job, help
+ * finish it, report back, repeat.
+ * @param arg The signature_verifier_worker of this thread.
+ * @return NULL.
+ */
+static void *worker_main(void *arg) {
+    signature_verifier_worker *worker = (signature_verifier_worker *)arg;
+    pthread_mutex_lock(&g_pool_lock);
+    while (true) {
+        while (worker->seen_generation == g_job_generation && !g_shutting_down) pthread_cond_wait(&g_job_ready, &g_pool_lock);
+        if (g_shutting_down) break;
+        worker->seen_generation = g_job_generation;
+        pthread_mutex_unlock(&g_pool_lock);
+
+        run_job(worker->context);
+
+        pthread_mutex_lock(&g_pool_lock);
+        if (--g_busy_workers == 0) pthread_cond_signal(&g_job_done);
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+    return NULL;
+}
+
+/**
+ * Verify the selected checks of a batch across the thread pool.
+ * @param checks The signature checks.
+ * @param indices Which checks to verify, in ascending order.
+ * @param count Number of indices.
+ * @return Position of the first failing check in indices, or count if all pass.
+ */
+static unsigned int run_checks(signature_check *checks, const unsigned int *indices, unsigned int count) {
+    if (g_num_of_workers == 0 || count < SIGNATURE_VERIFIER_MIN_PARALLEL) {
+        for (unsigned int i = 0; i < count; i++) {
+            signature_check *check = &checks[indices[i]];
+            if (secp256k1_ecdsa_verify(g_caller_context, &check->signature, check->msg_hash.data, &check->public_key) != 1) return i;
+        }
+        return count;
+    }
+
+    pthread_mutex_lock(&g_submit_lock);
+
+    pthread_mutex_lock(&g_pool_lock);
+    g_job_checks = checks;
+    g_job_indices = indices;
+    g_job_count = count;
+    atomic_store(&g_job_next, 0);
+    atomic_store(&g_job_first_failure, count);
+    g_busy_workers = g_num_of_workers;
+    g_job_generation++;
+    pthread_cond_broadcast(&g_job_ready);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    run_job(g_caller_context);
+
+    pthread_mutex_lock(&g_pool_lock);
+    while (g_busy_workers > 0) pthread_cond_wait(&g_job_done, &g_pool_lock);
+    unsigned int first_failure = atomic_load(&g_job_first_failure);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    pthread_mutex_unlock(&g_submit_lock);
+    return first_failure;
+}
+
+/*
+ * -----------------------------------------------------------
+ * APIs
+ * -----------------------------------------------------------
+ */
+
+/**
+ * Start the signature verifier. Replaces a running one.
+ * @param num_of_threads Threads verifying a batch, the calling
+ * thread included. 0 uses one thread per online CPU.
+ * @return True for success, false otherwise.
+ */
+bool initialize_signature_verifier(unsigned int num_of_threads) {
+    if (g_caller_context != NULL) destroy_signature_verifier();
+
+    if (num_of_threads == 0) {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_of_threads = online_cpus > 0 ? (unsigned int)online_cpus : 1;
+    }
+
+    g_caller_context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+    g_workers = (signature_verifier_worker *)calloc(num_of_threads - 1, sizeof(signature_verifier_worker));
+    for (g_num_of_workers = 0; g_num_of_workers < num_of_threads - 1; g_num_of_workers++) {
+        signature_verifier_worker *worker = &g_workers[g_num_of_workers];
+        worker->context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+        worker->seen_generation = g_job_generation;
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            general_log(LOG_SCOPE, LOG_ERROR, "Failed to start signature verifier worker %u.", g_num_of_workers);
+            secp256k1_context_destroy(worker->context);
+            destroy_signature_verifier();
+            return false;
+        }
+    }
+
+    general_log(LOG_SCOPE, LOG_INFO, "Initialized the signature verifier with %u threads.", num_of_threads);
+    return true;
+}
+
+/**
+ * Stop the worker threads and release their contexts.
+ */
+void destroy_signature_verifier() {
+    pthread_mutex_lock(&g_pool_lock);
+    g_shutting_down = true;
+    pthread_cond_broadcast(&g_job_ready);
+    pthread_mutex_unlock(&g_pool_lock);
+
+    for (unsigned int i = 0; i < g_num_of_workers; i++) {
+        pthread_join(g_workers[i].thread, NULL);
+        secp256k1_context_destroy(g_workers[i].context);
+    }
+    free(g_workers);
+    g_workers = NULL;
+    g_num_of_workers = 0;
+    g_shutting_down = false;
+
+    if (g_caller_context != NULL) secp256k1_context_destroy(g_caller_context);
+    g_caller_context = NULL;
+}
+
+/**
+ * Get the number of threads verifying a batch.
+ * @return The number of threads, the calling thread included.
+ */
+unsigned int get_signature_verifier_threads() { return g_num_of_workers + 1; }
+
+/**
+ * Verify a batch of ECDSA signatures across the thread pool.
+ * Signatures found in the signature cache are not verified
+ * again, and the ones verified here are added to it.
+ * @param checks The signature checks.
+ * @param count Number of checks.
+ * @return The index of the first failing check, or -1 if all pass.
+ */
+long verify_signatures(signature_check *checks, unsigned int count) {
+    sha256_digest stack_keys[SIGNATURE_VERIFIER_STACK_CHECKS];
+    unsigned int stack_pending[SIGNATURE_VERIFIER_STACK_CHECKS];
+    bool on_stack = count <= SIGNATURE_VERIFIER_STACK_CHECKS;
+    sha256_digest *keys = on_stack ? stack_keys : (sha256_digest *)malloc(count * sizeof(sha256_digest));
+    unsigned int *pending = on_stack ? stack_pending : (unsigned int *)malloc(count * sizeof(unsigned int));
+    unsigned int pending_count = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        keys[i] = get_signature_cache_key(&checks[i]);
+        if (!is_signature_cached(&keys[i])) pending[pending_count++] = i;
+    }
+
+    // Everything before the first failure was verified as valid.
+    unsigned int first_failure = run_checks(checks, pending, pending_count);
+    for (unsigned int i = 0; i < first_failure; i++) cache_valid_signature(&keys[pending[i]]);
+    long result = first_failure == pending_count ? -1 : (long)pending[first_failure];
+
+    if (!on_stack) {
+        free(pending);
+        free(keys);
+    }
+    return result;
+}
@@ -0,0 +1,24 @@
+#ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SIGNATURE_VERIFIER_H
+#define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SIGNATURE_VERIFIER_H
+
+#include <secp256k1.h>
+#include <stdbool.h>
+
+#include "utils/sha256.h"
+
+/*
+ * One ECDSA check: does signature sign msg_hash
+ * under public_key?
+ */
+typedef struct SignatureCheck {
+    secp256k1_pubkey public_key;
+    sha256_digest msg_hash;
+    secp256k1_ecdsa_signature signature;
+} signature_check;
+
+bool initialize_signature_verifier(unsigned int);
+void destroy_signature_verifier();
+unsigned int get_signature_verifier_threads();
+long verify_signatures(signature_check *, unsigned int);
+
+#endif
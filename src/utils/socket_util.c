@@ -1,11 +1,13 @@
 #include "socket_util.h"
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include "constants.h"
 #include "log_utils.h"
 #include "sys_utils.h"
 
@@ -17,6 +19,63 @@ char *combine_data_with_command(char *command, unsigned int command_length, cons
     return s;
 }
 
+/**
+ * Allocate a message for the listener with its command
+ * header already written: the command, zero padded, and
+ * WIRE_FORMAT in its last byte. The data goes right after
+ * it, at COMMAND_LENGTH, so that nothing is copied twice.
+ * @param command The command.
+ * @param data_length Bytes of data to make room for.
+ * @return The message, on the heap.
+ */
+char *create_message(const char *command, unsigned int data_length) {
+    char *message = malloc(COMMAND_LENGTH + data_length);
+    memset(message, '\0', COMMAND_LENGTH);
+    memcpy(message, command, strnlen(command, COMMAND_LENGTH - 1));
+    message[COMMAND_LENGTH - 1] = WIRE_FORMAT;
+    return message;
+}
+
+/**
+ * Send all of a message; a single send() may take only part of it.
+ * @param sock A connected socket.
+ * @param data The message.
+ * @param size Bytes of the message.
+ * @return True for success and false otherwise.
+ */
+bool send_message_by_socket(int sock, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(sock, data, size, 0);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+/**
+ * Receive a whole message, which ends once the sender closes
+ * the connection; a single recv() may return only part of it.
+ * @param sock A connected socket.
+ * @param buffer Where the message is written into.
+ * @param capacity Bytes of the buffer, the longest message accepted.
+ * @return Bytes of the message, or -1 if receiving fails or the message does not fit.
+ */
+ssize_t receive_message_by_socket(int sock, char *buffer, size_t capacity) {
+    size_t received = 0;
+    while (true) {
+        // Once the buffer is full, one more byte tells a message that fits from one that does not.
+        char overflow;
+        bool full = received == capacity;
+        ssize_t n = full ? recv(sock, &overflow, 1, 0) : recv(sock, buffer + received, capacity - received, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 || (full && n > 0)) return -1;
+        if (n == 0) return received;
+        received += n;
+    }
+}
+
 int send_model_by_socket(char *server_address_str, int server_port, char *send_data, int send_size) {
 #define LOG_SCOPE "Miner"
 
@@ -42,10 +101,13 @@ int send_model_by_socket(char *server_address_str, int server_port, char *send_d
         return -1;
     }
 
-    send(sock, send_data, send_size, 0);
-    general_log(LOG_SCOPE, LOG_INFO, "Client: model sent. Timestamp: %ul", get_timestamp());
+    if (!send_message_by_socket(sock, send_data, send_size)) {
+        general_log(LOG_SCOPE, LOG_ERROR, "Failed to send the model.");
+    } else {
+        general_log(LOG_SCOPE, LOG_INFO, "Client: model sent. Timestamp: %ul", get_timestamp());
+    }
 
-    // closing the connected socket
+    // closing the connected socket, which tells the listener the model is complete
     free(send_data);
-    close(client_fd);
+    close(sock);
 }
\ No newline at end of file
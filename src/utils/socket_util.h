@@ -1,7 +1,13 @@
 #ifndef MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SOCKET_UTILS_H
 #define MINIMALIST_BLOCK_CHAIN_SYSTEM_SRC_UTILS_SOCKET_UTILS_H
 
+#include <stdbool.h>
+#include <sys/types.h>
+
 char *combine_data_with_command(char *command, unsigned int command_length, const char *data, unsigned int data_length);
+char *create_message(const char *command, unsigned int data_length);
+bool send_message_by_socket(int sock, const char *data, size_t size);
+ssize_t receive_message_by_socket(int sock, char *buffer, size_t capacity);
 int send_model_by_socket(char *server_address_str, int server_port, char *send_data, int send_size);
 
 #endif
\ No newline at end of file
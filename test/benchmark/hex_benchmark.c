@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/cpu_features.h"
+#include "utils/hex.h"
+#include "utils/sys_utils.h"
+
+#if CPU_FEATURES_X86
+#include <x86intrin.h>
+#endif
+
+#define BENCHMARK_BUFFER_LENGTH 4096
+#define BENCHMARK_ROUNDS 20000
+#define BENCHMARK_SPRINTF_ROUNDS 500  // sprintf and sscanf are far slower.
+
+static const size_t g_benchmark_lengths[] = {32, 64, BENCHMARK_BUFFER_LENGTH};  // A hash, a pk_script, a large buffer.
+static const char *g_benchmark_length_names[] = {"32 B hash", "64 B script", "4 KiB"};
+
+/**
+ * Read a cycle counter. Falls back to nanoseconds
+ * on machines without a time stamp counter.
+ * @return The counter value.
+ */
+static unsigned long long read_cycles() {
+#if CPU_FEATURES_X86
+    return __rdtsc();
+#else
+    return get_timestamp();
+#endif
+}
+
+/**
+ * The encoder convert_char_hexadecimal() used before the
+ * hex codec, kept here as the baseline.
+ * @param src The bytes.
+ * @param length Number of bytes.
+ * @param dest Where 2 * length + 1 characters are written into.
+ */
+static void encode_hex_sprintf(const unsigned char *src, size_t length, char *dest) {
+    for (size_t i = 0; i < length; i++) sprintf(dest + 2 * i, "%02hhX", src[i]);
+}
+
+/**
+ * The decoder convert_hex_back_to_data_array() used before
+ * the hex codec, kept here as the baseline.
+ * @param src 2 * length characters.
+ * @param length Number of bytes to decode.
+ * @param dest Where the bytes are written into.
+ */
+static void decode_hex_sscanf(const char *src, size_t length, unsigned char *dest) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned int byte;
+        sscanf(src + 2 * i, "%02x", &byte);
+        dest[i] = (unsigned char)byte;
+    }
+}
+
+/**
+ * Measure encoding or decoding with the selected backend,
+ * or with the sprintf/sscanf baseline.
+ * @param bytes The byte buffer.
+ * @param hex The character buffer.
+ * @param length Number of bytes per call.
+ * @param decode Whether to decode instead of encode.
+ * @param baseline Whether to use sprintf/sscanf.
+ * @return Cycles per byte.
+ */
+static double measure_cycles_per_byte(unsigned char *bytes, char *hex, size_t length, bool decode, bool baseline) {
+    unsigned int rounds = baseline ? BENCHMARK_SPRINTF_ROUNDS : BENCHMARK_ROUNDS;
+    unsigned long long start = read_cycles();
+    for (unsigned int i = 0; i < rounds; i++) {
+        if (decode && baseline)
+            decode_hex_sscanf(hex, length, bytes);
+        else if (decode)
+            decode_hex(hex, length, bytes);
+        else if (baseline)
+            encode_hex_sprintf(bytes, length, hex);
+        else
+            encode_hex(bytes, length, hex);
+    }
+    unsigned long long end = read_cycles();
+
+    // Keep the result alive so the loop is not optimized away.
+    if (bytes[0] == 0 && hex[0] == 0) printf(" ");
+    return (double)(end - start) / ((double)rounds * length);
+}
+
+int main() {
+    unsigned char *bytes = (unsigned char *)malloc(BENCHMARK_BUFFER_LENGTH);
+    char *hex = (char *)malloc(2 * BENCHMARK_BUFFER_LENGTH + 1);
+    for (int i = 0; i < BENCHMARK_BUFFER_LENGTH; i++) bytes[i] = (unsigned char)(i * 131 + 7);
+    encode_hex(bytes, BENCHMARK_BUFFER_LENGTH, hex);
+
+    for (int decode = 0; decode <= 1; decode++) {
+        printf("%sHex %s, %s per byte\n", decode ? "\n" : "", decode ? "decoding" : "encoding", CPU_FEATURES_X86 ? "cycles" : "nanoseconds");
+        printf("%-16s", "backend");
+        for (int i = 0; i < 3; i++) printf(" %12s", g_benchmark_length_names[i]);
+        printf("\n");
+
+        double baseline[3];
+        printf("%-16s", decode ? "sscanf" : "sprintf");
+        for (int i = 0; i < 3; i++) {
+            baseline[i] = measure_cycles_per_byte(bytes, hex, g_benchmark_lengths[i], decode, true);
+            printf(" %12.2f", baseline[i]);
+        }
+        printf("\n");
+
+        for (int backend = HEX_BACKEND_GENERIC; backend < HEX_BACKEND_COUNT; backend++) {
+            printf("%-16s", hex_get_backend_name(backend));
+            if (!hex_use_backend(backend)) {
+                printf(" %12s\n", "unsupported");
+                continue;
+            }
+            for (int i = 0; i < 3; i++) {
+                double cost = measure_cycles_per_byte(bytes, hex, g_benchmark_lengths[i], decode, false);
+                printf(" %6.2f %4.0fx", cost, baseline[i] / cost);
+            }
+            printf("\n");
+        }
+    }
+
+    hex_select_backend();
+    printf("Selected at start-up: %s\n", hex_get_backend_name(hex_get_backend()));
+
+    free(hex);
+    free(bytes);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/cpu_features.h"
+#include "utils/sha256.h"
+#include "utils/sys_utils.h"
+
+#if CPU_FEATURES_X86
+#include <x86intrin.h>
+#endif
+
+#define BENCHMARK_BUFFER_LENGTH (64 * 1024)
+#define BENCHMARK_ROUNDS 200
+#define BENCHMARK_SINGLE_BLOCK_ROUNDS 200000
+#define BENCHMARK_BATCH_MESSAGES 960  // Fits BENCHMARK_BUFFER_LENGTH.
+#define BENCHMARK_BATCH_MESSAGE_LENGTH 68  // A serialized transaction outpoint.
+#define BENCHMARK_BATCH_ROUNDS 200
+
+/**
+ * Read a cycle counter. Falls back to nanoseconds
+ * on machines without a time stamp counter.
+ * @return The counter value.
+ */
+static unsigned long long read_cycles() {
+#if CPU_FEATURES_X86
+    return __rdtsc();
+#else
+    return get_timestamp();
+#endif
+}
+
+/**
+ * Measure the cost of the compression function of the
+ * currently selected backend.
+ * @param data The input buffer.
+ * @param block_count Blocks per call.
+ * @param rounds Number of calls.
+ * @return Cycles per byte.
+ */
+static double measure_cycles_per_byte(const unsigned char *data, size_t block_count, unsigned int rounds) {
+    unsigned int state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    // Warm up caches and the branch predictor.
+    for (unsigned int i = 0; i < rounds / 10 + 1; i++) sha256_transform(state, data, block_count);
+
+    unsigned long long start = read_cycles();
+    for (unsigned int i = 0; i < rounds; i++) sha256_transform(state, data, block_count);
+    unsigned long long end = read_cycles();
+
+    // Keep the result alive so the loop is not optimized away.
+    if (state[0] == 0) printf(" ");
+    return (double)(end - start) / ((double)rounds * block_count * SHA256_BLOCK_LENGTH);
+}
+
+/**
+ * Measure the cost of hashing many outpoint-sized messages,
+ * either one after another or through sha256_batch().
+ * @param messages The messages.
+ * @param digests Where the hashes are written into.
+ * @param batched Whether to use the batch API.
+ * @return Cycles per message.
+ */
+static double measure_cycles_per_message(const unsigned char **messages, sha256_digest *digests, bool batched) {
+    unsigned long long start = read_cycles();
+    for (unsigned int round = 0; round < BENCHMARK_BATCH_ROUNDS; round++) {
+        if (batched) {
+            sha256_batch(messages, BENCHMARK_BATCH_MESSAGE_LENGTH, BENCHMARK_BATCH_MESSAGES, digests);
+            continue;
+        }
+        for (int i = 0; i < BENCHMARK_BATCH_MESSAGES; i++) {
+            sha256_context ctx;
+            sha256_init(&ctx);
+            sha256_update(&ctx, messages[i], BENCHMARK_BATCH_MESSAGE_LENGTH);
+            sha256_final(&ctx, &digests[i]);
+        }
+    }
+    unsigned long long end = read_cycles();
+    return (double)(end - start) / ((double)BENCHMARK_BATCH_ROUNDS * BENCHMARK_BATCH_MESSAGES);
+}
+
+int main() {
+    unsigned char *data = (unsigned char *)malloc(BENCHMARK_BUFFER_LENGTH);
+    for (int i = 0; i < BENCHMARK_BUFFER_LENGTH; i++) data[i] = (unsigned char)(i * 131 + 7);
+
+    printf("SHA256 compression function, %s per byte\n", CPU_FEATURES_X86 ? "cycles" : "nanoseconds");
+    printf("%-10s %16s %16s %10s\n", "backend", "64 KiB buffer", "single block", "speedup");
+
+    double generic_cost = 0;
+    for (int backend = SHA256_BACKEND_GENERIC; backend < SHA256_BACKEND_COUNT; backend++) {
+        if (!sha256_use_backend(backend)) {
+            printf("%-10s %16s\n", sha256_get_backend_name(backend), "unsupported");
+            continue;
+        }
+        double bulk = measure_cycles_per_byte(data, BENCHMARK_BUFFER_LENGTH / SHA256_BLOCK_LENGTH, BENCHMARK_ROUNDS);
+        double single = measure_cycles_per_byte(data, 1, BENCHMARK_SINGLE_BLOCK_ROUNDS);
+        if (backend == SHA256_BACKEND_GENERIC) generic_cost = bulk;
+        printf("%-10s %16.2f %16.2f %9.2fx\n", sha256_get_backend_name(backend), bulk, single, generic_cost / bulk);
+    }
+
+    sha256_select_backend();
+    printf("Selected at start-up: %s\n", sha256_get_backend_name(sha256_get_backend()));
+
+    const unsigned char *messages[BENCHMARK_BATCH_MESSAGES];
+    sha256_digest *digests = (sha256_digest *)malloc(BENCHMARK_BATCH_MESSAGES * sizeof(sha256_digest));
+    for (int i = 0; i < BENCHMARK_BATCH_MESSAGES; i++) messages[i] = data + i * BENCHMARK_BATCH_MESSAGE_LENGTH;
+
+    printf("\n%d-byte messages, %s per message\n", BENCHMARK_BATCH_MESSAGE_LENGTH, CPU_FEATURES_X86 ? "cycles" : "nanoseconds");
+    double serial = measure_cycles_per_message(messages, digests, false);
+    printf("%-16s %12.1f\n", "serial", serial);
+    for (unsigned int lanes = 4; lanes <= SHA256_MAX_BATCH_LANES; lanes *= 2) {
+        char name[32];
+        sprintf(name, "batch %u lanes", lanes);
+        if (!sha256_use_batch_lanes(lanes)) {
+            printf("%-16s %12s\n", name, "unsupported");
+            continue;
+        }
+        double batched = measure_cycles_per_message(messages, digests, true);
+        printf("%-16s %12.1f %9.2fx\n", name, batched, serial / batched);
+    }
+
+    free(digests);
+    free(data);
+    return 0;
+}
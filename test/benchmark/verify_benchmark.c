@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "model/transaction/transaction.h"
+#include "utils/constants.h"
+#include "utils/cryptography.h"
+#include "utils/signature_cache.h"
+#include "utils/sys_utils.h"
+
+#if defined(__GLIBC__)
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+#else
+#include <dlfcn.h>
+#endif
+
+#define BENCHMARK_TRANSACTIONS 1024  // Each spends one output of a single funding transaction.
+#define BENCHMARK_ROUNDS 5
+
+// Heap allocations seen while counting is on.
+static bool g_counting = false;
+static unsigned long g_allocations = 0;
+
+/*
+ * The allocator is wrapped for the whole program, so that
+ * whatever the verification path allocates, directly or
+ * through the libraries it calls, is counted.
+ */
+
+#if defined(__GLIBC__)
+#define REAL_MALLOC __libc_malloc
+#define REAL_CALLOC __libc_calloc
+#define REAL_REALLOC __libc_realloc
+#else
+static void *(*g_real_malloc)(size_t);
+static void *(*g_real_calloc)(size_t, size_t);
+static void *(*g_real_realloc)(void *, size_t);
+
+static void *real_malloc(size_t size) {
+    if (g_real_malloc == NULL) g_real_malloc = dlsym(RTLD_NEXT, "malloc");
+    return g_real_malloc(size);
+}
+
+static void *real_calloc(size_t count, size_t size) {
+    if (g_real_calloc == NULL) g_real_calloc = dlsym(RTLD_NEXT, "calloc");
+    return g_real_calloc(count, size);
+}
+
+static void *real_realloc(void *ptr, size_t size) {
+    if (g_real_realloc == NULL) g_real_realloc = dlsym(RTLD_NEXT, "realloc");
+    return g_real_realloc(ptr, size);
+}
+
+#define REAL_MALLOC real_malloc
+#define REAL_CALLOC real_calloc
+#define REAL_REALLOC real_realloc
+#endif
+
+void *malloc(size_t size) {
+    if (g_counting) g_allocations++;
+    return REAL_MALLOC(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    if (g_counting) g_allocations++;
+    return REAL_CALLOC(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (g_counting) g_allocations++;
+    return REAL_REALLOC(ptr, size);
+}
+
+/**
+ * Create a finalized transaction paying the genesis
+ * output to BENCHMARK_TRANSACTIONS outputs of a new key,
+ * and one transaction spending each of those outputs.
+ * @param genesis The genesis transaction.
+ * @param spenders Where the spending transactions are written into.
+ * @return True for success, false otherwise.
+ */
+static bool create_benchmark_transactions(transaction *genesis, transaction **spenders) {
+    char *private_key = (char *)get_a_new_private_key();
+    secp256k1_pubkey *public_key = get_a_new_public_key(private_key);
+
+    transaction_create_shortcut_input funding_input = {
+        .previous_txid = get_transaction_txid(genesis), .previous_output_idx = 0, .private_key = get_genesis_transaction_private_key()};
+    transaction_create_shortcut_output funding_outputs[BENCHMARK_TRANSACTIONS];
+    for (int i = 0; i < BENCHMARK_TRANSACTIONS; i++) {
+        funding_outputs[i].value = TOTAL_NUMBER_OF_COINS / BENCHMARK_TRANSACTIONS;
+        funding_outputs[i].public_key = (char *)public_key->data;
+    }
+    funding_outputs[0].value += TOTAL_NUMBER_OF_COINS % BENCHMARK_TRANSACTIONS;
+    transaction_create_shortcut funding_data = {
+        .inputs = &funding_input, .num_of_inputs = 1, .outputs = funding_outputs, .num_of_outputs = BENCHMARK_TRANSACTIONS};
+    transaction *funding = (transaction *)malloc(sizeof(transaction));
+    if (!create_new_transaction_shortcut(&funding_data, funding) || !finalize_transaction(funding)) return false;
+
+    for (int i = 0; i < BENCHMARK_TRANSACTIONS; i++) {
+        transaction_create_shortcut_input input = {
+            .previous_txid = get_transaction_txid(funding), .previous_output_idx = i, .private_key = private_key};
+        transaction_create_shortcut_output output = funding_outputs[i];
+        transaction_create_shortcut data = {.inputs = &input, .num_of_inputs = 1, .outputs = &output, .num_of_outputs = 1};
+        spenders[i] = (transaction *)malloc(sizeof(transaction));
+        if (!create_new_transaction_shortcut(&data, spenders[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * Verify every spending transaction, counting the heap
+ * allocations on the way.
+ * @param spenders The spending transactions.
+ * @param allocations Where the allocations per input are written into.
+ * @return Nanoseconds per input, or a negative number if one failed to verify.
+ */
+static double measure_verification(transaction **spenders, double *allocations) {
+    bool all_valid = true;
+    g_allocations = 0;
+    g_counting = true;
+    unsigned long start = get_timestamp();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (int i = 0; i < BENCHMARK_TRANSACTIONS; i++) all_valid &= verify_transaction(spenders[i]);
+    }
+    unsigned long end = get_timestamp();
+    g_counting = false;
+
+    *allocations = (double)g_allocations / ((double)BENCHMARK_ROUNDS * BENCHMARK_TRANSACTIONS);
+    return all_valid ? (double)(end - start) / ((double)BENCHMARK_ROUNDS * BENCHMARK_TRANSACTIONS) : -1;
+}
+
+int main() {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis = initialize_transaction_system(false);
+    transaction **spenders = (transaction **)malloc(BENCHMARK_TRANSACTIONS * sizeof(transaction *));
+    if (!create_benchmark_transactions(genesis, spenders)) {
+        printf("Failed to create the benchmark transactions.\n");
+        return 1;
+    }
+
+    // Uncached first, so that every signature is verified; then warm.
+    printf("Transaction input verification, %d single-input transactions\n", BENCHMARK_TRANSACTIONS);
+    printf("%-16s %16s %16s\n", "signature cache", "ns per input", "allocs per input");
+    double uncached_allocations, cached_allocations;
+    destroy_signature_cache();
+    double uncached = measure_verification(spenders, &uncached_allocations);
+    printf("%-16s %16.1f %16.2f\n", "off", uncached, uncached_allocations);
+
+    initialize_signature_cache(SIGNATURE_CACHE_ENTRIES);
+    for (int i = 0; i < BENCHMARK_TRANSACTIONS; i++) verify_transaction(spenders[i]);
+    double cached = measure_verification(spenders, &cached_allocations);
+    printf("%-16s %16.1f %16.2f\n", "warm", cached, cached_allocations);
+
+    destroy_transaction_system();
+    destroy_cryptography_system();
+
+    if (uncached < 0 || cached < 0) {
+        printf("A transaction failed to verify.\n");
+        return 1;
+    }
+    if (uncached_allocations > 0 || cached_allocations > 0) {
+        printf("Verifying an input allocated on the heap.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -3,6 +3,10 @@
 #include <check.h>
 #include <stdlib.h>
 
+#include "../src/model/block/block_assembler.h"
+#include "../src/model/block/block_miner.h"
+#include "../src/model/block/block_persistence.h"
+#include "../src/model/block/block_validator.h"
 #include "../src/utils/mysql_util.h"
 #include "utils/constants.h"
 #include "utils/sys_utils.h"
@@ -88,7 +92,7 @@ START_TEST(test_destroy_block2) {
     finalize_block(genesis_b);
 
     // Shortcut of block creating
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -100,8 +104,7 @@ START_TEST(test_destroy_block2) {
     finalize_transaction(new_t);
 
     block_header_shortcut block_header = {
-        .prev_block_header_hash = "", .version = 0, .nonce = 0, .nBits = 0, .merkle_root_hash = "", .time = get_current_unix_time()};
-    memcpy(block_header.prev_block_header_hash, get_genesis_block_hash(), 65);
+        .prev_block_header_hash = *get_genesis_block_hash(), .version = 0, .nonce = 0, .nBits = 0, .time = get_current_unix_time()};
     transaction **txns = malloc(sizeof(txns));
     txns[0] = new_t;
     transactions_shortcut txns_shortcut = {.txns = txns, .txn_count = 1};
@@ -131,7 +134,7 @@ START_TEST(test_destroy_block3) {
     finalize_block(genesis_b);
 
     // Shortcut of the block
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -142,8 +145,7 @@ START_TEST(test_destroy_block3) {
     create_new_transaction_shortcut(&create_data, new_t);
     finalize_transaction(new_t);
     block_header_shortcut block_header = {
-        .prev_block_header_hash = "", .version = 0, .nonce = 0, .nBits = 0, .merkle_root_hash = "", .time = get_current_unix_time()};
-    memcpy(block_header.prev_block_header_hash, get_genesis_block_hash(), 65);
+        .prev_block_header_hash = *get_genesis_block_hash(), .version = 0, .nonce = 0, .nBits = MINING_NBITS, .time = get_current_unix_time()};
     transaction **txns = malloc(sizeof(txns));
     txns[0] = new_t;
     transactions_shortcut txns_shortcut = {.txns = txns, .txn_count = 1};
@@ -151,7 +153,8 @@ START_TEST(test_destroy_block3) {
 
     block *block1 = (block *)malloc(sizeof(block));
     create_new_block_shortcut(&block_data, block1);
-    finalize_block(block1);
+    ck_assert(mine_block_header(block1->header, 1).found);
+    ck_assert(finalize_block(block1));
 
     // Destroy.
     destroy_block_system();
@@ -175,7 +178,8 @@ START_TEST(test_append_prev_block) {
 
     block *new_block = create_an_empty_block(10);
     append_prev_block(genesis_b, new_block);
-    ck_assert_str_eq(new_block->header->prev_block_header_hash, hash_block_header(genesis_b->header));
+    sha256_digest genesis_block_hash = hash_block_header(genesis_b->header);
+    ck_assert(is_digest_equal(&new_block->header->prev_block_header_hash, &genesis_block_hash));
 
     // Destroy.
     destroy_block_system();
@@ -194,9 +198,8 @@ START_TEST(test_get_block_by_hash) {
     append_transaction_into_block(genesis_b, genesis_t, 0);
     finalize_block(genesis_b);
 
-    char *block_header_hash = hash_block_header(genesis_b->header);
-    block *retrieved_block = get_block_by_hash(block_header_hash);
-    free(block_header_hash);
+    sha256_digest block_header_hash = hash_block_header(genesis_b->header);
+    block *retrieved_block = get_block_by_hash(&block_header_hash);
 
     ck_assert_int_eq(retrieved_block->txn_count, genesis_b->txn_count);
     ck_assert_ptr_nonnull(retrieved_block->header);
@@ -207,8 +210,8 @@ START_TEST(test_get_block_by_hash) {
     ck_assert_int_eq(retrieved_header->nBits, original_header->nBits);
     ck_assert_int_eq(retrieved_header->nonce, original_header->nonce);
     ck_assert_int_eq(retrieved_header->time, original_header->time);
-    ck_assert_str_eq(retrieved_header->prev_block_header_hash, original_header->prev_block_header_hash);
-    ck_assert_str_eq(retrieved_header->merkle_root_hash, original_header->merkle_root_hash);
+    ck_assert(is_digest_equal(&retrieved_header->prev_block_header_hash, &original_header->prev_block_header_hash));
+    ck_assert(is_digest_equal(&retrieved_header->merkle_root_hash, &original_header->merkle_root_hash));
 
     // Destroy.
     destroy_block_system();
@@ -227,7 +230,8 @@ START_TEST(test_get_genesis_block_hash) {
     append_transaction_into_block(genesis_b, genesis_t, 0);
     finalize_block(genesis_b);
 
-    ck_assert_str_eq(hash_block_header(genesis_b->header), get_genesis_block_hash());
+    sha256_digest block_header_hash = hash_block_header(genesis_b->header);
+    ck_assert_mem_eq(block_header_hash.data, get_genesis_block_hash()->data, SHA256_DIGEST_LENGTH);
 
     // Destroy.
     destroy_block_system();
@@ -246,7 +250,8 @@ START_TEST(test_hash_block_header) {
     append_transaction_into_block(genesis_b, genesis_t, 0);
     finalize_block(genesis_b);
 
-    ck_assert_str_eq(hash_block_header(genesis_b->header), get_genesis_block_hash());
+    sha256_digest block_header_hash = hash_block_header(genesis_b->header);
+    ck_assert_mem_eq(block_header_hash.data, get_genesis_block_hash()->data, SHA256_DIGEST_LENGTH);
 
     // Destroy.
     destroy_block_system();
@@ -265,6 +270,11 @@ START_TEST(test_add_block_by_shortcut_and_finalize) {
     append_transaction_into_block(genesis_b, genesis_t, 0);
     finalize_block(genesis_b);
 
+    // The block finalized last is the tip.
+    sha256_digest genesis_hash = hash_block_header(genesis_b->header);
+    sha256_digest tip_hash = get_last_inserted_block_hash();
+    ck_assert_mem_eq(tip_hash.data, genesis_hash.data, SHA256_DIGEST_LENGTH);
+
     // Destroy.
     destroy_block_system();
     destroy_transaction_system();
@@ -301,7 +311,7 @@ START_TEST(test_verify_block_chain) {
     append_transaction_into_block(genesis_b, genesis_t, 0);
     finalize_block(genesis_b);
 
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -312,8 +322,7 @@ START_TEST(test_verify_block_chain) {
     create_new_transaction_shortcut(&create_data, new_t);
     finalize_transaction(new_t);
     block_header_shortcut block_header = {
-        .prev_block_header_hash = "", .version = 0, .nonce = 0, .nBits = 0, .merkle_root_hash = "", .time = get_current_unix_time()};
-    memcpy(block_header.prev_block_header_hash, get_genesis_block_hash(), 65);
+        .prev_block_header_hash = *get_genesis_block_hash(), .version = 0, .nonce = 0, .nBits = MINING_NBITS, .time = get_current_unix_time()};
     transaction **txns = malloc(sizeof(txns));
     txns[0] = new_t;
     transactions_shortcut txns_shortcut = {.txns = txns, .txn_count = 1};
@@ -321,7 +330,8 @@ START_TEST(test_verify_block_chain) {
 
     block *block1 = (block *)malloc(sizeof(block));
     create_new_block_shortcut(&block_data, block1);
-    finalize_block(block1);
+    ck_assert(mine_block_header(block1->header, 1).found);
+    ck_assert(finalize_block(block1));
 
     verify_block_chain(block1);
 
@@ -333,6 +343,414 @@ START_TEST(test_verify_block_chain) {
 }
 END_TEST
 
+START_TEST(test_serialize_block_header) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    block *new_block = create_an_empty_block(1);
+    append_prev_block(genesis_b, new_block);
+    new_block->header->version = 2;
+    new_block->header->time = 0x01020304;
+    new_block->header->nBits = 0x1f00ffff;
+    new_block->header->nonce = 0xa0b0c0d0;
+
+    // Fixed little endian layout with binary hashes.
+    unsigned char serialized[BLOCK_HEADER_SERIALIZED_LENGTH];
+    serialize_block_header(new_block->header, serialized);
+    unsigned char expected_time[4] = {0x04, 0x03, 0x02, 0x01};
+    unsigned char expected_nonce[4] = {0xd0, 0xc0, 0xb0, 0xa0};
+    ck_assert_int_eq(serialized[0], 2);
+    ck_assert_mem_eq(serialized + 4, get_genesis_block_hash()->data, SHA256_DIGEST_LENGTH);
+    ck_assert_mem_eq(serialized + 68, expected_time, 4);
+    ck_assert_mem_eq(serialized + 76, expected_nonce, 4);
+
+    // The hash is SHA256(SHA256()) of exactly those 80 bytes.
+    sha256_digest first = hash_struct(serialized, sizeof(serialized));
+    sha256_digest expected_hash = hash_struct(&first, sizeof(first));
+    sha256_digest actual_hash = hash_block_header(new_block->header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+
+    // The memoized hash follows changes to the header.
+    actual_hash = hash_block_header(new_block->header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+    new_block->header->nonce++;
+    serialize_block_header(new_block->header, serialized);
+    first = hash_struct(serialized, sizeof(serialized));
+    expected_hash = hash_struct(&first, sizeof(first));
+    actual_hash = hash_block_header(new_block->header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+    new_block->header->nonce--;
+    serialize_block_header(new_block->header, serialized);
+
+    // Round trip, including the empty hashes of the genesis block.
+    block_header parsed;
+    deserialize_block_header(serialized, &parsed);
+    ck_assert_int_eq(parsed.version, 2);
+    ck_assert(is_digest_equal(&parsed.prev_block_header_hash, &new_block->header->prev_block_header_hash));
+    ck_assert(is_digest_zero(&parsed.merkle_root_hash));
+    ck_assert_uint_eq(parsed.time, 0x01020304);
+    ck_assert_uint_eq(parsed.nBits, 0x1f00ffff);
+    ck_assert_uint_eq(parsed.nonce, 0xa0b0c0d0);
+    serialize_block_header(genesis_b->header, serialized);
+    deserialize_block_header(serialized, &parsed);
+    ck_assert(is_digest_zero(&parsed.prev_block_header_hash));
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_decode_compact_target) {
+    unsigned char target[SHA256_DIGEST_LENGTH];
+    unsigned char expected[SHA256_DIGEST_LENGTH] = {0};
+
+    ck_assert(decode_compact_target(0x1d00ffff, target));
+    expected[4] = 0xff;
+    expected[5] = 0xff;
+    ck_assert_mem_eq(target, expected, SHA256_DIGEST_LENGTH);
+
+    ck_assert(decode_compact_target(0x03123456, target));
+    memset(expected, 0, sizeof(expected));
+    expected[29] = 0x12;
+    expected[30] = 0x34;
+    expected[31] = 0x56;
+    ck_assert_mem_eq(target, expected, SHA256_DIGEST_LENGTH);
+
+    // Zero, negative and overflowing targets.
+    ck_assert(!decode_compact_target(0, target));
+    ck_assert(!decode_compact_target(0x04923456, target));
+    ck_assert(!decode_compact_target(0x22123456, target));
+}
+END_TEST
+
+START_TEST(test_mine_block_header) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    block *new_block = create_an_empty_block(1);
+    append_prev_block(genesis_b, new_block);
+    append_transaction_into_block(new_block, genesis_t, 0);
+    new_block->header->nBits = 0x1f00ffff;
+
+    for (unsigned int threads = 1; threads <= 3; threads++) {
+        new_block->header->time++;
+        mining_result result = mine_block_header(new_block->header, threads);
+        ck_assert(result.found);
+        ck_assert_int_eq(new_block->header->nonce, result.nonce);
+        ck_assert(result.hashes > 0);
+        ck_assert(check_block_proof_of_work(new_block->header));
+    }
+
+    // The same header cannot meet a far harder target.
+    new_block->header->nBits = 0x03000001;
+    ck_assert(!check_block_proof_of_work(new_block->header));
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_merkle_root) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    // The incremental tree and the builder agree with the batch computation at every size.
+    sha256_digest leaves[40];
+    for (unsigned int i = 0; i < 40; i++) leaves[i] = hash_struct(&i, sizeof(i));
+    merkle_tree *tree = create_merkle_tree();
+    merkle_root_builder builder = {.count = 0};
+    for (unsigned int i = 0; i < 40; i++) {
+        set_merkle_tree_leaf(tree, i, &leaves[i]);
+        add_merkle_root_builder_leaf(&builder, &leaves[i]);
+        sha256_digest incremental_root = get_merkle_tree_root(tree);
+        sha256_digest built_root = get_merkle_root_builder_root(&builder);
+        sha256_digest batch_root = compute_merkle_root(leaves, i + 1);
+        ck_assert_mem_eq(incremental_root.data, batch_root.data, SHA256_DIGEST_LENGTH);
+        ck_assert_mem_eq(built_root.data, batch_root.data, SHA256_DIGEST_LENGTH);
+    }
+    ck_assert_mem_eq(leaves[0].data, compute_merkle_root(leaves, 1).data, SHA256_DIGEST_LENGTH);
+    destroy_merkle_tree(tree);
+
+    // Appending a transaction keeps the header root up to date.
+    block *new_block = create_an_empty_block(3);
+    append_prev_block(genesis_b, new_block);
+    for (unsigned int i = 0; i < 3; i++) {
+        append_transaction_into_block(new_block, genesis_t, i);
+        ck_assert_int_eq(get_merkle_tree_size(new_block->txid_tree), i + 1);
+    }
+    sha256_digest expected_root = compute_block_merkle_root(new_block);
+    ck_assert(is_digest_equal(&new_block->header->merkle_root_hash, &expected_root));
+
+    // A block whose root does not match its transactions is rejected.
+    new_block->header->merkle_root_hash.data[0] ^= 1;
+    ck_assert(!verify_block(new_block));
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_assemble_block) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
+    transaction_create_shortcut_input input = {
+        .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
+    secp256k1_pubkey *new_public_key = get_a_new_public_key((char *)get_a_new_private_key());
+    transaction_create_shortcut_output output = {.value = TOTAL_NUMBER_OF_COINS, .public_key = (char *)new_public_key->data};
+    transaction_create_shortcut create_data = {.num_of_inputs = 1, .num_of_outputs = 1, .outputs = &output, .inputs = &input};
+    transaction *new_t1 = (transaction *)malloc(sizeof(transaction));
+    ck_assert(create_new_transaction_shortcut(&create_data, new_t1));
+    mempool *pool = create_mempool(MEMPOOL_MEMORY_LIMIT);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t1), MEMPOOL_ACCEPTED);
+
+    // Nothing is picked past either limit.
+    unsigned int exact_size = BLOCK_HEADER_SERIALIZED_LENGTH + 9 + get_transaction_size(new_t1);
+    ck_assert_int_eq(assemble_block(pool, get_genesis_block_hash(), BLOCK_MAX_SIZE, 0)->txn_count, 0);
+    ck_assert_int_eq(assemble_block(pool, get_genesis_block_hash(), exact_size - 1, BLOCK_MAX_TRANSACTIONS)->txn_count, 0);
+
+    // The template links to the tip, commits to its transactions, and mines into a valid block.
+    block *new_block = assemble_block(pool, get_genesis_block_hash(), exact_size, BLOCK_MAX_TRANSACTIONS);
+    ck_assert_int_eq(new_block->txn_count, 1);
+    ck_assert_ptr_eq(new_block->txns[0], new_t1);
+    ck_assert(is_digest_equal(&new_block->header->prev_block_header_hash, get_genesis_block_hash()));
+    sha256_digest expected_root = compute_block_merkle_root(new_block);
+    ck_assert(is_digest_equal(&new_block->header->merkle_root_hash, &expected_root));
+    ck_assert(mine_block_header(new_block->header, 1).found);
+    ck_assert(verify_block(new_block));
+
+    // Once accepted, the block takes its transactions over from the pool.
+    remove_mempool_block_transactions(pool, new_block->txns, new_block->txn_count);
+    ck_assert_int_eq(get_mempool_size(pool), 0);
+    destroy_mempool(pool);
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_prepare_block_transaction_checks) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    // A chain of transactions, each spending the one before it, in one block.
+    unsigned int chain_length = BLOCK_VALIDATOR_MIN_PARALLEL + 6;
+    block *new_block = create_an_empty_block(chain_length);
+    append_prev_block(genesis_b, new_block);
+    sha256_digest previous_txid = get_transaction_txid(genesis_t);
+    char *private_key = get_genesis_transaction_private_key();
+    for (unsigned int i = 0; i < chain_length; i++) {
+        transaction_create_shortcut_input input = {.previous_output_idx = 0, .previous_txid = previous_txid, .private_key = private_key};
+        private_key = (char *)get_a_new_private_key();
+        secp256k1_pubkey *public_key = get_a_new_public_key(private_key);
+        transaction_create_shortcut_output output = {.value = TOTAL_NUMBER_OF_COINS, .public_key = (char *)public_key->data};
+        transaction_create_shortcut create_data = {.num_of_inputs = 1, .num_of_outputs = 1, .outputs = &output, .inputs = &input};
+        transaction *t = (transaction *)malloc(sizeof(transaction));
+        ck_assert(create_new_transaction_shortcut(&create_data, t));
+        ck_assert(finalize_transaction(t));
+        append_transaction_into_block(new_block, t, i);
+        previous_txid = get_transaction_txid(t);
+    }
+    new_block->header->nBits = MINING_NBITS;
+    ck_assert(mine_block_header(new_block->header, 1).found);
+
+    // Any number of threads agrees with one.
+    signature_check *serial_checks = (signature_check *)malloc(chain_length * sizeof(signature_check));
+    signature_check *parallel_checks = (signature_check *)malloc(chain_length * sizeof(signature_check));
+    ck_assert_int_eq(prepare_block_transaction_checks(new_block, 1, serial_checks), -1);
+    ck_assert_int_eq(prepare_block_transaction_checks(new_block, 4, parallel_checks), -1);
+    ck_assert_mem_eq(serial_checks, parallel_checks, chain_length * sizeof(signature_check));
+    ck_assert(verify_block(new_block));
+
+    // A transaction cannot spend one that comes after it in the block.
+    transaction *temp = new_block->txns[10];
+    new_block->txns[10] = new_block->txns[11];
+    new_block->txns[11] = temp;
+    ck_assert_int_eq(prepare_block_transaction_checks(new_block, 1, serial_checks), 10);
+    ck_assert_int_eq(prepare_block_transaction_checks(new_block, 4, parallel_checks), 10);
+    ck_assert(!verify_block(new_block));
+    free(serial_checks);
+    free(parallel_checks);
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_cast_to_block) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    // A received block is decoded into an arena of its own, transactions included.
+    socket_block *socket_b = cast_to_socket_block(genesis_b);
+    ck_assert_int_eq(sizeof(socket_block) + socket_b->txns_size, get_socket_block_length(genesis_b));
+    block *received_b = cast_to_block(socket_b);
+    ck_assert_ptr_nonnull(received_b->arena);
+    ck_assert_ptr_eq(received_b->txns[0]->arena, received_b->arena);
+    ck_assert(!received_b->txns[0]->owns_arena);
+    ck_assert_uint_eq(received_b->txn_count, genesis_b->txn_count);
+    sha256_digest expected_hash = hash_block_header(genesis_b->header);
+    sha256_digest actual_hash = hash_block_header(received_b->header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+    sha256_digest expected_txid = get_transaction_txid(genesis_t);
+    sha256_digest actual_txid = get_transaction_txid(received_b->txns[0]);
+    ck_assert_mem_eq(actual_txid.data, expected_txid.data, SHA256_DIGEST_LENGTH);
+    ck_assert_mem_eq(received_b->txns[0]->tx_outs[0].pk_script, genesis_t->tx_outs[0].pk_script, 64);
+
+    // Destroying it frees everything at once; destroying its transactions alone does nothing.
+    destroy_transaction(received_b->txns[0]);
+    destroy_block(received_b);
+    free(socket_b);
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_serialize_block) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    // The raw format is shorter than a socket block, and reads back into one arena.
+    unsigned int size = get_serialized_block_size(genesis_b);
+    unsigned char *serialized = malloc(size + 1);
+    ck_assert_uint_eq(serialize_block(genesis_b, serialized), size);
+    ck_assert_int_lt(size, get_socket_block_length(genesis_b));
+    block *received_b = deserialize_block(serialized, size);
+    ck_assert_ptr_nonnull(received_b);
+    ck_assert_ptr_eq(received_b->txns[0]->arena, received_b->arena);
+    ck_assert_uint_eq(received_b->txn_count, genesis_b->txn_count);
+    sha256_digest expected_hash = hash_block_header(genesis_b->header);
+    sha256_digest actual_hash = hash_block_header(received_b->header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+    sha256_digest expected_txid = get_transaction_txid(genesis_t);
+    sha256_digest actual_txid = get_transaction_txid(received_b->txns[0]);
+    ck_assert_mem_eq(actual_txid.data, expected_txid.data, SHA256_DIGEST_LENGTH);
+    destroy_block(received_b);
+
+    // A block cut short, or followed by anything, is rejected.
+    ck_assert_ptr_null(deserialize_block(serialized, size - 1));
+    serialized[size] = 0;
+    ck_assert_ptr_null(deserialize_block(serialized, size + 1));
+    free(serialized);
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
+START_TEST(test_socket_block_view) {
+    // Init
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    block *genesis_b = initialize_block_system(false);
+    append_transaction_into_block(genesis_b, genesis_t, 0);
+    finalize_block(genesis_b);
+
+    // A socket block is read where it is, with its scripts pointing into it.
+    socket_block *socket_b = cast_to_socket_block(genesis_b);
+    size_t length = get_socket_block_length(genesis_b);
+    socket_block_view view;
+    ck_assert(view_socket_block((unsigned char *)socket_b, length, &view));
+    ck_assert_uint_eq(view.txn_count, genesis_b->txn_count);
+    block_header header;
+    get_socket_block_view_header(&view, &header);
+    sha256_digest expected_hash = hash_block_header(genesis_b->header);
+    sha256_digest actual_hash = hash_block_header(&header);
+    ck_assert_mem_eq(actual_hash.data, expected_hash.data, SHA256_DIGEST_LENGTH);
+    socket_transaction_view t;
+    get_first_socket_block_view_transaction(&view, &t);
+    sha256_digest expected_txid = get_transaction_txid(genesis_t);
+    sha256_digest actual_txid = get_socket_transaction_view_txid(&t);
+    ck_assert_mem_eq(actual_txid.data, expected_txid.data, SHA256_DIGEST_LENGTH);
+    transaction_output_view output;
+    get_socket_transaction_view_output(&t, 0, &output);
+    ck_assert_int_eq(output.value, genesis_t->tx_outs[0].value);
+    ck_assert_mem_eq(output.pk_script, genesis_t->tx_outs[0].pk_script, 64);
+    ck_assert(output.pk_script > (unsigned char *)socket_b && output.pk_script + 64 <= (unsigned char *)socket_b + length);
+
+    // It verifies as the block does, and copies out into one arena.
+    ck_assert_int_eq(verify_socket_block_view(&view), verify_block(genesis_b));
+    block *received_b = materialize_socket_block(&view);
+    ck_assert_ptr_eq(received_b->txns[0]->arena, received_b->arena);
+    actual_txid = get_transaction_txid(received_b->txns[0]);
+    ck_assert_mem_eq(actual_txid.data, expected_txid.data, SHA256_DIGEST_LENGTH);
+    destroy_block(received_b);
+
+    // A block cut short is refused; one whose root does not match its transactions is rejected.
+    ck_assert(!view_socket_block((unsigned char *)socket_b, length - 1, &view));
+    ck_assert(!view_socket_block((unsigned char *)socket_b, sizeof(socket_block) - 1, &view));
+    socket_b->header[36] ^= 1;
+    ck_assert(view_socket_block((unsigned char *)socket_b, length, &view));
+    ck_assert(!verify_socket_block_view(&view));
+    free(socket_b);
+
+    // Destroy.
+    destroy_block_system();
+    destroy_transaction_system();
+    destroy_cryptography_system();
+    destroy_mysql_system();
+}
+END_TEST
+
 Suite *transaction_suite(void) {
     Suite *s;
     s = suite_create("Block");
@@ -408,6 +826,60 @@ Suite *transaction_suite(void) {
     tc_verify_block_chain = tcase_create("tc_verify_block_chain");
     tcase_add_test(tc_verify_block_chain, test_verify_block_chain);
     suite_add_tcase(s, tc_verify_block_chain);
+
+    /* tc_serialize_block_header test case */
+    TCase *tc_serialize_block_header;
+    tc_serialize_block_header = tcase_create("tc_serialize_block_header");
+    tcase_add_test(tc_serialize_block_header, test_serialize_block_header);
+    suite_add_tcase(s, tc_serialize_block_header);
+
+    /* tc_decode_compact_target test case */
+    TCase *tc_decode_compact_target;
+    tc_decode_compact_target = tcase_create("tc_decode_compact_target");
+    tcase_add_test(tc_decode_compact_target, test_decode_compact_target);
+    suite_add_tcase(s, tc_decode_compact_target);
+
+    /* tc_mine_block_header test case */
+    TCase *tc_mine_block_header;
+    tc_mine_block_header = tcase_create("tc_mine_block_header");
+    tcase_add_test(tc_mine_block_header, test_mine_block_header);
+    suite_add_tcase(s, tc_mine_block_header);
+
+    /* tc_merkle_root test case */
+    TCase *tc_merkle_root;
+    tc_merkle_root = tcase_create("tc_merkle_root");
+    tcase_add_test(tc_merkle_root, test_merkle_root);
+    suite_add_tcase(s, tc_merkle_root);
+
+    /* tc_assemble_block test case */
+    TCase *tc_assemble_block;
+    tc_assemble_block = tcase_create("tc_assemble_block");
+    tcase_add_test(tc_assemble_block, test_assemble_block);
+    suite_add_tcase(s, tc_assemble_block);
+
+    /* tc_prepare_block_transaction_checks test case */
+    TCase *tc_prepare_block_transaction_checks;
+    tc_prepare_block_transaction_checks = tcase_create("tc_prepare_block_transaction_checks");
+    tcase_add_test(tc_prepare_block_transaction_checks, test_prepare_block_transaction_checks);
+    suite_add_tcase(s, tc_prepare_block_transaction_checks);
+
+    /* tc_cast_to_block test case */
+    TCase *tc_cast_to_block;
+    tc_cast_to_block = tcase_create("tc_cast_to_block");
+    tcase_add_test(tc_cast_to_block, test_cast_to_block);
+    suite_add_tcase(s, tc_cast_to_block);
+
+    /* tc_serialize_block test case */
+    TCase *tc_serialize_block;
+    tc_serialize_block = tcase_create("tc_serialize_block");
+    tcase_add_test(tc_serialize_block, test_serialize_block);
+    suite_add_tcase(s, tc_serialize_block);
+
+    /* tc_socket_block_view test case */
+    TCase *tc_socket_block_view;
+    tc_socket_block_view = tcase_create("tc_socket_block_view");
+    tcase_add_test(tc_socket_block_view, test_socket_block_view);
+    suite_add_tcase(s, tc_socket_block_view);
     return s;
 }
 
@@ -1,9 +1,16 @@
 #include "../src/model/transaction/transaction.h"
 
 #include <check.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "../src/model/transaction/flat_transaction.h"
+#include "../src/model/transaction/mempool.h"
 #include "../src/model/transaction/transaction_persistence.h"
+#include "../src/model/transaction/utxo_cache.h"
+#include "../src/model/transaction/utxo_set.h"
+#include "../src/model/transaction/utxo_snapshot.h"
 #include "../src/utils/constants.h"
 #include "../src/utils/mysql_util.h"
 
@@ -89,7 +96,7 @@ START_TEST(test_create_new_transaction_shortcut1) {
      * curr_input_data.previous_output_idx >= previous_tx->tx_out_count: false.
      * input_sum != output_sum: false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -120,8 +127,8 @@ START_TEST(test_create_new_transaction_shortcut2) {
      * curr_input_data.previous_output_idx >= previous_tx->tx_out_count: false.
      * input_sum != output_sum: false.
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
-    previous_transaction_id[0] = 'a';
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
+    previous_transaction_id.data[0] ^= 0xFF;
     transaction_create_shortcut_input input2 = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key2 = get_a_new_private_key();
@@ -150,7 +157,7 @@ START_TEST(test_create_new_transaction_shortcut3) {
      * !g_hash_table_contains(g_global_transaction_table, curr_input_data.previous_txid): false.
      * curr_input_data.previous_output_idx >= previous_tx->tx_out_count: true.
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input3 = {
         .previous_output_idx = 2, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key3 = get_a_new_private_key();
@@ -180,7 +187,7 @@ START_TEST(test_create_new_transaction_shortcut4) {
      * curr_input_data.previous_output_idx >= previous_tx->tx_out_count: false.
      * !append_new_transaction_input(ret_tx, input, i): true -> utxo false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input4 = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key4 = get_a_new_private_key();
@@ -222,7 +229,7 @@ START_TEST(test_create_new_transaction_shortcut5) {
      * curr_input_data.previous_output_idx >= previous_tx->tx_out_count: false.
      * !append_new_transaction_input(ret_tx, input, i): true -> signature fail due to public key
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input4 = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key4 = get_a_new_private_key();
@@ -247,7 +254,7 @@ START_TEST(test_get_transaction_txid) {
     initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
     transaction *genesis_t = initialize_transaction_system(false);
 
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -259,22 +266,296 @@ START_TEST(test_get_transaction_txid) {
     ck_assert_msg(create_new_transaction_shortcut(&create_data, new_t1), "Assert create new transaction successfully, but receive returning false!");
     ck_assert_msg(finalize_transaction(new_t1), "Assert create new transaction successfully, but receive returning false!");
 
-    transaction *copied_tx = (transaction *)malloc(sizeof(transaction));
-    memset(copied_tx, 0, sizeof(transaction));
-    copied_tx->tx_out_count = new_t1->tx_out_count;
-    copied_tx->tx_in_count = new_t1->tx_in_count;
-    copied_tx->lock_time = new_t1->lock_time;
-    copied_tx->version = new_t1->version;
+    // The TXID is the hash of the whole transaction in the raw transaction format.
+    unsigned int size = get_transaction_size(new_t1);
+    unsigned char *serialized = (unsigned char *)malloc(size);
+    ck_assert_uint_eq(serialize_transaction(new_t1, serialized), size);
+    sha256_digest expected_txid = hash_struct(serialized, size);
+    sha256_digest actual_txid = get_transaction_txid(new_t1);
+    ck_assert_mem_eq(expected_txid.data, actual_txid.data, SHA256_DIGEST_LENGTH);
+
+    // A socket transaction hashes to the same TXID.
+    socket_transaction *socket_t = cast_to_socket_transaction(new_t1);
+    socket_transaction_view view;
+    ck_assert(view_socket_transaction((unsigned char *)socket_t, get_socket_transaction_length(socket_t), &view));
+    actual_txid = get_socket_transaction_view_txid(&view);
+    ck_assert_mem_eq(expected_txid.data, actual_txid.data, SHA256_DIGEST_LENGTH);
+
+    // Changing an output changes the TXID.
+    new_t1->tx_outs[0].value--;
+    transaction copy = *new_t1;
+    copy.txid_cache.valid = false;
+    actual_txid = get_transaction_txid(&copy);
+    ck_assert(!is_digest_equal(&expected_txid, &actual_txid));
+    new_t1->tx_outs[0].value++;
+
+    free(socket_t);
+    free(serialized);
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_utxo_table) {
+    printf("%s\n", "test_utxo_table start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
 
-    ck_assert_str_eq(hash_struct_in_hex(copied_tx, sizeof(transaction)), get_transaction_txid(new_t1));
+    // The genesis output is unspent, under its binary outpoint.
+    sha256_digest txid = get_transaction_txid(genesis_t);
+    transaction_outpoint outpoint = {.hash = txid, .index = 0};
+    utxo_key genesis_key;
+    get_outpoint_utxo_key(&outpoint, &genesis_key);
+    ck_assert_mem_eq(genesis_key.txid, txid.data, SHA256_DIGEST_LENGTH);
+    ck_assert(does_utxo_entry_exist(&genesis_key));
+    genesis_key.index = 1;
+    ck_assert(!does_utxo_entry_exist(&genesis_key));
+
+    // Enough entries to grow the table a few times, then remove every other one.
+    utxo_table *table = create_utxo_table(0);
+    utxo_key key;
+    memcpy(key.txid, txid.data, SHA256_DIGEST_LENGTH);
+    for (unsigned int i = 0; i < 1000; i++) {
+        key.index = i;
+        put_utxo_table_entry(table, &key, i * 10);
+    }
+    key.index = 3;
+    put_utxo_table_entry(table, &key, 31);
+    ck_assert_uint_eq(get_utxo_table_size(table), 1000);
+    for (unsigned int i = 0; i < 1000; i += 2) {
+        key.index = i;
+        ck_assert(remove_utxo_table_entry(table, &key));
+        ck_assert(!remove_utxo_table_entry(table, &key));
+    }
+    ck_assert_uint_eq(get_utxo_table_size(table), 500);
+    for (unsigned int i = 0; i < 1000; i++) {
+        long int value = -1;
+        key.index = i;
+        ck_assert(get_utxo_table_entry(table, &key, &value) == (i % 2 == 1));
+        if (i % 2 == 1) ck_assert_int_eq(value, i == 3 ? 31 : i * 10);
+    }
+    destroy_utxo_table(table);
 
-    free(copied_tx);
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
+static void count_utxo_cache_write(const utxo_key *key, long int value, bool spent, void *user_data) {
+    unsigned int *writes = (unsigned int *)user_data;
+    writes[spent ? 1 : 0]++;
+}
+
+START_TEST(test_utxo_cache) {
+    printf("%s\n", "test_utxo_cache start!");
+
+    utxo_cache *cache = create_utxo_cache(0);
+    utxo_key key;
+    memset(key.txid, 0, SHA256_DIGEST_LENGTH);
+    long int value = -1;
+
+    // An outpoint created and spent between two write-backs never reaches the backing store.
+    key.index = 0;
+    put_utxo_cache_entry(cache, &key, 10, true);
+    ck_assert(spend_utxo_cache_entry(cache, &key, &value));
+    ck_assert_int_eq(value, 10);
+    ck_assert(!spend_utxo_cache_entry(cache, &key, NULL));
+    ck_assert(lookup_utxo_cache_entry(cache, &key, NULL) == UTXO_CACHE_MISS);
+    ck_assert_uint_eq(get_utxo_cache_dirty_count(cache), 0);
+
+    // Unless the backing store was not asked about it; then the spend is written back.
+    put_utxo_cache_entry(cache, &key, 10, false);
+    ck_assert(spend_utxo_cache_entry(cache, &key, NULL));
+    ck_assert(lookup_utxo_cache_entry(cache, &key, NULL) == UTXO_CACHE_HIT_SPENT);
+    ck_assert_uint_eq(get_utxo_cache_dirty_count(cache), 1);
+
+    // One loaded from the backing store is deleted there once spent.
+    key.index = 1;
+    load_utxo_cache_entry(cache, &key, 20);
+    ck_assert(lookup_utxo_cache_entry(cache, &key, &value) == UTXO_CACHE_HIT);
+    ck_assert_int_eq(value, 20);
+    ck_assert(spend_utxo_cache_entry(cache, &key, NULL));
+    ck_assert(lookup_utxo_cache_entry(cache, &key, NULL) == UTXO_CACHE_HIT_SPENT);
+    key.index = 2;
+    put_utxo_cache_entry(cache, &key, 30, false);
+
+    unsigned int writes[2] = {0, 0};
+    foreach_dirty_utxo_cache_entry(cache, count_utxo_cache_write, writes);
+    ck_assert_uint_eq(writes[0], 1);
+    ck_assert_uint_eq(writes[1], 2);
+    mark_utxo_cache_clean(cache);
+    ck_assert_uint_eq(get_utxo_cache_dirty_count(cache), 0);
+    ck_assert_uint_eq(get_utxo_cache_size(cache), 1);
+
+    // Over budget, clean entries are evicted and dirty ones are kept.
+    for (unsigned int i = 3; i < 1000; i++) {
+        key.index = i;
+        load_utxo_cache_entry(cache, &key, i);
+    }
+    key.index = 1000;
+    put_utxo_cache_entry(cache, &key, 1000, false);
+    ck_assert(is_utxo_cache_over_budget(cache));
+    evict_utxo_cache_entries(cache);
+    ck_assert(!is_utxo_cache_over_budget(cache));
+    ck_assert(lookup_utxo_cache_entry(cache, &key, &value) == UTXO_CACHE_HIT);
+    ck_assert_int_eq(value, 1000);
+    ck_assert_uint_eq(get_utxo_cache_dirty_count(cache), 1);
+
+    destroy_utxo_cache(cache);
+}
+END_TEST
+
+START_TEST(test_utxo_snapshot) {
+    printf("%s\n", "test_utxo_snapshot start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+    sha256_digest txid = get_transaction_txid(genesis_t);
+    utxo_key key;
+    memcpy(key.txid, txid.data, SHA256_DIGEST_LENGTH);
+    for (unsigned int i = 1; i < 50000; i++) {
+        key.index = i;
+        save_utxo_entry(&key, i);
+    }
+
+    // A dump loads back into an UTXO of the very same content.
+    char *path = "test_utxo.snapshot";
+    sha256_digest tip_hash = {.data = {1, 2, 3}};
+    ck_assert(dump_utxo_snapshot(path, &tip_hash));
+    key.index = 1;
+    ck_assert(spend_utxo_entry(&key, NULL));
+    key.index = 50000;
+    save_utxo_entry(&key, 50000);
+
+    // It is refused on top of another chain.
+    sha256_digest other_tip_hash = {.data = {3, 2, 1}};
+    ck_assert(!load_utxo_snapshot(path, &other_tip_hash, 4));
+    ck_assert(does_utxo_entry_exist(&key));
+
+    ck_assert(load_utxo_snapshot(path, &tip_hash, 4));
+    for (unsigned int i = 0; i <= 50000; i++) {
+        long int value = -1;
+        key.index = i;
+        ck_assert(spend_utxo_entry(&key, &value) == (i < 50000));
+        if (i > 0 && i < 50000) ck_assert_int_eq(value, i);
+    }
+
+    // A dump with records out of order is rejected even with a matching checksum.
+    FILE *file = fopen(path, "r+b");
+    size_t records_length = UTXO_SNAPSHOT_RECORD_LENGTH * 49999;
+    unsigned char *records = (unsigned char *)malloc(records_length);
+    unsigned char swapped[UTXO_SNAPSHOT_RECORD_LENGTH];
+    fseek(file, UTXO_SNAPSHOT_HEADER_LENGTH, SEEK_SET);
+    ck_assert(fread(records, records_length, 1, file) == 1);
+    memcpy(swapped, records, UTXO_SNAPSHOT_RECORD_LENGTH);
+    memcpy(records, records + UTXO_SNAPSHOT_RECORD_LENGTH, UTXO_SNAPSHOT_RECORD_LENGTH);
+    memcpy(records + UTXO_SNAPSHOT_RECORD_LENGTH, swapped, UTXO_SNAPSHOT_RECORD_LENGTH);
+    sha256_context ctx;
+    sha256_digest checksum;
+    sha256_init(&ctx);
+    sha256_update(&ctx, records, records_length);
+    sha256_final(&ctx, &checksum);
+    fseek(file, 24, SEEK_SET);
+    fwrite(checksum.data, SHA256_DIGEST_LENGTH, 1, file);
+    fwrite(records, records_length, 1, file);
+    fclose(file);
+    free(records);
+    key.index = 3;
+    save_utxo_entry(&key, 3);
+    ck_assert(!load_utxo_snapshot(path, &tip_hash, 4));
+    ck_assert(does_utxo_entry_exist(&key));
+
+    // A damaged dump is rejected and the UTXO left as it was.
+    file = fopen(path, "r+b");
+    fseek(file, UTXO_SNAPSHOT_HEADER_LENGTH + UTXO_SNAPSHOT_RECORD_LENGTH * 100 + SHA256_DIGEST_LENGTH + 4, SEEK_SET);
+    fputc(0, file);
+    fclose(file);
+    key.index = 7;
+    save_utxo_entry(&key, 7);
+    ck_assert(!load_utxo_snapshot(path, &tip_hash, 4));
+    ck_assert(does_utxo_entry_exist(&key));
+    remove(path);
 
     destroy_transaction_system();
     destroy_cryptography_system();
 }
 END_TEST
 
+#define CONCURRENT_UTXO_THREADS 4
+#define CONCURRENT_UTXO_KEYS 5000
+
+typedef struct ConcurrentUtxoWorker {
+    utxo_set *set;
+    unsigned int id;
+    unsigned int spent;
+} concurrent_utxo_worker;
+
+static void *run_concurrent_utxo_worker(void *arg) {
+    concurrent_utxo_worker *worker = (concurrent_utxo_worker *)arg;
+    utxo_key key;
+    memset(key.txid, 0, SHA256_DIGEST_LENGTH);
+
+    // Insert keys of our own, then race every other worker to spend the shared ones.
+    key.txid[0] = worker->id + 1;
+    for (unsigned int i = 0; i < CONCURRENT_UTXO_KEYS; i++) {
+        key.index = i;
+        put_utxo_set_entry(worker->set, &key, i);
+    }
+    key.txid[0] = 0;
+    for (unsigned int i = 0; i < CONCURRENT_UTXO_KEYS; i++) {
+        long int value = -1;
+        key.index = (i + worker->id * 997) % CONCURRENT_UTXO_KEYS;
+        if (spend_utxo_set_entry(worker->set, &key, &value)) {
+            if (value != key.index) return NULL;
+            worker->spent++;
+        }
+    }
+    return worker;
+}
+
+START_TEST(test_concurrent_utxo_set) {
+    printf("%s\n", "test_concurrent_utxo_set start!");
+
+    utxo_set *set = create_utxo_set();
+    utxo_key key;
+    memset(key.txid, 0, SHA256_DIGEST_LENGTH);
+    for (unsigned int i = 0; i < CONCURRENT_UTXO_KEYS; i++) {
+        key.index = i;
+        put_utxo_set_entry(set, &key, i);
+    }
+
+    pthread_t threads[CONCURRENT_UTXO_THREADS];
+    concurrent_utxo_worker workers[CONCURRENT_UTXO_THREADS];
+    for (unsigned int i = 0; i < CONCURRENT_UTXO_THREADS; i++) {
+        workers[i] = (concurrent_utxo_worker){.set = set, .id = i, .spent = 0};
+        pthread_create(&threads[i], NULL, run_concurrent_utxo_worker, &workers[i]);
+    }
+
+    // Every shared key is spent exactly once, and no insertion is lost.
+    unsigned int spent = 0;
+    for (unsigned int i = 0; i < CONCURRENT_UTXO_THREADS; i++) {
+        void *result;
+        pthread_join(threads[i], &result);
+        ck_assert_ptr_nonnull(result);
+        spent += workers[i].spent;
+    }
+    ck_assert_uint_eq(spent, CONCURRENT_UTXO_KEYS);
+    ck_assert_uint_eq(get_utxo_set_size(set), CONCURRENT_UTXO_THREADS * CONCURRENT_UTXO_KEYS);
+    key.index = 0;
+    ck_assert(!get_utxo_set_entry(set, &key, NULL));
+    key.txid[0] = CONCURRENT_UTXO_THREADS;
+    key.index = CONCURRENT_UTXO_KEYS - 1;
+    long int value = -1;
+    ck_assert(get_utxo_set_entry(set, &key, &value));
+    ck_assert_int_eq(value, CONCURRENT_UTXO_KEYS - 1);
+
+    destroy_utxo_set(set);
+}
+END_TEST
+
 START_TEST(test_get_transaction_by_txid) {
     printf("%s\n", "test_get_transaction_by_txid start!");
 
@@ -282,7 +563,7 @@ START_TEST(test_get_transaction_by_txid) {
     initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
     transaction *genesis_t = initialize_transaction_system(false);
 
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -294,26 +575,84 @@ START_TEST(test_get_transaction_by_txid) {
     ck_assert_msg(create_new_transaction_shortcut(&create_data, new_t1), "Assert create new transaction successfully, but receive returning false!");
     ck_assert_msg(finalize_transaction(new_t1), "Assert create new transaction successfully, but receive returning false!");
 
-    transaction *copied_tx = (transaction *)malloc(sizeof(transaction));
-    memset(copied_tx, 0, sizeof(transaction));
-    copied_tx->tx_out_count = new_t1->tx_out_count;
-    copied_tx->tx_in_count = new_t1->tx_in_count;
-    copied_tx->lock_time = new_t1->lock_time;
-    copied_tx->version = new_t1->version;
-
-    transaction *retrieved_tx = get_transaction_by_txid(hash_struct_in_hex(copied_tx, sizeof(transaction)));
+    sha256_digest txid = get_transaction_txid(new_t1);
+    transaction *retrieved_tx = get_transaction_by_txid(&txid);
     ck_assert_int_eq(retrieved_tx->tx_in_count, new_t1->tx_in_count);
     ck_assert_int_eq(retrieved_tx->tx_out_count, new_t1->tx_out_count);
     ck_assert_int_eq(retrieved_tx->lock_time, new_t1->lock_time);
     ck_assert_int_eq(retrieved_tx->version, new_t1->version);
 
-    free(copied_tx);
 
     destroy_transaction_system();
     destroy_cryptography_system();
 }
 END_TEST
 
+START_TEST(test_mempool) {
+    printf("%s\n", "test_mempool start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
+    transaction_create_shortcut_input input = {
+        .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
+    unsigned char *new_private_key = get_a_new_private_key();
+    secp256k1_pubkey *new_public_key = get_a_new_public_key((char *)new_private_key);
+    transaction_create_shortcut_output output = {.value = TOTAL_NUMBER_OF_COINS, .public_key = (char *)new_public_key->data};
+    transaction_create_shortcut create_data = {.num_of_inputs = 1, .num_of_outputs = 1, .outputs = &output, .inputs = &input};
+    transaction *new_t1 = (transaction *)malloc(sizeof(transaction));
+    transaction *new_t2 = (transaction *)malloc(sizeof(transaction));
+    transaction *new_t3 = (transaction *)malloc(sizeof(transaction));
+    ck_assert(create_new_transaction_shortcut(&create_data, new_t1));
+    secp256k1_pubkey *other_public_key = get_a_new_public_key((char *)get_a_new_private_key());
+    output.public_key = (char *)other_public_key->data;
+    ck_assert(create_new_transaction_shortcut(&create_data, new_t2));
+    secp256k1_pubkey *third_public_key = get_a_new_public_key((char *)get_a_new_private_key());
+    output.public_key = (char *)third_public_key->data;
+    ck_assert(create_new_transaction_shortcut(&create_data, new_t3));
+    new_t3->tx_ins[0].previous_outpoint.index = 5;
+    memoize_transaction_txid(new_t3);
+
+    // Each of them has an identity of its own.
+    sha256_digest txid1 = get_transaction_txid(new_t1), txid2 = get_transaction_txid(new_t2), txid3 = get_transaction_txid(new_t3);
+    ck_assert(!is_digest_equal(&txid1, &txid2));
+    ck_assert(!is_digest_equal(&txid1, &txid3));
+    ck_assert(!is_digest_equal(&txid2, &txid3));
+
+    // The first spend of the genesis output gets in; a second spend of it, or a spend of nothing, does not.
+    mempool *pool = create_mempool(MEMPOOL_MEMORY_LIMIT);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t1), MEMPOOL_ACCEPTED);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t1), MEMPOOL_DUPLICATE);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t2), MEMPOOL_CONFLICT);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t3), MEMPOOL_MISSING_INPUTS);
+    ck_assert_int_eq(get_mempool_size(pool), 1);
+    ck_assert(does_mempool_transaction_exist(pool, &txid1));
+    ck_assert(!does_mempool_transaction_exist(pool, &txid2));
+    utxo_key key;
+    get_outpoint_utxo_key(&new_t1->tx_ins[0].previous_outpoint, &key);
+    ck_assert(is_mempool_outpoint_spent(pool, &key));
+
+    // A block spending the same output pushes it out.
+    remove_mempool_block_transactions(pool, &new_t2, 1);
+    ck_assert_int_eq(get_mempool_size(pool), 0);
+    ck_assert_int_eq(get_mempool_memory_usage(pool), 0);
+    ck_assert(!is_mempool_outpoint_spent(pool, &key));
+    destroy_mempool(pool);
+
+    // Nothing fits into a pool without room.
+    pool = create_mempool(1);
+    ck_assert_int_eq(add_mempool_transaction(pool, new_t2), MEMPOOL_FULL);
+    destroy_mempool(pool);
+
+    destroy_transaction(new_t2);
+    destroy_transaction(new_t3);
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
 START_TEST(test_verify_transaction1) {
     printf("%s\n", "test_verify_transaction1 start!");
 
@@ -326,7 +665,7 @@ START_TEST(test_verify_transaction1) {
      * 1. !verify_transaction_input(&t->tx_ins[i], true) : false
      * 2. input_sum != output_sum : false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -357,7 +696,7 @@ START_TEST(test_verify_transaction2) {
      * 1. !verify_transaction_input(&t->tx_ins[i], true) : true -> hash failed
      * 2. input_sum != output_sum : false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -369,8 +708,7 @@ START_TEST(test_verify_transaction2) {
     ck_assert_msg(create_new_transaction_shortcut(&create_data, new_t1), "Assert create new transaction successfully, but receive returning false!");
     ck_assert_msg(finalize_transaction(new_t1), "Assert create new transaction successfully, but receive returning false!");
 
-    memcpy(new_t1->tx_ins[0].previous_outpoint.hash, get_transaction_txid(new_t1), 64);
-    new_t1->tx_ins[0].previous_outpoint.hash[64] = '\0';
+    new_t1->tx_ins[0].previous_outpoint.hash = get_transaction_txid(new_t1);
     ck_assert_msg(!verify_transaction(new_t1), "Assert verify the transaction fail, but receiving pass!");
 
     // Destroy.
@@ -391,7 +729,7 @@ START_TEST(test_verify_transaction3) {
      * 1. !verify_transaction_input(&t->tx_ins[i], true) : true -> output_idx >= previous_transaction->tx_out_count
      * 2. input_sum != output_sum : false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -424,7 +762,7 @@ START_TEST(test_verify_transaction4) {
      * 1. !verify_transaction_input(&t->tx_ins[i], true) : true -> public key wrong, signature verify fail
      * 2. input_sum != output_sum : false
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -457,7 +795,7 @@ START_TEST(test_verify_transaction5) {
      * 1. !verify_transaction_input(&t->tx_ins[i], true) : false
      * 2. input_sum != output_sum : true
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key = get_a_new_private_key();
@@ -489,7 +827,7 @@ START_TEST(test_finalize_transaction2) {
      * Test case:
      * 1. input_sum != output_sum : true
      */
-    char *previous_transaction_id = get_transaction_txid(genesis_t);
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
     transaction_create_shortcut_input input4 = {
         .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
     unsigned char *new_private_key4 = get_a_new_private_key();
@@ -509,6 +847,140 @@ START_TEST(test_finalize_transaction2) {
 }
 END_TEST
 
+START_TEST(test_transaction_txid) {
+    printf("%s\n", "test_transaction_txid start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+
+    // The memoized TXID is the one computed from scratch.
+    sha256_digest genesis_txid = get_transaction_txid(genesis_t);
+    transaction copy = *genesis_t;
+    copy.txid_cache.valid = false;
+    sha256_digest fresh_txid = get_transaction_txid(&copy);
+    ck_assert_mem_eq(genesis_txid.data, fresh_txid.data, SHA256_DIGEST_LENGTH);
+
+    // Reading the TXID never writes the transaction; only memoizing it does.
+    ck_assert(!copy.txid_cache.valid);
+    memoize_transaction_txid(&copy);
+    ck_assert(copy.txid_cache.valid);
+    ck_assert_mem_eq(copy.txid_cache.txid.data, genesis_txid.data, SHA256_DIGEST_LENGTH);
+
+    // A copy carries the memoized TXID along, which goes stale once a field changes.
+    copy = *genesis_t;
+    copy.lock_time++;
+    sha256_digest changed_txid = get_transaction_txid(&copy);
+    ck_assert(!is_digest_equal(&genesis_txid, &changed_txid));
+    copy.lock_time--;
+    sha256_digest restored_txid = get_transaction_txid(&copy);
+    ck_assert_mem_eq(genesis_txid.data, restored_txid.data, SHA256_DIGEST_LENGTH);
+
+    // Destroy.
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_flatten_transactions) {
+    printf("%s\n", "test_flatten_transactions start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+
+    sha256_digest previous_transaction_id = get_transaction_txid(genesis_t);
+    transaction_create_shortcut_input input = {
+        .previous_output_idx = 0, .previous_txid = previous_transaction_id, .private_key = get_genesis_transaction_private_key()};
+    unsigned char *new_private_key = get_a_new_private_key();
+    secp256k1_pubkey *new_public_key = get_a_new_public_key((char *)new_private_key);
+    transaction_create_shortcut_output outputs[2] = {{.value = TOTAL_NUMBER_OF_COINS - 1, .public_key = (char *)new_public_key->data},
+                                                     {.value = 1, .public_key = (char *)new_public_key->data}};
+    transaction_create_shortcut create_data = {.num_of_inputs = 1, .num_of_outputs = 2, .outputs = outputs, .inputs = &input};
+    transaction *new_t = (transaction *)malloc(sizeof(transaction));
+    ck_assert(create_new_transaction_shortcut(&create_data, new_t));
+
+    // Both transactions are packed one after the other, with the same contents.
+    transaction *txns[2] = {genesis_t, new_t};
+    flat_transaction *flat_genesis = flatten_transactions(txns, 2);
+    flat_transaction *flat_new = get_next_flat_transaction(flat_genesis);
+    ck_assert_uint_eq(flat_genesis->size, get_flat_transaction_size(1, 1));
+    ck_assert(flat_new->well_formed);
+    ck_assert_uint_eq(flat_new->tx_in_count, 1);
+    ck_assert_uint_eq(flat_new->tx_out_count, 2);
+    sha256_digest new_txid = get_transaction_txid(new_t);
+    ck_assert_mem_eq(flat_new->txid.data, new_txid.data, SHA256_DIGEST_LENGTH);
+    flat_transaction_input *flat_input = get_flat_transaction_input(flat_new, 0);
+    ck_assert_mem_eq(flat_input->previous_outpoint.txid, previous_transaction_id.data, SHA256_DIGEST_LENGTH);
+    ck_assert_int_eq(get_flat_transaction_output(flat_new, 1)->value, 1);
+
+    // The signature check collected from the packed copy is the same.
+    signature_check check, flat_check;
+    get_transaction_input_signature_check(&new_t->tx_ins[0], &genesis_t->tx_outs[0], &check);
+    get_flat_transaction_input_signature_check(flat_input, get_flat_transaction_output(flat_genesis, 0), &flat_check);
+    ck_assert_mem_eq(&flat_check, &check, sizeof(signature_check));
+
+    // A script shorter than a signature is read the same way on both paths: padded with zeros.
+    get_transaction_input_signature_check(&genesis_t->tx_ins[0], &genesis_t->tx_outs[0], &check);
+    flat_input = get_flat_transaction_input(flat_genesis, 0);
+    get_flat_transaction_input_signature_check(flat_input, get_flat_transaction_output(flat_genesis, 0), &flat_check);
+    ck_assert_mem_eq(&flat_check, &check, sizeof(signature_check));
+    free(flat_genesis);
+
+    // Destroy.
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_serialize_transaction) {
+    printf("%s\n", "test_serialize_transaction start!");
+
+    initialize_mysql_system("test");
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    transaction *genesis_t = initialize_transaction_system(false);
+
+    // The raw format is as long as get_transaction_size() says, and shorter than a socket transaction.
+    unsigned int size = get_transaction_size(genesis_t);
+    unsigned char serialized[size];
+    ck_assert_uint_eq(serialize_transaction(genesis_t, serialized), size);
+    socket_transaction *socket_tx = cast_to_socket_transaction(genesis_t);
+    ck_assert_int_lt(size, get_socket_transaction_length(socket_tx));
+
+    // A socket transaction claiming a longer script than it holds is rejected.
+    transaction *cast_t = cast_to_transaction(socket_tx, NULL);
+    ck_assert_ptr_nonnull(cast_t);
+    destroy_transaction(cast_t);
+    socket_transaction_input *socket_input = (socket_transaction_input *)socket_tx->transaction_input;
+    socket_input->script_bytes = 65;
+    ck_assert_ptr_null(cast_to_transaction(socket_tx, NULL));
+    free(socket_tx);
+
+    // It reads back into the same transaction, in an arena of its own.
+    byte_reader reader = {.data = serialized, .length = size, .offset = 0};
+    transaction *received_t = deserialize_transaction(&reader, NULL);
+    ck_assert_ptr_nonnull(received_t);
+    ck_assert_uint_eq(reader.offset, size);
+    ck_assert(received_t->owns_arena);
+    sha256_digest expected_txid = get_transaction_txid(genesis_t);
+    sha256_digest actual_txid = get_transaction_txid(received_t);
+    ck_assert_mem_eq(actual_txid.data, expected_txid.data, SHA256_DIGEST_LENGTH);
+    ck_assert_mem_eq(received_t->tx_ins[0].signature_script, genesis_t->tx_ins[0].signature_script, genesis_t->tx_ins[0].script_bytes);
+    ck_assert_mem_eq(received_t->tx_outs[0].pk_script, genesis_t->tx_outs[0].pk_script, genesis_t->tx_outs[0].pk_script_bytes);
+    destroy_transaction(received_t);
+
+    // A transaction cut short anywhere is rejected.
+    for (unsigned int length = 0; length < size; length++) {
+        byte_reader truncated_reader = {.data = serialized, .length = length, .offset = 0};
+        ck_assert_ptr_null(deserialize_transaction(&truncated_reader, NULL));
+    }
+
+    // Destroy.
+    destroy_transaction_system();
+    destroy_cryptography_system();
+}
+END_TEST
+
 Suite *transaction_suite(void) {
     Suite *s;
     s = suite_create("Transaction");
@@ -543,6 +1015,36 @@ Suite *transaction_suite(void) {
     tcase_add_test(tc_get_transaction_txid, test_get_transaction_txid);
     suite_add_tcase(s, tc_get_transaction_txid);
 
+    /* tc_utxo_table test case */
+    TCase *tc_utxo_table;
+    tc_utxo_table = tcase_create("tc_utxo_table");
+    tcase_add_test(tc_utxo_table, test_utxo_table);
+    suite_add_tcase(s, tc_utxo_table);
+
+    /* tc_utxo_cache test case */
+    TCase *tc_utxo_cache;
+    tc_utxo_cache = tcase_create("tc_utxo_cache");
+    tcase_add_test(tc_utxo_cache, test_utxo_cache);
+    suite_add_tcase(s, tc_utxo_cache);
+
+    /* tc_utxo_snapshot test case */
+    TCase *tc_utxo_snapshot;
+    tc_utxo_snapshot = tcase_create("tc_utxo_snapshot");
+    tcase_add_test(tc_utxo_snapshot, test_utxo_snapshot);
+    suite_add_tcase(s, tc_utxo_snapshot);
+
+    /* tc_concurrent_utxo_set test case */
+    TCase *tc_concurrent_utxo_set;
+    tc_concurrent_utxo_set = tcase_create("tc_concurrent_utxo_set");
+    tcase_add_test(tc_concurrent_utxo_set, test_concurrent_utxo_set);
+    suite_add_tcase(s, tc_concurrent_utxo_set);
+
+    /* tc_mempool test case */
+    TCase *tc_mempool;
+    tc_mempool = tcase_create("tc_mempool");
+    tcase_add_test(tc_mempool, test_mempool);
+    suite_add_tcase(s, tc_mempool);
+
     /* tc_get_transaction_by_txid test case */
     TCase *tc_get_transaction_by_txid;
     tc_get_transaction_by_txid = tcase_create("tc_get_transaction_by_txid");
@@ -615,6 +1117,24 @@ Suite *transaction_suite(void) {
     tcase_add_test(tc_finalize_transaction2, test_finalize_transaction2);
     suite_add_tcase(s, tc_finalize_transaction2);
 
+    /* tc_transaction_txid test case */
+    TCase *tc_transaction_txid;
+    tc_transaction_txid = tcase_create("tc_transaction_txid");
+    tcase_add_test(tc_transaction_txid, test_transaction_txid);
+    suite_add_tcase(s, tc_transaction_txid);
+
+    /* tc_flatten_transactions test case */
+    TCase *tc_flatten_transactions;
+    tc_flatten_transactions = tcase_create("tc_flatten_transactions");
+    tcase_add_test(tc_flatten_transactions, test_flatten_transactions);
+    suite_add_tcase(s, tc_flatten_transactions);
+
+    /* tc_serialize_transaction test case */
+    TCase *tc_serialize_transaction;
+    tc_serialize_transaction = tcase_create("tc_serialize_transaction");
+    tcase_add_test(tc_serialize_transaction, test_serialize_transaction);
+    suite_add_tcase(s, tc_serialize_transaction);
+
     return s;
 }
 
@@ -0,0 +1,288 @@
+#include "../src/utils/cryptography.h"
+
+#include <check.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/utils/hex.h"
+#include "../src/utils/sha256.h"
+#include "../src/utils/signature_cache.h"
+#include "../src/utils/signature_verifier.h"
+
+START_TEST(test_sha256_backends_agree_on_known_vectors) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    char *abc = "abc";
+    char *two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    for (int backend = SHA256_BACKEND_GENERIC; backend < SHA256_BACKEND_COUNT; backend++) {
+        if (!sha256_use_backend(backend)) continue;
+
+        char *hash = hash_struct_in_hex(abc, strlen(abc));
+        ck_assert_str_eq(hash, "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD");
+        free(hash);
+
+        hash = hash_struct_in_hex(two_blocks, strlen(two_blocks));
+        ck_assert_str_eq(hash, "248D6A61D20638B8E5C026930C3E6039A33CE45964FF2167F6ECEDD419DB06C1");
+        free(hash);
+    }
+
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_sha256_backends_agree_with_generic) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    unsigned char data[1000];
+    for (int i = 0; i < sizeof(data); i++) data[i] = (unsigned char)(i * 37 + 11);
+
+    for (unsigned int length = 0; length < sizeof(data); length += 13) {
+        sha256_use_backend(SHA256_BACKEND_GENERIC);
+        char *expected = hash_struct_in_hex(data, length);
+        for (int backend = SHA256_BACKEND_SSSE3; backend < SHA256_BACKEND_COUNT; backend++) {
+            if (!sha256_use_backend(backend)) continue;
+            char *actual = hash_struct_in_hex(data, length);
+            ck_assert_str_eq(actual, expected);
+            free(actual);
+        }
+        free(expected);
+    }
+
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_digest_hex_round_trip) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    char *abc = "abc";
+    sha256_digest digest = hash_struct(abc, strlen(abc));
+    char hex[SHA256_HEX_LENGTH];
+    convert_digest_to_hex(&digest, hex);
+    ck_assert_str_eq(hex, "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD");
+
+    sha256_digest parsed;
+    ck_assert(convert_hex_to_digest("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", &parsed));
+    ck_assert(is_digest_equal(&parsed, &digest));
+    ck_assert(!convert_hex_to_digest("BA7816BF", &parsed));
+    ck_assert(!convert_hex_to_digest("XA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD", &parsed));
+
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_sha256_streaming_matches_one_shot) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    unsigned char data[300];
+    for (int i = 0; i < sizeof(data); i++) data[i] = (unsigned char)(i * 53 + 1);
+    sha256_digest expected = hash_struct(data, sizeof(data));
+
+    // Split the input at every offset, across and within block boundaries.
+    for (int split = 0; split <= sizeof(data); split++) {
+        sha256_context ctx;
+        sha256_digest actual;
+        sha256_init(&ctx);
+        sha256_update(&ctx, data, split);
+        sha256_update(&ctx, data + split, sizeof(data) - split);
+        sha256_final(&ctx, &actual);
+        ck_assert_mem_eq(actual.data, expected.data, SHA256_DIGEST_LENGTH);
+    }
+
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_sha256_batch_matches_one_shot) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    // Odd count so every lane width also takes the remainder path.
+    enum { MESSAGE_COUNT = 37, MAX_LENGTH = 130 };
+    unsigned char data[MESSAGE_COUNT * MAX_LENGTH];
+    for (int i = 0; i < sizeof(data); i++) data[i] = (unsigned char)(i * 29 + 3);
+    const unsigned char *messages[MESSAGE_COUNT];
+    sha256_digest digests[MESSAGE_COUNT];
+
+    for (unsigned int lanes = 4; lanes <= SHA256_MAX_BATCH_LANES; lanes *= 2) {
+        if (!sha256_use_batch_lanes(lanes)) continue;
+        for (size_t length = 0; length <= MAX_LENGTH; length += 13) {
+            for (int i = 0; i < MESSAGE_COUNT; i++) messages[i] = data + i * length;
+            sha256_batch(messages, length, MESSAGE_COUNT, digests);
+            for (int i = 0; i < MESSAGE_COUNT; i++) {
+                sha256_digest expected = hash_struct((void *)messages[i], length);
+                ck_assert_mem_eq(digests[i].data, expected.data, SHA256_DIGEST_LENGTH);
+            }
+        }
+    }
+
+    sha256_select_backend();
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_verify_signatures_reports_first_failure) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+
+    enum { CHECK_COUNT = 100 };
+    unsigned char *private_key = get_a_new_private_key();
+    secp256k1_pubkey *public_key = get_a_new_public_key((char *)private_key);
+    signature_check checks[CHECK_COUNT];
+    for (int i = 0; i < CHECK_COUNT; i++) {
+        checks[i].public_key = *public_key;
+        checks[i].msg_hash = hash_struct(&i, sizeof(i));
+        secp256k1_ecdsa_signature *signature = sign(private_key, checks[i].msg_hash.data);
+        checks[i].signature = *signature;
+        free(signature);
+    }
+
+    for (unsigned int threads = 1; threads <= 4; threads++) {
+        ck_assert(initialize_signature_verifier(threads));
+        ck_assert_int_eq(get_signature_verifier_threads(), threads);
+        ck_assert_int_eq(verify_signatures(checks, CHECK_COUNT), -1);
+
+        // Break two checks; the lower index is reported.
+        checks[73].msg_hash.data[0] ^= 1;
+        checks[41].msg_hash.data[0] ^= 1;
+        ck_assert_int_eq(verify_signatures(checks, CHECK_COUNT), 41);
+        checks[73].msg_hash.data[0] ^= 1;
+        checks[41].msg_hash.data[0] ^= 1;
+    }
+
+    free(public_key);
+    free(private_key);
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_signature_cache_remembers_valid_signatures) {
+    initialize_cryptography_system(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    ck_assert(initialize_signature_cache(8));
+
+    unsigned char *private_key = get_a_new_private_key();
+    secp256k1_pubkey *public_key = get_a_new_public_key((char *)private_key);
+    signature_check checks[12];
+    for (int i = 0; i < 12; i++) {
+        checks[i].public_key = *public_key;
+        checks[i].msg_hash = hash_struct(&i, sizeof(i));
+        secp256k1_ecdsa_signature *signature = sign(private_key, checks[i].msg_hash.data);
+        checks[i].signature = *signature;
+        free(signature);
+    }
+
+    // Invalid signatures are never cached.
+    checks[2].msg_hash.data[0] ^= 1;
+    ck_assert_int_eq(verify_signatures(checks, 4), 2);
+    sha256_digest key = get_signature_cache_key(&checks[2]);
+    ck_assert(!is_signature_cached(&key));
+    ck_assert_int_eq(get_signature_cache_size(), 2);
+    checks[2].msg_hash.data[0] ^= 1;
+
+    ck_assert_int_eq(verify_signatures(checks, 4), -1);
+    key = get_signature_cache_key(&checks[2]);
+    ck_assert(is_signature_cached(&key));
+
+    // A full cache evicts instead of growing.
+    ck_assert_int_eq(verify_signatures(checks, 12), -1);
+    ck_assert_int_eq(get_signature_cache_size(), 8);
+
+    free(public_key);
+    free(private_key);
+    destroy_cryptography_system();
+}
+END_TEST
+
+START_TEST(test_hex_backends_agree_with_generic) {
+    unsigned char bytes[200], decoded[200];
+    char expected[401], actual[401];
+    for (int i = 0; i < sizeof(bytes); i++) bytes[i] = (unsigned char)(i * 197 + 13);
+
+    for (int backend = HEX_BACKEND_GENERIC; backend < HEX_BACKEND_COUNT; backend++) {
+        if (!hex_is_backend_supported(backend)) continue;
+        for (size_t length = 0; length <= sizeof(bytes); length++) {
+            ck_assert(hex_use_backend(HEX_BACKEND_GENERIC));
+            encode_hex(bytes, length, expected);
+            ck_assert(hex_use_backend(backend));
+            encode_hex(bytes, length, actual);
+            ck_assert_str_eq(actual, expected);
+
+            // Lowercase is accepted, anything else is not.
+            for (size_t i = 0; i < 2 * length; i += 3) actual[i] = (char)tolower(actual[i]);
+            ck_assert(decode_hex(actual, length, decoded));
+            ck_assert_mem_eq(decoded, bytes, length);
+            if (length > 0) {
+                actual[length] = 'g';
+                ck_assert(!decode_hex(actual, length, decoded));
+            }
+        }
+    }
+    hex_select_backend();
+}
+END_TEST
+
+Suite *cryptography_suite(void) {
+    Suite *s;
+    s = suite_create("Cryptography");
+
+    /* tc_sha256_known_vectors test case */
+    TCase *tc_sha256_known_vectors;
+    tc_sha256_known_vectors = tcase_create("tc_sha256_known_vectors");
+    tcase_add_test(tc_sha256_known_vectors, test_sha256_backends_agree_on_known_vectors);
+    suite_add_tcase(s, tc_sha256_known_vectors);
+
+    /* tc_sha256_backends_agree test case */
+    TCase *tc_sha256_backends_agree;
+    tc_sha256_backends_agree = tcase_create("tc_sha256_backends_agree");
+    tcase_add_test(tc_sha256_backends_agree, test_sha256_backends_agree_with_generic);
+    suite_add_tcase(s, tc_sha256_backends_agree);
+
+    /* tc_sha256_streaming test case */
+    TCase *tc_sha256_streaming;
+    tc_sha256_streaming = tcase_create("tc_sha256_streaming");
+    tcase_add_test(tc_sha256_streaming, test_sha256_streaming_matches_one_shot);
+    suite_add_tcase(s, tc_sha256_streaming);
+
+    /* tc_sha256_batch test case */
+    TCase *tc_sha256_batch;
+    tc_sha256_batch = tcase_create("tc_sha256_batch");
+    tcase_add_test(tc_sha256_batch, test_sha256_batch_matches_one_shot);
+    suite_add_tcase(s, tc_sha256_batch);
+
+    /* tc_verify_signatures test case */
+    TCase *tc_verify_signatures;
+    tc_verify_signatures = tcase_create("tc_verify_signatures");
+    tcase_add_test(tc_verify_signatures, test_verify_signatures_reports_first_failure);
+    suite_add_tcase(s, tc_verify_signatures);
+
+    /* tc_signature_cache test case */
+    TCase *tc_signature_cache;
+    tc_signature_cache = tcase_create("tc_signature_cache");
+    tcase_add_test(tc_signature_cache, test_signature_cache_remembers_valid_signatures);
+    suite_add_tcase(s, tc_signature_cache);
+
+    /* tc_digest_hex_round_trip test case */
+    TCase *tc_digest_hex_round_trip;
+    tc_digest_hex_round_trip = tcase_create("tc_digest_hex_round_trip");
+    tcase_add_test(tc_digest_hex_round_trip, test_digest_hex_round_trip);
+    suite_add_tcase(s, tc_digest_hex_round_trip);
+
+    /* tc_hex_backends_agree test case */
+    TCase *tc_hex_backends_agree;
+    tc_hex_backends_agree = tcase_create("tc_hex_backends_agree");
+    tcase_add_test(tc_hex_backends_agree, test_hex_backends_agree_with_generic);
+    suite_add_tcase(s, tc_hex_backends_agree);
+
+    return s;
+}
+
+int main(void) {
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+    s = cryptography_suite();
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}